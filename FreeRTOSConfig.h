@@ -30,21 +30,21 @@
 
 #define configUSE_PREEMPTION                    1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
-#define configUSE_TICKLESS_IDLE                 0
-#ifdef  STARm_F1
-  #define configCPU_CLOCK_HZ              ( ( unsigned long ) 72000000 )  
-  #define configSYSTICK_CLOCK_HZ          ( configCPU_CLOCK_HZ / 8 )
-#elif  STARm_F3
-  #define configCPU_CLOCK_HZ              ( ( unsigned long ) 8000000 )  
-  #define configSYSTICK_CLOCK_HZ          ( configCPU_CLOCK_HZ / 8 )
+#define configUSE_TICKLESS_IDLE                 2
+/* The core clock speed is set at run-time by the clock manager. */
+#ifndef __ASSEMBLER__
+  #include <stdint.h>
+  extern volatile uint32_t sys_clock_hz;
 #endif
+#define configCPU_CLOCK_HZ              ( ( unsigned long ) sys_clock_hz )
+#define configSYSTICK_CLOCK_HZ          ( configCPU_CLOCK_HZ / 8 )
 #define configTICK_RATE_HZ                      250
 #define configMAX_PRIORITIES                    5
 #define configMINIMAL_STACK_SIZE                128
 #define configMAX_TASK_NAME_LEN                 16
 #define configUSE_16_BIT_TICKS                  0
 #define configIDLE_SHOULD_YIELD                 1
-#define configUSE_TASK_NOTIFICATIONS            0
+#define configUSE_TASK_NOTIFICATIONS            1
 #define configUSE_MUTEXES                       0
 #define configUSE_RECURSIVE_MUTEXES             0
 #define configUSE_COUNTING_SEMAPHORES           0
@@ -56,22 +56,128 @@
 #define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION         0
-#define configSUPPORT_DYNAMIC_ALLOCATION        1
-#define configTOTAL_HEAP_SIZE           ( ( size_t ) ( 8 * 1024 ) )
+/* Every RTOS object is statically allocated, so there is no heap;
+ * see 'lib/rtos.h' and the linker scripts' RTOS RAM budget. */
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        0
 #define configAPPLICATION_ALLOCATED_HEAP        0
 
 /* Hook function related definitions. */
 #define configUSE_IDLE_HOOK                     0
 #define configUSE_TICK_HOOK                     0
-#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_MALLOC_FAILED_HOOK            0
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
-#define configUSE_TRACE_FACILITY                0
+#define configGENERATE_RUN_TIME_STATS           1
+#define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
+/* The stats and trace code list up to 'pSTATS_MAX_TASKS' tasks:
+ * the demo's four, the idle task, the EXTI handler task, and the
+ * report tasks which are built in. */
+#define pSTATS_BASE_TASKS                       6
+#ifdef STACK_REPORT
+  #define pSTATS_STACK_REPORT_TASKS             1
+#else
+  #define pSTATS_STACK_REPORT_TASKS             0
+#endif
+#ifdef TRACE_RECORDER
+  #define pSTATS_TRACE_TASKS                    1
+#else
+  #define pSTATS_TRACE_TASKS                    0
+#endif
+#ifdef PROFILER
+  #define pSTATS_PROFILER_TASKS                 1
+#else
+  #define pSTATS_PROFILER_TASKS                 0
+#endif
+#ifdef LOG_SEMIHOSTING
+  #define pSTATS_LOG_TASKS                      1
+#else
+  #define pSTATS_LOG_TASKS                      0
+#endif
+#define pSTATS_MAX_TASKS ( pSTATS_BASE_TASKS + pSTATS_STACK_REPORT_TASKS + \
+                           pSTATS_TRACE_TASKS + pSTATS_PROFILER_TASKS + \
+                           pSTATS_LOG_TASKS )
+#ifndef __ASSEMBLER__
+  extern void stats_timer_init( void );
+  extern volatile uint32_t stats_switch_counts[ pSTATS_MAX_TASKS + 1 ];
+#endif
+/* The run-time stats clock is the DWT cycle counter itself. It
+ * wraps around about once a minute at 72MHz, but the kernel and
+ * 'pStats' only ever subtract two readings in 32 bits, which is
+ * correct as long as they are less than a minute apart.
+ * ('DWT->CYCCNT' is at 0xE0001004 on Cortex-M3/M4 cores.) */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE() \
+  ( *( ( volatile uint32_t* ) 0xE0001004 ) )
+/* Count context switches for each task, by its trace number. */
+#define traceTASK_SWITCHED_IN() do { \
+  if ( pxCurrentTCB->uxTCBNumber <= pSTATS_MAX_TASKS ) { \
+    ++stats_switch_counts[ pxCurrentTCB->uxTCBNumber ]; \
+  } \
+  pTRACE_EVENT( pTRACE_EV_TASK_IN, pxCurrentTCB->uxTCBNumber ); \
+  } while ( 0 )
+
+/* Trace recorder event types; see 'lib/trace.h'. Each event is
+ * a word with the type in its top 4 bits and an argument (a task,
+ * queue or exception number, or a span label) in the rest. */
+#define pTRACE_EV_TASK_IN                       1
+#define pTRACE_EV_TASK_OUT                      2
+#define pTRACE_EV_TASK_READY                    3
+#define pTRACE_EV_TASK_DELAY                    4
+#define pTRACE_EV_TASK_NOTIFY                   5
+#define pTRACE_EV_TASK_NOTIFY_WAIT              6
+#define pTRACE_EV_QUEUE_SEND                    7
+#define pTRACE_EV_QUEUE_RECEIVE                 8
+#define pTRACE_EV_QUEUE_BLOCK                   9
+#define pTRACE_EV_ISR_ENTER                     10
+#define pTRACE_EV_ISR_EXIT                      11
+#define pTRACE_EV_SPAN_BEGIN                    12
+#define pTRACE_EV_SPAN_END                      13
+/* Build with 'TRACE_RECORDER=1' to record the kernel's events. */
+#ifdef TRACE_RECORDER
+  #ifndef __ASSEMBLER__
+    extern void trace_record( uint32_t event );
+  #endif
+  #define pTRACE_EVENT( type, arg ) \
+    trace_record( ( ( uint32_t ) ( type ) << 28 ) | \
+                  ( ( uint32_t ) ( arg ) & 0x0FFFFFFF ) )
+  #define traceTASK_SWITCHED_OUT() \
+    pTRACE_EVENT( pTRACE_EV_TASK_OUT, pxCurrentTCB->uxTCBNumber )
+  #define traceMOVED_TASK_TO_READY_STATE( pxTCB ) \
+    pTRACE_EVENT( pTRACE_EV_TASK_READY, ( pxTCB )->uxTCBNumber )
+  #define traceTASK_DELAY() \
+    pTRACE_EVENT( pTRACE_EV_TASK_DELAY, pxCurrentTCB->uxTCBNumber )
+  #define traceTASK_DELAY_UNTIL( x ) \
+    pTRACE_EVENT( pTRACE_EV_TASK_DELAY, pxCurrentTCB->uxTCBNumber )
+  /* (The notify functions call the task which they notify 'pxTCB'.) */
+  #define traceTASK_NOTIFY() \
+    pTRACE_EVENT( pTRACE_EV_TASK_NOTIFY, pxTCB->uxTCBNumber )
+  #define traceTASK_NOTIFY_FROM_ISR() \
+    pTRACE_EVENT( pTRACE_EV_TASK_NOTIFY, pxTCB->uxTCBNumber )
+  #define traceTASK_NOTIFY_GIVE_FROM_ISR() \
+    pTRACE_EVENT( pTRACE_EV_TASK_NOTIFY, pxTCB->uxTCBNumber )
+  #define traceTASK_NOTIFY_TAKE_BLOCK() \
+    pTRACE_EVENT( pTRACE_EV_TASK_NOTIFY_WAIT, pxCurrentTCB->uxTCBNumber )
+  #define traceTASK_NOTIFY_WAIT_BLOCK() \
+    pTRACE_EVENT( pTRACE_EV_TASK_NOTIFY_WAIT, pxCurrentTCB->uxTCBNumber )
+  #define traceQUEUE_SEND( pxQueue ) \
+    pTRACE_EVENT( pTRACE_EV_QUEUE_SEND, ( pxQueue )->uxQueueNumber )
+  #define traceQUEUE_SEND_FROM_ISR( pxQueue ) \
+    pTRACE_EVENT( pTRACE_EV_QUEUE_SEND, ( pxQueue )->uxQueueNumber )
+  #define traceQUEUE_RECEIVE( pxQueue ) \
+    pTRACE_EVENT( pTRACE_EV_QUEUE_RECEIVE, ( pxQueue )->uxQueueNumber )
+  #define traceQUEUE_RECEIVE_FROM_ISR( pxQueue ) \
+    pTRACE_EVENT( pTRACE_EV_QUEUE_RECEIVE, ( pxQueue )->uxQueueNumber )
+  #define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue ) \
+    pTRACE_EVENT( pTRACE_EV_QUEUE_BLOCK, ( pxQueue )->uxQueueNumber )
+  #define traceBLOCKING_ON_QUEUE_SEND( pxQueue ) \
+    pTRACE_EVENT( pTRACE_EV_QUEUE_BLOCK, ( pxQueue )->uxQueueNumber )
+#else
+  #define pTRACE_EVENT( type, arg )
+#endif
 
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES                   0
@@ -104,14 +210,14 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 #define INCLUDE_vTaskPrioritySet                0
 #define INCLUDE_uxTaskPriorityGet               0
 #define INCLUDE_vTaskDelete                     0
-#define INCLUDE_vTaskSuspend                    0
+#define INCLUDE_vTaskSuspend                    1
 #define INCLUDE_xResumeFromISR                  0
 #define INCLUDE_vTaskDelayUntil                 0
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          0
 #define INCLUDE_xTaskGetCurrentTaskHandle       0
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
-#define INCLUDE_xTaskGetIdleTaskHandle          0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xEventGroupSetBitFromISR        0
 #define INCLUDE_xTimerPendFunctionCall          0
@@ -122,6 +228,11 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 /* Redirect FreeRTOS port interrupts. */
 #define vPortSVCHandler     SVC_handler
 #define xPortPendSVHandler  pending_SV_handler
-#define xPortSysTickHandler SysTick_handler
+/* (The trace recorder wraps the tick interrupt, to record it.) */
+#ifdef TRACE_RECORDER
+  #define xPortSysTickHandler traced_SysTick_handler
+#else
+  #define xPortSysTickHandler SysTick_handler
+#endif
 
 #endif /* FREERTOS_CONFIG_H */
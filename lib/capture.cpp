@@ -0,0 +1,241 @@
+#include "capture.h"
+#include "clock.h"
+#include "lowpower.h"
+#include "clockgate.h"
+#include "trace.h"
+
+// The capture which currently owns the timer and DMA channel.
+static pCapture* active_capture = NULL;
+
+/*
+ * Set the GPIO bank to sample, and the buffer to record
+ * samples in. 'len' must be even.
+ */
+bool pCapture::init(pGPIO* gpio_bank, volatile uint16_t* buf,
+                    unsigned len) {
+  if (status == pSTATUS_RUN) { return false; }
+  bank   = gpio_bank;
+  buffer = buf;
+  length = len;
+  if (!bank || bank->get_status() == pSTATUS_ERR ||
+      !buffer || len < 2 || (len & 1) || len > 0xFFFF) {
+    status = pSTATUS_ERR;
+    return false;
+  }
+  status = pSTATUS_SET;
+  return true;
+}
+
+/*
+ * Set the trigger condition; see the 'pCAPTURE_TRIG_x' macros.
+ */
+void pCapture::set_trigger(unsigned type, uint16_t mask,
+                           uint16_t value) {
+  if (status == pSTATUS_ERR || status == pSTATUS_RUN) { return; }
+  trig_type  = type;
+  trig_mask  = mask;
+  trig_value = value & mask;
+}
+
+/*
+ * Start sampling the GPIO bank at 'rate_hz'. The capture keeps
+ * 'pre' samples from before the trigger and 'post' samples from
+ * after it (including the trigger sample itself.)
+ * Returns false if the depths don't fit in the buffer, or if the
+ * sample timer can't run that fast.
+ */
+bool pCapture::start(uint32_t rate_hz, unsigned pre, unsigned post) {
+  uint32_t psc, arr;
+  if (status == pSTATUS_ERR || !post) { return false; }
+  if ((pre + post + pCAPTURE_MARGIN) > (length / 2)) { return false; }
+  if (!pClock::tim_period(rate_hz, &psc, &arr)) { return false; }
+  if (active_capture) { active_capture->stop(); }
+  active_capture = this;
+  rate      = rate_hz;
+  pre_len   = pre;
+  post_len  = post;
+  scanned   = 0;
+  trig_abs  = 0;
+  triggered = false;
+  // Enable the DMA and timer clocks, until the capture stops.
+  pClockGate::acquire<pRCC_AHBENR::DMA1EN>();
+  pClockGate::acquire<pCAPTURE_tim_en>();
+  pCAPTURE_TIM->CR1  = 0;
+  pCAPTURE_TIM->DIER = 0;
+  pCAPTURE_TIM->PSC  = psc;
+  pCAPTURE_TIM->ARR  = arr;
+  pCAPTURE_tim::EGR::write(pTIM_EGR::UG::set());
+  pCAPTURE_TIM->SR   = 0;
+  // Configure the DMA channel: 16-bit IDR -> 16-bit buffer,
+  // circular, with half/full transfer interrupts.
+  // (The GPIO banks are 1KB apart, starting at GPIOA.)
+  GPIO_TypeDef* gpio = (GPIO_TypeDef*)(GPIOA_BASE +
+                                       (bank->get_port_index() * 0x400));
+  last_sample = gpio->IDR;
+  pDMA1_regs::IFCR::write(pCAPTURE_dma_clr::set());
+  pCAPTURE_DMA->CCR   = 0;
+  pCAPTURE_DMA->CPAR  = (uint32_t)&(gpio->IDR);
+  pCAPTURE_DMA->CMAR  = (uint32_t)buffer;
+  pCAPTURE_DMA->CNDTR = length;
+  pCAPTURE_dma::CCR::write(pDMA_CCR::MSIZE::val<1>() |
+                           pDMA_CCR::PSIZE::val<1>() |
+                           pDMA_CCR::MINC::set()     |
+                           pDMA_CCR::CIRC::set()     |
+                           pDMA_CCR::PL::val<2>()    |
+                           pDMA_CCR::HTIE::set()     |
+                           pDMA_CCR::TCIE::set());
+  NVIC_EnableIRQ(pCAPTURE_DMA_IRQn);
+  status = pSTATUS_RUN;
+  // The sample timer needs the high-speed clocks.
+  pLowPower::stop_lock();
+  pCAPTURE_dma::CCR::modify(pDMA_CCR::EN::set());
+  // Start sampling; each timer update event reads IDR once.
+  pCAPTURE_tim::DIER::write(pTIM_DIER::UDE::set());
+  pCAPTURE_tim::CR1::write(pTIM_CR1::CEN::set());
+  return true;
+}
+
+/*
+ * Stop sampling. If the trigger has not fired yet,
+ * the capture will not have any data.
+ */
+void pCapture::stop(void) {
+  if (status != pSTATUS_RUN) { return; }
+  pCAPTURE_TIM->CR1   = 0;
+  pCAPTURE_TIM->DIER  = 0;
+  pCAPTURE_dma::CCR::modify(pDMA_CCR::EN::clear());
+  pDMA1_regs::IFCR::write(pCAPTURE_dma_clr::set());
+  status = pSTATUS_SET;
+  pClockGate::release<pCAPTURE_tim_en>();
+  pClockGate::release<pRCC_AHBENR::DMA1EN>();
+  pLowPower::stop_unlock();
+  if (active_capture == this) { active_capture = NULL; }
+}
+
+/* Has the capture triggered and finished recording? */
+bool pCapture::done(void) {
+  return (status == pSTATUS_SET && triggered &&
+          scanned >= (trig_abs + post_len));
+}
+
+/* How many samples are available? (pre + post, once done) */
+unsigned pCapture::get_num_samples(void) {
+  if (!done()) { return 0; }
+  return pre_len + post_len;
+}
+
+/* Index of the trigger sample in the captured data. */
+unsigned pCapture::get_trigger_index(void) {
+  return pre_len;
+}
+
+/*
+ * Get a captured sample, in order; sample 0 is the oldest
+ * pre-trigger sample.
+ */
+uint16_t pCapture::get_sample(unsigned i) {
+  return buffer[(trig_abs - pre_len + i) % length];
+}
+
+/*
+ * Send the capture over a serial link, in the format that the
+ * 'tools/la_decode' host program reads. All values are LE:
+ *   4B: 'LACP'
+ *   1B: format version
+ *   1B: bytes per sample (2)
+ *   4B: sample rate in Hz
+ *   4B: number of samples
+ *   4B: trigger sample index
+ *   2B: trigger mask
+ *   Then, one 2-byte IDR value per sample.
+ */
+void pCapture::export_to(pIO* link) {
+  if (!link || !done()) { return; }
+  link->write(pCAPTURE_MAGIC_0);
+  link->write(pCAPTURE_MAGIC_1);
+  link->write(pCAPTURE_MAGIC_2);
+  link->write(pCAPTURE_MAGIC_3);
+  link->write(pCAPTURE_VERSION);
+  link->write(2);
+  link->write_le(rate, 4);
+  link->write_le(get_num_samples(), 4);
+  link->write_le(get_trigger_index(), 4);
+  link->write_le(trig_mask, 2);
+  for (unsigned i = 0; i < get_num_samples(); ++i) {
+    link->write_le(get_sample(i), 2);
+  }
+}
+
+/*
+ * Check a finished block of samples for the trigger condition.
+ * The trigger is only armed once 'pre' samples are recorded.
+ */
+pRAM_FUNC void pCapture::scan(unsigned start, unsigned count) {
+  if (triggered) {
+    scanned += count;
+    return;
+  }
+  for (unsigned i = start; i < (start + count); ++i) {
+    uint16_t sample = buffer[i];
+    if (!triggered && scanned >= pre_len) {
+      uint16_t masked = sample & trig_mask;
+      bool hit = false;
+      if (trig_type == pCAPTURE_TRIG_NONE) {
+        hit = true;
+      }
+      else if (trig_type == pCAPTURE_TRIG_PATTERN) {
+        hit = (masked == trig_value);
+      }
+      else if (trig_type == pCAPTURE_TRIG_ENTER) {
+        hit = (masked == trig_value &&
+               (last_sample & trig_mask) != trig_value);
+      }
+      else if (trig_type == pCAPTURE_TRIG_CHANGE) {
+        hit = ((sample ^ last_sample) & trig_mask);
+      }
+      if (hit) {
+        triggered = true;
+        trig_abs  = scanned;
+      }
+    }
+    last_sample = sample;
+    ++scanned;
+  }
+}
+
+/*
+ * DMA interrupt logic: scan whichever half of the buffer just
+ * finished, and stop once the post-trigger samples are in.
+ */
+pRAM_FUNC void pCapture::irq_handler(void) {
+  uint32_t isr = DMA1->ISR;
+  unsigned half = length / 2;
+  if (isr & pCAPTURE_DMA_HTIF) {
+    pDMA1_regs::IFCR::write(pDMA_IFCR::CHTIF<3>::set());
+    scan(0, half);
+  }
+  if (isr & pCAPTURE_DMA_TCIF) {
+    pDMA1_regs::IFCR::write(pDMA_IFCR::CTCIF<3>::set());
+    scan(half, length - half);
+  }
+  if (triggered && scanned >= (trig_abs + post_len)) {
+    stop();
+  }
+}
+
+/* Return the capture status. */
+int pCapture::get_status(void) { return status; }
+
+/*
+ * Capture DMA interrupt handler.
+ */
+extern "C" pRAM_FUNC void DMA1_chan3_IRQ_handler(void) {
+  pTRACE_ISR_ENTER();
+  if (active_capture) {
+    active_capture->irq_handler();
+  }
+  else {
+    pDMA1_regs::IFCR::write(pCAPTURE_dma_clr::set());
+  }
+  pTRACE_ISR_EXIT();
+}
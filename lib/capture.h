@@ -0,0 +1,102 @@
+#ifndef __STARm_CAPTURE_H
+#define __STARm_CAPTURE_H
+
+// Project includes.
+#include "core.h"
+#include "gpio.h"
+
+// Project macro definitions.
+// Timer and DMA channel which pace the captures.
+// (TIM3's update event is routed to DMA1 channel 3 on
+//  both the F1 and F3 lines.)
+#define pCAPTURE_TIM        (TIM3)
+#define pCAPTURE_DMA        (DMA1_Channel3)
+#define pCAPTURE_DMA_IRQn   (DMA1_Channel3_IRQn)
+#define pCAPTURE_DMA_HTIF   (DMA_ISR_HTIF3)
+#define pCAPTURE_DMA_TCIF   (DMA_ISR_TCIF3)
+// (Register descriptions for the same peripherals; see 'regs.h'.)
+typedef pTIM_regs<TIM3_BASE>               pCAPTURE_tim;
+typedef pDMA_chan_regs<DMA1_Channel3_BASE> pCAPTURE_dma;
+typedef pRCC_APB1ENR::TIM3EN               pCAPTURE_tim_en;
+typedef pDMA_IFCR::CGIF<3>                 pCAPTURE_dma_clr;
+// Trigger types.
+// 'NONE' triggers on the first sample after the pre-trigger
+// samples are filled. 'PATTERN' triggers on the first sample
+// where (sample & mask) == value. 'ENTER' triggers when the
+// masked bits change to 'value'; with a single pin in the mask,
+// that is a rising (value = mask) or falling (value = 0) edge.
+// 'CHANGE' triggers when any of the masked bits change.
+#define pCAPTURE_TRIG_NONE    (0)
+#define pCAPTURE_TRIG_PATTERN (1)
+#define pCAPTURE_TRIG_ENTER   (2)
+#define pCAPTURE_TRIG_CHANGE  (3)
+// Samples of interrupt latency to allow for before stopping.
+#define pCAPTURE_MARGIN     (8)
+// Export format identifiers.
+#define pCAPTURE_MAGIC_0    ('L')
+#define pCAPTURE_MAGIC_1    ('A')
+#define pCAPTURE_MAGIC_2    ('C')
+#define pCAPTURE_MAGIC_3    ('P')
+#define pCAPTURE_VERSION    (1)
+
+/*
+ * Logic analyzer capture class.
+ * A timer paces DMA reads of a GPIO bank's IDR register into a
+ * circular RAM buffer, so sampling is jitter-free and doesn't use
+ * the CPU. The DMA 'half transfer' and 'transfer complete'
+ * interrupts scan each finished half of the buffer for the
+ * trigger condition, and stop the capture once enough
+ * post-trigger samples have been recorded.
+ * Since the buffer is checked a half at a time,
+ * (pre + post) must be at most half of the buffer length,
+ * minus a few samples of interrupt latency.
+ * Only one capture can run at a time.
+ */
+class pCapture {
+public:
+  // Constructor; call 'init' to choose the bank and buffer.
+  constexpr pCapture() {}
+  pCapture(const pCapture&)            = delete;
+  pCapture& operator=(const pCapture&) = delete;
+  bool     init(pGPIO* gpio_bank, volatile uint16_t* buf, unsigned len);
+  // Capture control methods.
+  void     set_trigger(unsigned type, uint16_t mask, uint16_t value);
+  bool     start(uint32_t rate_hz, unsigned pre, unsigned post);
+  void     stop(void);
+  bool     done(void);
+  // Captured data access.
+  unsigned get_num_samples(void);
+  unsigned get_trigger_index(void);
+  uint16_t get_sample(unsigned i);
+  void     export_to(pIO* link);
+  // DMA interrupt logic.
+  void     irq_handler(void);
+  // Getters/setters.
+  int      get_status(void);
+protected:
+  // Capture source and buffer.
+  pGPIO*             bank   = NULL;
+  volatile uint16_t* buffer = NULL;
+  unsigned           length = 0;
+  // Trigger condition.
+  unsigned           trig_type  = pCAPTURE_TRIG_NONE;
+  uint16_t           trig_mask  = 0;
+  uint16_t           trig_value = 0;
+  // Capture settings and progress. 'Absolute' sample indices
+  // count up from the start of the capture; sample 'n' is
+  // stored at buffer[n % length].
+  uint32_t           rate       = 0;
+  unsigned           pre_len    = 0;
+  unsigned           post_len   = 0;
+  volatile uint32_t  scanned    = 0;
+  volatile uint32_t  trig_abs   = 0;
+  volatile bool      triggered  = false;
+  uint16_t           last_sample = 0;
+  // Expected status.
+  volatile int       status     = pSTATUS_ERR;
+
+  void     scan(unsigned start, unsigned count);
+private:
+};
+
+#endif
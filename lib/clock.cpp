@@ -0,0 +1,219 @@
+#include "clock.h"
+
+// FreeRTOS includes, for the tick rate.
+extern "C" {
+  #include "FreeRTOS.h"
+}
+
+// Current APB1 prescaler. (APB2 and AHB always run at /1.)
+static uint32_t  apb1_div = 1;
+// Current oscillator, and whether the PLL is used.
+static unsigned  sys_src  = pCLOCK_SRC_HSI;
+static bool      pll_used = false;
+// Drivers to notify about clock changes.
+static pIO*      listeners[pCLOCK_MAX_LISTENERS];
+
+/*
+ * Set the flash wait states for a given core clock speed.
+ * Both the F1 and F3 need 0 wait states up to 24MHz,
+ * 1 up to 48MHz, and 2 up to 72MHz.
+ */
+void pClock::set_flash_latency(uint32_t hz) {
+  uint32_t ws = 0;
+  if (hz > 48000000)      { ws = 2; }
+  else if (hz > 24000000) { ws = 1; }
+  FLASH->ACR = (FLASH->ACR & ~(FLASH_ACR_LATENCY)) |
+               (ws << FLASH_ACR_LATENCY_Pos) | FLASH_ACR_PRFTBE;
+  while ((FLASH->ACR & FLASH_ACR_LATENCY) !=
+         (ws << FLASH_ACR_LATENCY_Pos)) {};
+}
+
+/*
+ * Set the core clock speed, using either the HSI or HSE
+ * oscillator. If 'hz' is the oscillator's speed, the PLL is
+ * turned off; otherwise it must be a multiple of the PLL input
+ * (4MHz from HSI/2, 8MHz from HSE) between 2x and 16x, up to 72MHz.
+ * Returns false if the speed can't be reached.
+ * Peripherals should be idle when this is called, since their
+ * bus clocks will change underneath them.
+ */
+bool pClock::set_sysclk(uint32_t hz, unsigned src) {
+  uint32_t osc_hz = (src == pCLOCK_SRC_HSE) ? pCLOCK_HSE_HZ : pCLOCK_HSI_HZ;
+  uint32_t pll_in = (src == pCLOCK_SRC_HSE) ? pCLOCK_HSE_HZ : (pCLOCK_HSI_HZ / 2);
+  uint32_t pll_mul = 0;
+  if (!hz || hz > pCLOCK_MAX_HZ) { return false; }
+  if (hz != osc_hz) {
+    if (hz % pll_in) { return false; }
+    pll_mul = hz / pll_in;
+    if (pll_mul < 2 || pll_mul > 16) { return false; }
+  }
+  // Turn the oscillator on.
+  if (src == pCLOCK_SRC_HSE) {
+    // (This will be an infinite loop if your board doesn't have
+    //  an HSE oscillator.)
+    RCC->CR |=  (RCC_CR_HSEON);
+    while (!(RCC->CR & RCC_CR_HSERDY)) {};
+  }
+  else {
+    RCC->CR |=  (RCC_CR_HSION);
+    while (!(RCC->CR & RCC_CR_HSIRDY)) {};
+  }
+  // Add flash wait states before speeding up.
+  if (hz > sys_clock_hz) { set_flash_latency(hz); }
+  // Run directly from the oscillator while the PLL is changed.
+  // The APB1 bus is limited to 36MHz, so its prescaler is
+  // set before switching to a faster clock.
+  uint32_t sw = (src == pCLOCK_SRC_HSE) ? RCC_CFGR_SW_HSE : RCC_CFGR_SW_HSI;
+  RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_SW | RCC_CFGR_HPRE |
+                             RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2)) |
+              sw | RCC_CFGR_PPRE1_DIV2;
+  while ((RCC->CFGR & RCC_CFGR_SWS) != (sw << RCC_CFGR_SWS_Pos)) {};
+  RCC->CR &= ~(RCC_CR_PLLON);
+  while (RCC->CR & RCC_CR_PLLRDY) {};
+  apb1_div = (hz > pCLOCK_MAX_APB1_HZ) ? 2 : 1;
+  if (pll_mul) {
+    // Configure and enable the PLL, then switch to it.
+    uint32_t cfgr = RCC->CFGR & ~(RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE |
+                                  RCC_CFGR_PPRE1);
+    #if   defined(STARm_F1)
+      cfgr &= ~(RCC_CFGR_PLLMULL);
+      cfgr |=  ((pll_mul - 2) << RCC_CFGR_PLLMULL_Pos);
+    #elif defined(STARm_F3)
+      cfgr &= ~(RCC_CFGR_PLLMUL);
+      cfgr |=  ((pll_mul - 2) << RCC_CFGR_PLLMUL_Pos);
+      // (HSE / PREDIV; PREDIV is left at its reset value of /1)
+    #endif
+    if (src == pCLOCK_SRC_HSE) { cfgr |= RCC_CFGR_PLLSRC; }
+    if (apb1_div == 2)         { cfgr |= RCC_CFGR_PPRE1_DIV2; }
+    RCC->CFGR = cfgr;
+    RCC->CR  |=  (RCC_CR_PLLON);
+    while (!(RCC->CR & RCC_CR_PLLRDY)) {};
+    RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_SW)) | RCC_CFGR_SW_PLL;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL) {};
+  }
+  else {
+    RCC->CFGR &= ~(RCC_CFGR_PPRE1);
+  }
+  // Remove extra flash wait states after slowing down.
+  if (hz < sys_clock_hz) { set_flash_latency(hz); }
+  // Turn off the oscillator which is no longer used.
+  // (The F3's I2C peripherals run from HSI, so leave it on.)
+  #if   defined(STARm_F1)
+    if (src == pCLOCK_SRC_HSE) { RCC->CR &= ~(RCC_CR_HSION); }
+  #endif
+  if (src == pCLOCK_SRC_HSI) { RCC->CR &= ~(RCC_CR_HSEON); }
+  sys_clock_hz = hz;
+  sys_src      = src;
+  pll_used     = (pll_mul != 0);
+  // If the RTOS tick is running, re-calculate its period.
+  if (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) {
+    SysTick->LOAD = (configSYSTICK_CLOCK_HZ / configTICK_RATE_HZ) - 1;
+    SysTick->VAL  = 0;
+  }
+  notify();
+  return true;
+}
+
+/*
+ * Restore the system clock after waking up from STOP mode.
+ * The chip always wakes up running from HSI with the PLL and
+ * HSE turned off, but the PLL settings, bus prescalers, and
+ * flash wait states are all kept; so the oscillators only need
+ * to be restarted, and the speeds do not change.
+ */
+void pClock::resume_after_stop(void) {
+  if (sys_src == pCLOCK_SRC_HSE) {
+    RCC->CR |=  (RCC_CR_HSEON);
+    while (!(RCC->CR & RCC_CR_HSERDY)) {};
+  }
+  if (pll_used) {
+    RCC->CR |=  (RCC_CR_PLLON);
+    while (!(RCC->CR & RCC_CR_PLLRDY)) {};
+    RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_SW)) | RCC_CFGR_SW_PLL;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL) {};
+  }
+  else if (sys_src == pCLOCK_SRC_HSE) {
+    RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_SW)) | RCC_CFGR_SW_HSE;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSE) {};
+  }
+}
+
+/*
+ * Register a driver to be notified when the clocks change.
+ * Returns false if there is no room left.
+ */
+bool pClock::add_listener(pIO* dev) {
+  for (int i = 0; i < pCLOCK_MAX_LISTENERS; ++i) {
+    if (listeners[i] == dev) { return true; }
+  }
+  for (int i = 0; i < pCLOCK_MAX_LISTENERS; ++i) {
+    if (!listeners[i]) {
+      listeners[i] = dev;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Stop notifying a driver about clock changes. */
+void pClock::remove_listener(pIO* dev) {
+  for (int i = 0; i < pCLOCK_MAX_LISTENERS; ++i) {
+    if (listeners[i] == dev) { listeners[i] = NULL; }
+  }
+}
+
+/* Call every registered driver's 'clock_update' method. */
+void pClock::notify(void) {
+  for (int i = 0; i < pCLOCK_MAX_LISTENERS; ++i) {
+    if (listeners[i]) { listeners[i]->clock_update(); }
+  }
+}
+
+/* Getters. */
+// Core clock.
+uint32_t pClock::get_sysclk_hz(void) { return sys_clock_hz; }
+// AHB bus clock. (No AHB prescaler is used.)
+uint32_t pClock::get_hclk_hz(void)   { return sys_clock_hz; }
+// APB1 bus clock.
+uint32_t pClock::get_pclk1_hz(void)  { return sys_clock_hz / apb1_div; }
+// APB2 bus clock. (No APB2 prescaler is used.)
+uint32_t pClock::get_pclk2_hz(void)  { return sys_clock_hz; }
+// Timers on APB1 run at 2x the bus clock if it is divided.
+uint32_t pClock::get_tim_apb1_hz(void) {
+  return (apb1_div == 1) ? get_pclk1_hz() : (get_pclk1_hz() * 2);
+}
+// Timers on APB2.
+uint32_t pClock::get_tim_apb2_hz(void) { return get_pclk2_hz(); }
+// Clock which a U(S)ART's baud rate is divided from. On the F1,
+// USART1 uses APB2 and the rest use APB1. On the F3, USART1 has
+// its own clock switch, which selects PCLK1 after a reset.
+uint32_t pClock::get_usart_hz(uint32_t usart_base) {
+  #if   defined(STARm_F1)
+    return (usart_base == USART1_BASE) ? get_pclk2_hz() : get_pclk1_hz();
+  #elif defined(STARm_F3)
+    if (usart_base != USART1_BASE) { return get_pclk1_hz(); }
+    switch (RCC->CFGR3 & RCC_CFGR3_USART1SW) {
+      case RCC_CFGR3_USART1SW_SYSCLK: return get_sysclk_hz();
+      case RCC_CFGR3_USART1SW_LSE:    return 32768;
+      case RCC_CFGR3_USART1SW_HSI:    return pCLOCK_HSI_HZ;
+      default:                        return get_pclk1_hz();
+    }
+  #endif
+}
+
+/*
+ * Calculate the prescaler and auto-reload values which make a
+ * timer on APB1 raise 'rate_hz' update events per second, using
+ * the prescaler if the period needs more than 16 bits.
+ * Returns false if the rate is too high: with a period of one
+ * tick, ARR would be 0, and the counter would never update.
+ */
+bool pClock::tim_period(uint32_t rate_hz,
+                        uint32_t* psc, uint32_t* arr) {
+  if (!rate_hz) { return false; }
+  uint32_t ticks = get_tim_apb1_hz() / rate_hz;
+  if (ticks < 2) { return false; }
+  *psc = (ticks - 1) / 0x10000;
+  *arr = (ticks / (*psc + 1)) - 1;
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef __STARm_CLOCK_H
+#define __STARm_CLOCK_H
+
+// Project includes.
+#include "core.h"
+
+// Project macro definitions.
+// Oscillator sources.
+#define pCLOCK_SRC_HSI       (0)
+#define pCLOCK_SRC_HSE       (1)
+// Oscillator speeds.
+#define pCLOCK_HSI_HZ        (8000000)
+#define pCLOCK_HSE_HZ        (8000000)
+// Maximum core and APB1 bus speeds.
+#define pCLOCK_MAX_HZ        (72000000)
+#define pCLOCK_MAX_APB1_HZ   (36000000)
+// Maximum number of drivers to notify about clock changes.
+#define pCLOCK_MAX_LISTENERS (8)
+// Default oscillator and speed for each chip.
+// (Most cheap F103C8 boards have an 8MHz HSE crystal, but the
+//  'Nucleo-32' F303K8 boards do not; HSI/2 * 16 = 64MHz.)
+#if   defined(STARm_F1)
+  #define pCLOCK_DEFAULT_SRC (pCLOCK_SRC_HSE)
+  #define pCLOCK_DEFAULT_HZ  (72000000)
+#elif defined(STARm_F3)
+  #define pCLOCK_DEFAULT_SRC (pCLOCK_SRC_HSI)
+  #define pCLOCK_DEFAULT_HZ  (64000000)
+#endif
+
+/*
+ * Clock tree manager.
+ * This configures the system clock from the HSI or HSE
+ * oscillator, with the PLL if the requested speed is higher than
+ * the oscillator's. Flash wait states and bus prescalers are set
+ * to match, and the core/bus speeds are recorded so that drivers
+ * can calculate their own timing values.
+ * The speed can be changed while the program runs; after each
+ * change, the RTOS tick is re-calculated and every registered
+ * driver's 'clock_update' method is called.
+ * This is a static class; there is only one RCC peripheral.
+ */
+class pClock {
+public:
+  // Clock configuration.
+  static bool     set_sysclk(uint32_t hz, unsigned src);
+  static void     resume_after_stop(void);
+  // Registered drivers.
+  static bool     add_listener(pIO* dev);
+  static void     remove_listener(pIO* dev);
+  // Current speeds, in Hz.
+  static uint32_t get_sysclk_hz(void);
+  static uint32_t get_hclk_hz(void);
+  static uint32_t get_pclk1_hz(void);
+  static uint32_t get_pclk2_hz(void);
+  static uint32_t get_tim_apb1_hz(void);
+  static uint32_t get_tim_apb2_hz(void);
+  static uint32_t get_usart_hz(uint32_t usart_base);
+  // Timer settings for an update rate.
+  static bool     tim_period(uint32_t rate_hz,
+                             uint32_t* psc, uint32_t* arr);
+protected:
+  static void     set_flash_latency(uint32_t hz);
+  static void     notify(void);
+private:
+};
+
+#endif
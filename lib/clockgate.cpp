@@ -0,0 +1,124 @@
+#include "clockgate.h"
+
+// Managed clock enable registers, and their names for reports.
+#define pCLOCKGATE_NUM_REGS (3)
+static const char* const reg_names[pCLOCKGATE_NUM_REGS] = {
+  "AHBENR", "APB1ENR", "APB2ENR"
+};
+// Number of users of each clock enable bit.
+static uint8_t users[pCLOCKGATE_NUM_REGS][32];
+
+/*
+ * Find a managed register's index; returns -1 for others.
+ */
+int pClockGate::reg_index(__IO uint32_t* reg) {
+  if (reg == pRCC_regs::AHBENR::ptr())  { return 0; }
+  if (reg == pRCC_regs::APB1ENR::ptr()) { return 1; }
+  if (reg == pRCC_regs::APB2ENR::ptr()) { return 2; }
+  return -1;
+}
+
+/*
+ * Add a user to each clock in 'bit', turning on the ones
+ * which were not used yet.
+ */
+bool pClockGate::acquire(__IO uint32_t* reg, uint32_t bit) {
+  if (!reg || !bit) { return false; }
+  int ri = reg_index(reg);
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (ri < 0) {
+    *reg |= bit;
+    __set_PRIMASK(primask);
+    return false;
+  }
+  uint32_t turn_on = 0;
+  for (uint32_t bits = bit; bits; bits &= (bits - 1)) {
+    unsigned b = __builtin_ctz(bits);
+    if (users[ri][b] == 0)   { turn_on |= (1 << b); }
+    // (A count which reaches the limit stays there, so the
+    //  clock is never turned off from under a user.)
+    if (users[ri][b] < 0xFF) { ++users[ri][b]; }
+  }
+  if (turn_on) {
+    *reg |= turn_on;
+    // Read the register back; the peripheral can only be used
+    // a couple of bus cycles after its clock is turned on.
+    (void)*reg;
+  }
+  __set_PRIMASK(primask);
+  return true;
+}
+
+/*
+ * Remove a user from each clock in 'bit', turning off
+ * the ones which are no longer used.
+ */
+void pClockGate::release(__IO uint32_t* reg, uint32_t bit) {
+  if (!reg || !bit) { return; }
+  int ri = reg_index(reg);
+  if (ri < 0) { return; }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t turn_off = 0;
+  for (uint32_t bits = bit; bits; bits &= (bits - 1)) {
+    unsigned b = __builtin_ctz(bits);
+    if (users[ri][b] == 0 || users[ri][b] == 0xFF) { continue; }
+    if (--users[ri][b] == 0) { turn_off |= (1 << b); }
+  }
+  if (turn_off) { *reg &= ~(turn_off); }
+  __set_PRIMASK(primask);
+}
+
+/* Number of users of a clock. (The lowest bit, if several.) */
+unsigned pClockGate::get_users(__IO uint32_t* reg, uint32_t bit) {
+  int ri = reg_index(reg);
+  if (ri < 0 || !bit) { return 0; }
+  return users[ri][__builtin_ctz(bit)];
+}
+
+/* Write a string to the link. */
+void pClockGate::print(pIO* link, const char* str) {
+  while (*str) { link->write(*str++); }
+}
+
+/* Write an unsigned value to the link, in decimal. */
+void pClockGate::print_uint(pIO* link, unsigned val) {
+  char digits[11];
+  int n = 0;
+  do {
+    digits[n++] = '0' + (val % 10);
+    val /= 10;
+  } while (val);
+  while (n) { link->write(digits[--n]); }
+}
+
+/*
+ * Print every clock which is turned on, with its number of
+ * users. Clocks which were turned on without the manager, like
+ * the ones which are on after a reset, are marked with '-':
+ *   // Peripheral clocks: register, bit, users.
+ *   APB1ENR 21 1
+ *   AHBENR 4 -
+ */
+void pClockGate::report(pIO* link) {
+  if (!link) { return; }
+  print(link, "// Peripheral clocks: register, bit, users.\r\n");
+  for (int ri = 0; ri < pCLOCKGATE_NUM_REGS; ++ri) {
+    __IO uint32_t* reg = (ri == 0) ? pRCC_regs::AHBENR::ptr() :
+                         (ri == 1) ? pRCC_regs::APB1ENR::ptr() :
+                                     pRCC_regs::APB2ENR::ptr();
+    uint32_t on = *reg;
+    for (unsigned b = 0; b < 32; ++b) {
+      if (!(on & (1 << b))) { continue; }
+      print(link, reg_names[ri]);
+      print(link, " ");
+      print_uint(link, b);
+      print(link, " ");
+      if (users[ri][b]) { print_uint(link, users[ri][b]); }
+      else              { print(link, "-"); }
+      print(link, "\r\n");
+    }
+  }
+  link->flush();
+}
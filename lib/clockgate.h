@@ -0,0 +1,56 @@
+#ifndef __STARm_CLOCKGATE_H
+#define __STARm_CLOCKGATE_H
+
+// Project includes.
+#include "core.h"
+
+/*
+ * Reference-counted peripheral clock gating.
+ * Each peripheral clock enable bit in 'AHBENR', 'APB1ENR' and
+ * 'APB2ENR' has a count of the drivers which are using it. The
+ * clock is turned on when the count goes from 0 to 1, and off
+ * when it goes back to 0; so two drivers which share a peripheral,
+ * like two 'pGPIO' objects for the same bank or the timed GPIO
+ * streams and logic analyzer captures which share DMA1, can not
+ * turn the clock off underneath each other.
+ * Every 'acquire' must be matched by one 'release'. The 'pIO'
+ * class does this in 'clock_en' / 'disable', and holds at most
+ * one reference per object, however many times they are called.
+ * Drivers which go idle between transfers can release their
+ * clock while idle; the peripheral keeps its register values
+ * while its clock is off, but can not be written to.
+ * These methods can be called from interrupt handlers.
+ * This is a static class; there is only one RCC peripheral.
+ */
+class pClockGate {
+public:
+  // Start or stop using a peripheral clock; 'bit' is its enable
+  // bit in 'reg'. Clocks in other registers are just turned on,
+  // and never off; 'acquire' returns false for those.
+  static bool     acquire(__IO uint32_t* reg, uint32_t bit);
+  static void     release(__IO uint32_t* reg, uint32_t bit);
+  // The same, with a clock enable field from 'regs.h'. Like:
+  //   pClockGate::acquire<pRCC_AHBENR::DMA1EN>();
+  template<typename F>
+  static bool     acquire(void) {
+    return acquire(reg_of((typename F::layout*)NULL), F::mask);
+  }
+  template<typename F>
+  static void     release(void) {
+    release(reg_of((typename F::layout*)NULL), F::mask);
+  }
+  // Number of users of a clock.
+  static unsigned get_users(__IO uint32_t* reg, uint32_t bit);
+  // Print the clocks which are turned on to a serial link.
+  static void     report(pIO* link);
+protected:
+  static __IO uint32_t* reg_of(pRCC_AHBENR*)  { return pRCC_regs::AHBENR::ptr(); }
+  static __IO uint32_t* reg_of(pRCC_APB1ENR*) { return pRCC_regs::APB1ENR::ptr(); }
+  static __IO uint32_t* reg_of(pRCC_APB2ENR*) { return pRCC_regs::APB2ENR::ptr(); }
+  static int      reg_index(__IO uint32_t* reg);
+  static void     print(pIO* link, const char* str);
+  static void     print_uint(pIO* link, unsigned val);
+private:
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "core.h"
+#include "clockgate.h"
 
 // Define starting values for the main system clock.
 // (Core clock speed when the chip first boots, in Hz.)
@@ -8,9 +9,6 @@
   volatile uint32_t sys_clock_hz = 2000000;
 #endif
 
-/* Common Input/Output class default constructor. */
-pIO::pIO() {}
-
 /*
  * Default virtual read/write methods for the common I/O class.
  * Most of these methods don't have a default behavior, but I
@@ -25,10 +23,22 @@ void pIO::write(unsigned dat) {}
 // Write multiple words to the peripheral in a stream.
 void pIO::stream(volatile void* buf, int len) {}
 
+// Write a value one byte at a time, lowest byte first; for
+// binary reports to host-side tools.
+void pIO::write_le(uint32_t val, unsigned nbytes) {
+  for (unsigned i = 0; i < nbytes; ++i) {
+    write((val >> (i * 8)) & 0xFF);
+  }
+}
+
+// Wait for buffered output to finish sending.
+// (Most peripherals don't buffer any.)
+void pIO::flush(void) {}
+
 // Enable the peripheral clock.
 void pIO::clock_en(void) {
   if (status == pSTATUS_ERR) { return; }
-  *enable_reg |= enable_bit;
+  clock_hold(true);
   status = pSTATUS_ON;
 }
 
@@ -39,13 +49,27 @@ void pIO::reset(void) {
   *reset_reg &= ~(reset_bit);
 }
 
-// Turn the peripheral off.
+// Turn the peripheral off. (Its clock stays on if another
+// driver is still using it.)
 void pIO::disable(void) {
   if (status == pSTATUS_ERR) { return; }
-  *enable_reg &= ~(enable_bit);
+  clock_hold(false);
   status = pSTATUS_SET;
 }
 
+// Take or give up this object's single reference on its
+// peripheral clock, without changing its status.
+void pIO::clock_hold(bool on) {
+  if (status == pSTATUS_ERR || on == clock_held) { return; }
+  if (on) { pClockGate::acquire(enable_reg, enable_bit); }
+  else    { pClockGate::release(enable_reg, enable_bit); }
+  clock_held = on;
+}
+
+// Re-calculate any clock-dependent settings.
+// (Most peripherals don't have any.)
+void pIO::clock_update(void) {}
+
 // Return the current peripheral status,
 // as far as the library knows.
 int pIO::get_status(void) { return status; }
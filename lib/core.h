@@ -14,7 +14,7 @@
 #endif
 
 // Project includes.
-#include "register_macros.h"
+#include "regs.h"
 
 // Global macro definitions.
 #define pSTATUS_ERR (0)
@@ -22,8 +22,38 @@
 #define pSTATUS_ON  (2)
 #define pSTATUS_RUN (3)
 
+// Memory placement. The F303's 4KB CCM RAM is only connected to
+// the CPU, so it has no wait states and never competes with DMA
+// for the bus; but DMA can not read or write it, so do not put
+// DMA buffers there. The startup code copies 'pCCM_DATA' values
+// (and 'pRAM_FUNC' functions) from flash, and zeroes 'pCCM_BSS'.
+// On chips without CCM RAM, these use the normal sections.
+// ('pCCM_BSS' is never loaded from flash, so objects placed
+//  there must be zero-initialized; for example, ones with
+//  'constexpr' constructors and no virtual methods.)
+#if defined(STARm_F3)
+  #define pCCM_DATA __attribute__((section(".ccmram_data")))
+  #define pCCM_BSS  __attribute__((section(".ccmram_bss")))
+#else
+  #define pCCM_DATA
+  #define pCCM_BSS
+#endif
+// Run a function from RAM instead of flash. At 72MHz, the F103's
+// flash needs 2 wait states; the prefetch buffer hides them for
+// straight-line code, but every taken branch stalls. Use this for
+// interrupt handlers and tight inner loops. The '.ramfunc' section
+// is part of '.data' on the F1, and of the CCM RAM on the F3, so
+// the startup code copies it from flash. Build with 'NO_RAMFUNC=1'
+// to leave these functions in flash, for comparison.
+#ifdef NO_RAMFUNC
+  #define pRAM_FUNC
+#else
+  #define pRAM_FUNC __attribute__((section(".ramfunc"), noinline))
+#endif
+
 // System clock speed; initial value depends on the chip.
-extern volatile uint32_t sys_clock_hz;
+// (C linkage, because FreeRTOS reads it as 'configCPU_CLOCK_HZ'.)
+extern "C" volatile uint32_t sys_clock_hz;
 
 // Class declarations for basic structures common
 // to many peripherals.
@@ -33,16 +63,29 @@ extern volatile uint32_t sys_clock_hz;
  */
 class pIO {
 public:
-  pIO();
+  // Peripheral objects are constant-initialized, so they need no
+  // start-up code, and then set up in place with 'init' methods.
+  // They hold hardware state, so they can not be copied.
+  constexpr pIO() {}
+  pIO(const pIO&)            = delete;
+  pIO& operator=(const pIO&) = delete;
   // Common read/write methods.
   virtual unsigned read(void);
   virtual void     write(unsigned dat);
   virtual void     stream(volatile void* buf, int len);
+  // Write the low 'nbytes' bytes of a value, little-endian.
+  void             write_le(uint32_t val, unsigned nbytes = 4);
+  // Wait until everything written has been sent.
+  virtual void     flush(void);
   // Common peripheral control methods.
+  // ('clock_en' and 'disable' take and give up this object's
+  //  reference on the peripheral clock; see 'clockgate.h'.)
   virtual void     clock_en(void);
   virtual void     reset(void);
   virtual void     disable(void);
   virtual int      get_status(void);
+  // Called by the clock manager after the bus clocks change.
+  virtual void     clock_update(void);
 protected:
   // Expected peripheral status.
   int status = pSTATUS_ERR;
@@ -51,6 +94,9 @@ protected:
   __IO uint32_t *reset_reg  = 0;
   uint32_t       enable_bit = 0;
   uint32_t       reset_bit  = 0;
+  // Does this object hold a reference on its peripheral clock?
+  bool           clock_held = false;
+  void             clock_hold(bool on);
 private:
 };
 
@@ -0,0 +1,262 @@
+#include "dsp.h"
+
+/*
+ * Saturate a 32-bit value to the signed 16-bit range.
+ */
+static inline int16_t sat16(int32_t v) {
+  return (int16_t)__SSAT(v, 16);
+}
+
+/*
+ * FIR filter default constructor.
+ */
+pFIR::pFIR() {}
+
+/*
+ * Basic FIR filter constructor; set the taps and delay line.
+ */
+pFIR::pFIR(const int16_t* coeffs, int16_t* state, unsigned ntaps) {
+  taps  = coeffs;
+  delay = state;
+  len   = ntaps;
+  if (!coeffs || !state || !ntaps) {
+    status = pSTATUS_ERR;
+    return;
+  }
+  reset();
+  status = pSTATUS_SET;
+}
+
+/*
+ * Clear the filter's delay line.
+ */
+void pFIR::reset(void) {
+  if (!delay) { return; }
+  memset(delay, 0, len * 2 * sizeof(int16_t));
+  pos = 0;
+}
+
+/*
+ * Filter one sample.
+ * The delay line is written 'backwards', so the window starting
+ * at 'pos' holds x[n], x[n-1], ... in the same order as the taps.
+ */
+int16_t pFIR::step(int16_t x) {
+  if (status == pSTATUS_ERR) { return 0; }
+  pos = (pos == 0) ? (len - 1) : (pos - 1);
+  delay[pos]       = x;
+  delay[pos + len] = x;
+  return sat16(pDSP::dot(taps, &delay[pos], len) >> 15);
+}
+
+/*
+ * Filter a block of 'n' samples. 'in' and 'out' may be the
+ * same buffer.
+ */
+void pFIR::process(const int16_t* in, int16_t* out, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) {
+    out[i] = step(in[i]);
+  }
+}
+
+/* Return the filter status. */
+int pFIR::get_status(void) { return status; }
+
+/*
+ * Biquad filter default constructor.
+ */
+pBiquad::pBiquad() {}
+
+/*
+ * Basic biquad filter constructor; pack the Q14 coefficients.
+ */
+pBiquad::pBiquad(const int16_t* coeffs) {
+  if (!coeffs || coeffs[3] == -32768) {
+    status = pSTATUS_ERR;
+    return;
+  }
+  k_b0b1 = ((uint16_t)coeffs[0]) | ((uint32_t)(uint16_t)coeffs[1] << 16);
+  k_b2a1 = ((uint16_t)coeffs[2]) |
+           ((uint32_t)(uint16_t)(-coeffs[3]) << 16);
+  k_a2   = -coeffs[4];
+  reset();
+  status = pSTATUS_SET;
+}
+
+/*
+ * Clear the filter's previous inputs and outputs.
+ */
+void pBiquad::reset(void) {
+  x1 = x2 = 0;
+  y1 = y2 = 0;
+}
+
+/*
+ * Filter one sample.
+ */
+int16_t pBiquad::step(int16_t x) {
+  if (status == pSTATUS_ERR) { return 0; }
+  int32_t acc;
+  #if   defined(STARm_F3)
+    // Two dual 16x16 multiply-accumulates, plus one more.
+    acc = (int32_t)__SMUAD(k_b0b1, __PKHBT(x, x1, 16));
+    acc = (int32_t)__SMLAD(k_b2a1, __PKHBT(x2, y1, 16), acc);
+    acc += k_a2 * y2;
+  #elif STARm_F1
+    acc  = (int16_t)(k_b0b1 & 0xFFFF) * x;
+    acc += (int16_t)(k_b0b1 >> 16)    * x1;
+    acc += (int16_t)(k_b2a1 & 0xFFFF) * x2;
+    acc += (int16_t)(k_b2a1 >> 16)    * y1;
+    acc += k_a2 * y2;
+  #endif
+  int16_t y = sat16(acc >> 14);
+  x2 = x1;
+  x1 = x;
+  y2 = y1;
+  y1 = y;
+  return y;
+}
+
+/*
+ * Filter a block of 'n' samples. 'in' and 'out' may be the
+ * same buffer.
+ */
+void pBiquad::process(const int16_t* in, int16_t* out, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) {
+    out[i] = step(in[i]);
+  }
+}
+
+/* Return the filter status. */
+int pBiquad::get_status(void) { return status; }
+
+/*
+ * Moving average default constructor.
+ */
+pMovingAvg::pMovingAvg() {}
+
+/*
+ * Basic moving average constructor; set the window buffer.
+ */
+pMovingAvg::pMovingAvg(int16_t* window, unsigned window_len) {
+  win = window;
+  len = window_len;
+  if (!window || !window_len) {
+    status = pSTATUS_ERR;
+    return;
+  }
+  reset();
+  status = pSTATUS_SET;
+}
+
+/*
+ * Empty the averaging window.
+ */
+void pMovingAvg::reset(void) {
+  pos   = 0;
+  count = 0;
+  sum   = 0;
+}
+
+/*
+ * Add a sample, and return the average of the window.
+ * Until the window fills up, only the samples so far are used.
+ */
+int16_t pMovingAvg::step(int16_t x) {
+  if (status == pSTATUS_ERR) { return 0; }
+  if (count == len) { sum -= win[pos]; }
+  else              { ++count; }
+  win[pos] = x;
+  sum += x;
+  if (++pos == len) { pos = 0; }
+  return (int16_t)(sum / (int32_t)count);
+}
+
+/*
+ * Average a block of 'n' samples. 'in' and 'out' may be the
+ * same buffer.
+ */
+void pMovingAvg::process(const int16_t* in, int16_t* out, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) {
+    out[i] = step(in[i]);
+  }
+}
+
+/* Return the filter status. */
+int pMovingAvg::get_status(void) { return status; }
+
+/*
+ * Find the smallest and largest samples in a buffer.
+ */
+void pDSP::min_max(const int16_t* buf, unsigned n,
+                   int16_t* min, int16_t* max) {
+  if (!n) { return; }
+  int16_t lo = buf[0];
+  int16_t hi = buf[0];
+  unsigned i = 0;
+  #if   defined(STARm_F3)
+    // Track two lanes at once; 'SSUB16' sets a 'GE' flag for
+    // each lane, and 'SEL' picks each lane based on its flag.
+    if (n >= 2) {
+      uint32_t lo2 = read_pair(buf);
+      uint32_t hi2 = lo2;
+      for (i = 2; (i + 1) < n; i += 2) {
+        uint32_t v = read_pair(&buf[i]);
+        __SSUB16(v, lo2);
+        lo2 = __SEL(lo2, v);
+        __SSUB16(v, hi2);
+        hi2 = __SEL(v, hi2);
+      }
+      int16_t l0 = (int16_t)(lo2 & 0xFFFF), l1 = (int16_t)(lo2 >> 16);
+      int16_t h0 = (int16_t)(hi2 & 0xFFFF), h1 = (int16_t)(hi2 >> 16);
+      lo = (l0 < l1) ? l0 : l1;
+      hi = (h0 > h1) ? h0 : h1;
+    }
+  #endif
+  // (Leftover sample, or every sample on the F1.)
+  for (; i < n; ++i) {
+    if (buf[i] < lo) { lo = buf[i]; }
+    if (buf[i] > hi) { hi = buf[i]; }
+  }
+  if (min) { *min = lo; }
+  if (max) { *max = hi; }
+}
+
+/*
+ * Add two buffers, saturating instead of wrapping around.
+ * 'out' may be the same buffer as 'a' or 'b'.
+ */
+void pDSP::add_sat(const int16_t* a, const int16_t* b,
+                   int16_t* out, unsigned n) {
+  unsigned i = 0;
+  #if   defined(STARm_F3)
+    for (; (i + 1) < n; i += 2) {
+      write_pair(&out[i], __QADD16(read_pair(&a[i]), read_pair(&b[i])));
+    }
+  #endif
+  for (; i < n; ++i) {
+    out[i] = sat16((int32_t)a[i] + b[i]);
+  }
+}
+
+/*
+ * Sum of products of two buffers, as a Q30 value.
+ * The caller is responsible for making sure that the sum fits
+ * in 32 bits; for Q15 values, the sum of the absolute values of
+ * one buffer should be at most 1.0.
+ */
+int32_t pDSP::dot(const int16_t* a, const int16_t* b, unsigned n) {
+  int32_t acc = 0;
+  unsigned i = 0;
+  #if   defined(STARm_F3)
+    // Four products per loop, with two dual multiply-accumulates.
+    for (; (i + 3) < n; i += 4) {
+      acc = (int32_t)__SMLAD(read_pair(&a[i]),     read_pair(&b[i]),     acc);
+      acc = (int32_t)__SMLAD(read_pair(&a[i + 2]), read_pair(&b[i + 2]), acc);
+    }
+  #endif
+  for (; i < n; ++i) {
+    acc += (int32_t)a[i] * b[i];
+  }
+  return acc;
+}
@@ -0,0 +1,149 @@
+#ifndef __STARm_DSP_H
+#define __STARm_DSP_H
+
+#include <string.h>
+
+// Project includes.
+#include "core.h"
+
+/*
+ * Fixed-point signal processing kernels.
+ * Samples are signed 16-bit 'Q15' values, which is what most
+ * ADCs and I2C/SPI sensors produce after a shift.
+ * On the F303, the kernels use the Cortex-M4 'SIMD' instructions
+ * from 'core_cmSimd.h', which operate on two 16-bit values packed
+ * into one 32-bit register. The F103's Cortex-M3 core doesn't
+ * have those instructions, so it uses plain C loops instead.
+ *
+ * Estimated cycle counts, worked out from the Cortex-M3/M4
+ * instruction timings with '-Os' and zero flash wait states;
+ * these are not measurements. Add about 10-30% at 72MHz with 2
+ * wait states, depending on the prefetch buffer. For measured
+ * numbers, run 'make bench' and look at the 'dsp_' cases.
+ *   Kernel             | F303 (SIMD)        | F103 (C)
+ *   -------------------|--------------------|-------------------
+ *   pFIR::step         | 25 + 2.5 per tap   | 20 + 7 per tap
+ *   pBiquad::step      | 22                 | 32
+ *   pMovingAvg::step   | 18                 | 18
+ *   pDSP::min_max      | 10 + 2.5 per sample| 10 + 8 per sample
+ *   pDSP::add_sat      | 10 + 3.5 per sample| 10 + 9 per sample
+ *   pDSP::dot          | 10 + 2.5 per sample| 10 + 7 per sample
+ * The 'process' methods cost about 'n * step' plus 10 cycles.
+ */
+
+/*
+ * Finite Impulse Response filter.
+ * 'coeffs' are the Q15 filter taps, b[0] first. The sum of their
+ * absolute values must be at most 1.0 (32767), so that the
+ * accumulator cannot overflow. 'state' must have room for
+ * (2 * ntaps) samples; keeping two copies of the delay line
+ * means that the newest 'ntaps' samples are always contiguous.
+ * Both arrays are owned by the caller.
+ */
+class pFIR {
+public:
+  // Constructors.
+  pFIR();
+  pFIR(const int16_t* coeffs, int16_t* state, unsigned ntaps);
+  // Filter methods.
+  int16_t  step(int16_t x);
+  void     process(const int16_t* in, int16_t* out, unsigned n);
+  void     reset(void);
+  // Getters/setters.
+  int      get_status(void);
+protected:
+  const int16_t* taps  = NULL;
+  int16_t*       delay = NULL;
+  unsigned       len   = 0;
+  unsigned       pos   = 0;
+  // Expected status.
+  int            status = pSTATUS_ERR;
+private:
+};
+
+/*
+ * Second-order Infinite Impulse Response filter section.
+ * Coefficients are Q14 values (-2.0 to 2.0), in the usual
+ * 'Direct Form I' layout: { b0, b1, b2, a1, a2 }, where
+ *   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2]
+ *                  - a1*y[n-1] - a2*y[n-2]
+ * 'a1' cannot be exactly -2.0. Higher-order filters can be made
+ * by passing samples through several sections in a row.
+ */
+class pBiquad {
+public:
+  // Constructors.
+  pBiquad();
+  pBiquad(const int16_t* coeffs);
+  // Filter methods.
+  int16_t  step(int16_t x);
+  void     process(const int16_t* in, int16_t* out, unsigned n);
+  void     reset(void);
+  // Getters/setters.
+  int      get_status(void);
+protected:
+  // Coefficients, packed in pairs for 'SMLAD':
+  // (b0, b1), (b2, -a1), and -a2 on its own.
+  uint32_t k_b0b1  = 0;
+  uint32_t k_b2a1  = 0;
+  int32_t  k_a2    = 0;
+  // Previous inputs and outputs.
+  int16_t  x1 = 0, x2 = 0;
+  int16_t  y1 = 0, y2 = 0;
+  // Expected status.
+  int      status = pSTATUS_ERR;
+private:
+};
+
+/*
+ * Moving average over the last 'len' samples.
+ * 'window' must have room for 'len' samples, and is owned
+ * by the caller. A running sum is kept, so the cost does not
+ * depend on the window length.
+ */
+class pMovingAvg {
+public:
+  // Constructors.
+  pMovingAvg();
+  pMovingAvg(int16_t* window, unsigned window_len);
+  // Filter methods.
+  int16_t  step(int16_t x);
+  void     process(const int16_t* in, int16_t* out, unsigned n);
+  void     reset(void);
+  // Getters/setters.
+  int      get_status(void);
+protected:
+  int16_t* win   = NULL;
+  unsigned len   = 0;
+  unsigned pos   = 0;
+  unsigned count = 0;
+  int32_t  sum   = 0;
+  // Expected status.
+  int      status = pSTATUS_ERR;
+private:
+};
+
+/*
+ * Block operations on Q15 sample buffers.
+ * This is a static class, like 'pClock'.
+ */
+class pDSP {
+public:
+  static void    min_max(const int16_t* buf, unsigned n,
+                         int16_t* min, int16_t* max);
+  static void    add_sat(const int16_t* a, const int16_t* b,
+                         int16_t* out, unsigned n);
+  static int32_t dot(const int16_t* a, const int16_t* b, unsigned n);
+  // Read two packed samples; the pointer does not need to be
+  // word-aligned. (A 4-byte 'memcpy' becomes a single 'LDR'.)
+  static inline uint32_t read_pair(const int16_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+  }
+  static inline void write_pair(int16_t* p, uint32_t v) {
+    memcpy(p, &v, 4);
+  }
+};
+
+#endif
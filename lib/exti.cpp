@@ -0,0 +1,250 @@
+#include "exti.h"
+#include "gpio.h"
+#include "rtos.h"
+#include "trace.h"
+
+// FreeRTOS includes.
+extern "C" {
+  #include "FreeRTOS.h"
+  #include "task.h"
+}
+
+/*
+ * Per-line binding information.
+ */
+struct pEXTI_line {
+  pGPIO_pin*     pin;
+  pEXTI_callback cb;
+  void*          arg;
+  unsigned       edge;
+  TickType_t     debounce;
+  TickType_t     armed_at;
+  bool           last_state;
+};
+
+// Line bindings, indexed by EXTI line / pin number.
+static pEXTI_line exti_lines[pEXTI_NUM_LINES];
+// Mask of lines which are waiting for a debounce period to end.
+static uint32_t     debounce_pending = 0;
+// Mask of lines which use a debounce period.
+static uint32_t     debounce_lines   = 0;
+// Deferred handler task.
+static TaskHandle_t exti_task        = NULL;
+static pRTOS_RAM pTask<pEXTI_TASK_STACK> exti_task_mem;
+
+/*
+ * Return the NVIC interrupt which serves a given EXTI line.
+ */
+static IRQn_Type exti_irqn(unsigned line) {
+  if (line == 0)       { return EXTI0_IRQn; }
+  else if (line == 1)  { return EXTI1_IRQn; }
+  #if   defined(STARm_F3)
+    else if (line == 2) { return EXTI2_TSC_IRQn; }
+  #elif STARm_F1
+    else if (line == 2) { return EXTI2_IRQn; }
+  #endif
+  else if (line == 3)  { return EXTI3_IRQn; }
+  else if (line == 4)  { return EXTI4_IRQn; }
+  else if (line < 10)  { return EXTI9_5_IRQn; }
+  return EXTI15_10_IRQn;
+}
+
+/*
+ * Bind a GPIO pin to its EXTI line, and enable the interrupt.
+ * The line is routed to the pin's GPIO bank, and 'debounce_ms'
+ * can be 0 to disable debouncing.
+ * Returns false if the pin is not set up, or if the line is
+ * invalid or already in use.
+ */
+bool pEXTI::attach(pGPIO_pin* pin, unsigned line, unsigned edge,
+                   pEXTI_callback cb, void* arg,
+                   unsigned debounce_ms) {
+  if (!pin || pin->get_status() == pSTATUS_ERR) { return false; }
+  if (line >= pEXTI_NUM_LINES || !cb || !edge) { return false; }
+  if (exti_lines[line].cb) { return false; }
+  // Create the deferred handler task the first time it is needed.
+  // It runs at the highest priority, so callbacks are called
+  // right after the interrupt returns.
+  if (!exti_task) {
+    exti_task = exti_task_mem.start(handler_task, "EXTI_Handler",
+                                    NULL, configMAX_PRIORITIES-1);
+    if (!exti_task) {
+      return false;
+    }
+  }
+  uint32_t line_bit = (1 << line);
+  // Record the binding.
+  exti_lines[line].pin        = pin;
+  exti_lines[line].cb         = cb;
+  exti_lines[line].arg        = arg;
+  exti_lines[line].edge       = edge;
+  exti_lines[line].debounce   = pdMS_TO_TICKS(debounce_ms);
+  exti_lines[line].last_state = pin->read();
+  // Route the GPIO bank to the EXTI line. The F1 series uses
+  // the 'AFIO' peripheral for this, newer chips use 'SYSCFG'.
+  unsigned port_index = pin->get_bank()->get_port_index();
+  unsigned cr_shift   = (line & 0x03) * 4;
+  taskENTER_CRITICAL();
+  if (exti_lines[line].debounce) { debounce_lines |=  line_bit; }
+  else                           { debounce_lines &= ~line_bit; }
+  #if   defined(STARm_F3)
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    SYSCFG->EXTICR[line / 4] &= ~(0xF << cr_shift);
+    SYSCFG->EXTICR[line / 4] |=  (port_index << cr_shift);
+  #elif STARm_F1
+    RCC->APB2ENR |= RCC_APB2ENR_AFIOEN;
+    AFIO->EXTICR[line / 4] &= ~(0xF << cr_shift);
+    AFIO->EXTICR[line / 4] |=  (port_index << cr_shift);
+  #endif
+  // Select the trigger edges.
+  if (edge & pEXTI_EDGE_RISING)  { EXTI->RTSR |=  line_bit; }
+  else                           { EXTI->RTSR &= ~line_bit; }
+  if (edge & pEXTI_EDGE_FALLING) { EXTI->FTSR |=  line_bit; }
+  else                           { EXTI->FTSR &= ~line_bit; }
+  // Clear any stale pending flag, and un-mask the line.
+  EXTI->PR   =  line_bit;
+  EXTI->IMR |=  line_bit;
+  taskEXIT_CRITICAL();
+  // Enable the NVIC interrupt at a 'FreeRTOS-safe' priority.
+  NVIC_SetPriority(exti_irqn(line), pEXTI_IRQ_PRIORITY);
+  NVIC_EnableIRQ(exti_irqn(line));
+  return true;
+}
+
+/*
+ * Mask an EXTI line and remove its callback.
+ * The shared NVIC interrupts are left enabled; a masked
+ * line will not trigger them.
+ */
+void pEXTI::detach(unsigned line) {
+  if (line >= pEXTI_NUM_LINES) { return; }
+  uint32_t line_bit = (1 << line);
+  taskENTER_CRITICAL();
+  EXTI->IMR  &= ~line_bit;
+  EXTI->RTSR &= ~line_bit;
+  EXTI->FTSR &= ~line_bit;
+  EXTI->PR    =  line_bit;
+  debounce_lines   &= ~line_bit;
+  debounce_pending &= ~line_bit;
+  exti_lines[line].cb = NULL;
+  taskEXIT_CRITICAL();
+}
+
+/*
+ * Common EXTI interrupt logic: acknowledge the pending lines,
+ * mask the ones which are being debounced, and hand the rest
+ * of the work off to the handler task.
+ */
+pRAM_FUNC void pEXTI::irq_handler(uint32_t lines) {
+  pTRACE_ISR_ENTER();
+  uint32_t fired = EXTI->PR & EXTI->IMR & lines;
+  if (!fired) {
+    pTRACE_ISR_EXIT();
+    return;
+  }
+  // Clear the pending flags. (Write '1' to clear)
+  EXTI->PR = fired;
+  // Ignore further edges on debounced lines for now.
+  if (fired & debounce_lines) {
+    EXTI->IMR &= ~(fired & debounce_lines);
+  }
+  BaseType_t woken = pdFALSE;
+  xTaskNotifyFromISR(exti_task, fired, eSetBits, &woken);
+  pTRACE_ISR_EXIT();
+  portYIELD_FROM_ISR(woken);
+}
+
+/*
+ * Re-enable a debounced line after its period has expired.
+ */
+void pEXTI::rearm(unsigned line) {
+  uint32_t line_bit = (1 << line);
+  taskENTER_CRITICAL();
+  // Discard any bouncing edges which were latched while masked.
+  EXTI->PR   =  line_bit;
+  if (exti_lines[line].cb) { EXTI->IMR |= line_bit; }
+  taskEXIT_CRITICAL();
+}
+
+/*
+ * Deferred EXTI handler task.
+ * Wait for notifications from the interrupts, and call the
+ * callbacks for each line which fired. Debounced lines are
+ * timed with the RTOS tick counter; the task sleeps until the
+ * earliest debounce period ends, so it costs nothing while idle.
+ */
+void pEXTI::handler_task(void* args) {
+  TickType_t wait = portMAX_DELAY;
+  uint32_t fired = 0;
+  unsigned line;
+
+  while (1) {
+    fired = 0;
+    xTaskNotifyWait(0, 0xFFFFFFFF, &fired, wait);
+    TickType_t now = xTaskGetTickCount();
+    // Call the un-debounced callbacks right away, and start
+    // the debounce timers for the other lines.
+    for (line = 0; line < pEXTI_NUM_LINES; ++line) {
+      if (!(fired & (1 << line)) || !exti_lines[line].cb) { continue; }
+      if (exti_lines[line].debounce) {
+        exti_lines[line].armed_at = now;
+        debounce_pending |= (1 << line);
+      }
+      else {
+        bool state = exti_lines[line].pin->read();
+        exti_lines[line].last_state = state;
+        exti_lines[line].cb(exti_lines[line].arg, state);
+      }
+    }
+    // Check for expired debounce periods.
+    wait = portMAX_DELAY;
+    for (line = 0; line < pEXTI_NUM_LINES; ++line) {
+      if (!(debounce_pending & (1 << line))) { continue; }
+      TickType_t elapsed = now - exti_lines[line].armed_at;
+      if (elapsed < exti_lines[line].debounce) {
+        // Not yet; sleep until the earliest period ends.
+        TickType_t left = exti_lines[line].debounce - elapsed;
+        if (left < wait) { wait = left; }
+        continue;
+      }
+      debounce_pending &= ~(1 << line);
+      rearm(line);
+      if (!exti_lines[line].cb) { continue; }
+      // Only report edges which match the pin's settled level.
+      bool state = exti_lines[line].pin->read();
+      bool report = false;
+      if (state != exti_lines[line].last_state) {
+        if (state) {
+          report = (exti_lines[line].edge & pEXTI_EDGE_RISING);
+        }
+        else {
+          report = (exti_lines[line].edge & pEXTI_EDGE_FALLING);
+        }
+      }
+      exti_lines[line].last_state = state;
+      if (report) {
+        exti_lines[line].cb(exti_lines[line].arg, state);
+      }
+    }
+  }
+}
+
+/*
+ * EXTI interrupt handlers.
+ * These override the weak aliases in the vector table.
+ */
+extern "C" {
+  void EXTI0_IRQ_handler(void)     { pEXTI::irq_handler(0x0001); }
+  void EXTI1_IRQ_handler(void)     { pEXTI::irq_handler(0x0002); }
+  #if   defined(STARm_F3)
+    void EXTI2_touchsense_IRQ_handler(void) {
+      pEXTI::irq_handler(0x0004);
+    }
+  #elif STARm_F1
+    void EXTI2_IRQ_handler(void)   { pEXTI::irq_handler(0x0004); }
+  #endif
+  void EXTI3_IRQ_handler(void)     { pEXTI::irq_handler(0x0008); }
+  void EXTI4_IRQ_handler(void)     { pEXTI::irq_handler(0x0010); }
+  void EXTI5_9_IRQ_handler(void)   { pEXTI::irq_handler(0x03E0); }
+  void EXTI10_15_IRQ_handler(void) { pEXTI::irq_handler(0xFC00); }
+}
@@ -0,0 +1,58 @@
+#ifndef __STARm_EXTI_H
+#define __STARm_EXTI_H
+
+// Project includes.
+#include "core.h"
+
+// Project macro definitions.
+// EXTI edge selection macros.
+#define pEXTI_EDGE_RISING  (0x01)
+#define pEXTI_EDGE_FALLING (0x02)
+#define pEXTI_EDGE_BOTH    (0x03)
+// Number of EXTI lines which map to GPIO pins.
+#define pEXTI_NUM_LINES    (16)
+// NVIC priority for the EXTI interrupts. This must be numerically
+// >= 'configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY', because
+// the handlers call FreeRTOS '...FromISR' methods.
+#define pEXTI_IRQ_PRIORITY (6)
+// Stack size of the deferred handler task, in words.
+#define pEXTI_TASK_STACK   (128)
+
+// Forward declarations.
+class pGPIO_pin;
+
+// Deferred pin interrupt callback type. It runs in the
+// EXTI handler task, not in the interrupt, so it can call
+// regular FreeRTOS methods. 'pin_state' is the pin's level
+// when the callback runs (after debouncing, if enabled.)
+typedef void (*pEXTI_callback)(void* arg, bool pin_state);
+
+/*
+ * External interrupt line dispatcher.
+ * The EXTI interrupts only clear their pending flags and notify
+ * a single high-priority 'handler' task with a bitmask of the
+ * lines that fired; that task then calls the registered
+ * callbacks. Lines with a debounce period are masked until the
+ * period expires, and the callback only runs if the pin settled
+ * at a level which matches the requested edge.
+ * This is a static class; there is only one EXTI peripheral.
+ */
+class pEXTI {
+public:
+  // Bind a GPIO pin to its EXTI line.
+  static bool attach(pGPIO_pin* pin, unsigned line, unsigned edge,
+                     pEXTI_callback cb, void* arg,
+                     unsigned debounce_ms);
+  // Release an EXTI line.
+  static void detach(unsigned line);
+  // Common interrupt handler; 'lines' is the mask of lines
+  // which share the interrupt vector that was triggered.
+  static void irq_handler(uint32_t lines);
+protected:
+  // Deferred handler task.
+  static void handler_task(void* args);
+  static void rearm(unsigned line);
+private:
+};
+
+#endif
@@ -1,154 +1,175 @@
 #include "gpio.h"
+#include "clock.h"
+#include "lowpower.h"
+#include "clockgate.h"
+#include "trace.h"
+
+// Is a timed DMA stream currently running?
+static volatile bool gpio_stream_running = false;
 
 /*
- * GPIO peripheral class methods.
+ * Mark the timed stream as finished, and let the chip use STOP
+ * mode again. (The stream's timer needs the high-speed clocks.)
+ * The timer and DMA clocks are released, too.
  */
-// Default constructor.
-pGPIO::pGPIO() {}
+static void gpio_stream_finished(void) {
+  if (!gpio_stream_running) { return; }
+  gpio_stream_running = false;
+  pClockGate::release<pGPIO_stream_tim_en>();
+  pClockGate::release<pRCC_AHBENR::DMA1EN>();
+  pLowPower::stop_unlock();
+}
 
-// Convenience initialization constructor.
-pGPIO::pGPIO(GPIO_TypeDef* bank) {
+/*
+ * GPIO peripheral class methods.
+ */
+/*
+ * Choose the GPIO bank, and look up its clock enable/reset bits.
+ * Returns false if the bank is not recognized.
+ */
+bool pGPIO::init(GPIO_TypeDef* bank) {
   gpio = bank;
   // Gather required register addresses for the GPIO bank.
 #if defined(STARm_F3)
   if (bank == GPIOA) {
-    enable_reg = STARm_RCC_AHBENR;
+    enable_reg = pRCC_regs::AHBENR::ptr();
     enable_bit = RCC_AHBENR_GPIOAEN;
-    reset_reg  = STARm_RCC_AHBRSTR;
+    reset_reg  = pRCC_regs::AHBRSTR::ptr();
     reset_bit  = RCC_AHBRSTR_GPIOARST;
   }
   #ifdef GPIOB
     else if (bank == GPIOB) {
-      enable_reg = STARm_RCC_AHBENR;
+      enable_reg = pRCC_regs::AHBENR::ptr();
       enable_bit = RCC_AHBENR_GPIOBEN;
-      reset_reg  = STARm_RCC_AHBRSTR;
+      reset_reg  = pRCC_regs::AHBRSTR::ptr();
       reset_bit  = RCC_AHBRSTR_GPIOBRST;
     }
   #endif
   #ifdef GPIOC
     else if (bank == GPIOC) {
-      enable_reg = STARm_RCC_AHBENR;
+      enable_reg = pRCC_regs::AHBENR::ptr();
       enable_bit = RCC_AHBENR_GPIOCEN;
-      reset_reg  = STARm_RCC_AHBRSTR;
+      reset_reg  = pRCC_regs::AHBRSTR::ptr();
       reset_bit  = RCC_AHBRSTR_GPIOCRST;
     }
   #endif
   #ifdef GPIOD
     else if (bank == GPIOD) {
-      enable_reg = STARm_RCC_AHBENR;
+      enable_reg = pRCC_regs::AHBENR::ptr();
       enable_bit = RCC_AHBENR_GPIODEN;
-      reset_reg  = STARm_RCC_AHBRSTR;
+      reset_reg  = pRCC_regs::AHBRSTR::ptr();
       reset_bit  = RCC_AHBRSTR_GPIODRST;
     }
   #endif
   #ifdef GPIOE
     else if (bank == GPIOE) {
-      enable_reg = STARm_RCC_AHBENR;
+      enable_reg = pRCC_regs::AHBENR::ptr();
       enable_bit = RCC_AHBENR_GPIOEEN;
-      reset_reg  = STARm_RCC_AHBRSTR;
+      reset_reg  = pRCC_regs::AHBRSTR::ptr();
       reset_bit  = RCC_AHBRSTR_GPIOERST;
     }
   #endif
   #ifdef GPIOF
     else if (bank == GPIOF) {
-      enable_reg = STARm_RCC_AHBENR;
+      enable_reg = pRCC_regs::AHBENR::ptr();
       enable_bit = RCC_AHBENR_GPIOFEN;
-      reset_reg  = STARm_RCC_AHBRSTR;
+      reset_reg  = pRCC_regs::AHBRSTR::ptr();
       reset_bit  = RCC_AHBRSTR_GPIOFRST;
     }
   #endif
   #ifdef GPIOG
     else if (bank == GPIOG) {
-      enable_reg = STARm_RCC_AHBENR;
+      enable_reg = pRCC_regs::AHBENR::ptr();
       enable_bit = RCC_AHBENR_GPIOGEN;
-      reset_reg  = STARm_RCC_AHBRSTR;
+      reset_reg  = pRCC_regs::AHBRSTR::ptr();
       reset_bit  = RCC_AHBRSTR_GPIOGRST;
     }
   #endif
   #ifdef GPIOH
     else if (bank == GPIOH) {
-      enable_reg = STARm_RCC_AHBENR;
+      enable_reg = pRCC_regs::AHBENR::ptr();
       enable_bit = RCC_AHBENR_GPIOHEN;
-      reset_reg  = STARm_RCC_AHBRSTR;
+      reset_reg  = pRCC_regs::AHBRSTR::ptr();
       reset_bit  = RCC_AHBRSTR_GPIOHRST;
     }
   #endif
   else {
     // (Unrecognized GPIO bank.)
     status = pSTATUS_ERR;
-    return;
+    return false;
   }
 #elif  STARm_F1
   if (bank == GPIOA) {
-    enable_reg = STARm_RCC_APB2ENR;
+    enable_reg = pRCC_regs::APB2ENR::ptr();
     enable_bit = RCC_APB2ENR_IOPAEN;
-    reset_reg  = STARm_RCC_APB2RSTR;
+    reset_reg  = pRCC_regs::APB2RSTR::ptr();
     reset_bit  = RCC_APB2RSTR_IOPARST;
   }
   #ifdef GPIOB
     else if (bank == GPIOB) {
-      enable_reg = STARm_RCC_APB2ENR;
+      enable_reg = pRCC_regs::APB2ENR::ptr();
       enable_bit = RCC_APB2ENR_IOPBEN;
-      reset_reg  = STARm_RCC_APB2RSTR;
+      reset_reg  = pRCC_regs::APB2RSTR::ptr();
       reset_bit  = RCC_APB2RSTR_IOPBRST;
     }
   #endif
   #ifdef GPIOC
     else if (bank == GPIOC) {
-      enable_reg = STARm_RCC_APB2ENR;
+      enable_reg = pRCC_regs::APB2ENR::ptr();
       enable_bit = RCC_APB2ENR_IOPCEN;
-      reset_reg  = STARm_RCC_APB2RSTR;
+      reset_reg  = pRCC_regs::APB2RSTR::ptr();
       reset_bit  = RCC_APB2RSTR_IOPCRST;
     }
   #endif
   #ifdef GPIOD
     else if (bank == GPIOD) {
-      enable_reg = STARm_RCC_APB2ENR;
+      enable_reg = pRCC_regs::APB2ENR::ptr();
       enable_bit = RCC_APB2ENR_IOPDEN;
-      reset_reg  = STARm_RCC_APB2RSTR;
+      reset_reg  = pRCC_regs::APB2RSTR::ptr();
       reset_bit  = RCC_APB2RSTR_IOPDRST;
     }
   #endif
   #ifdef GPIOE
     else if (bank == GPIOE) {
-      enable_reg = STARm_RCC_APB2ENR;
+      enable_reg = pRCC_regs::APB2ENR::ptr();
       enable_bit = RCC_APB2ENR_IOPEEN;
-      reset_reg  = STARm_RCC_APB2RSTR;
+      reset_reg  = pRCC_regs::APB2RSTR::ptr();
       reset_bit  = RCC_APB2RSTR_IOPERST;
     }
   #endif
   #ifdef GPIOF
     else if (bank == GPIOF) {
-      enable_reg = STARm_RCC_APB2ENR;
+      enable_reg = pRCC_regs::APB2ENR::ptr();
       enable_bit = RCC_APB2ENR_IOPFEN;
-      reset_reg  = STARm_RCC_APB2RSTR;
+      reset_reg  = pRCC_regs::APB2RSTR::ptr();
       reset_bit  = RCC_APB2RSTR_IOPFRST;
     }
   #endif
   #ifdef GPIOG
     else if (bank == GPIOG) {
-      enable_reg = STARm_RCC_APB2ENR;
+      enable_reg = pRCC_regs::APB2ENR::ptr();
       enable_bit = RCC_APB2ENR_IOPGEN;
-      reset_reg  = STARm_RCC_APB2RSTR;
+      reset_reg  = pRCC_regs::APB2RSTR::ptr();
       reset_bit  = RCC_APB2RSTR_IOPGRST;
     }
   #endif
   #ifdef GPIOH
     else if (bank == GPIOH) {
-      enable_reg = STARm_RCC_APB2ENR;
+      enable_reg = pRCC_regs::APB2ENR::ptr();
       enable_bit = RCC_APB2ENR_IOPHEN;
-      reset_reg  = STARm_RCC_APB2RSTR;
+      reset_reg  = pRCC_regs::APB2RSTR::ptr();
       reset_bit  = RCC_APB2RSTR_IOPHRST;
     }
   #endif
   else {
     // (Unrecognized GPIO bank.)
     status = pSTATUS_ERR;
-    return;
+    return false;
   }
 #endif
   // TODO: Any more GPIO banks on larger chips?
   status = pSTATUS_SET;
+  return true;
 }
 
 /*
@@ -172,31 +193,176 @@ void pGPIO::write(unsigned dat) {
 
 /*
  * Stream a series of values to the GPIO pins.
- * I don't see why you would, but maybe I can add timed delays.
+ * By default, each word is written to ODR by the CPU as fast as
+ * it can go. If 'stream_timed' was called, the buffer is handed
+ * to DMA instead; see 'stream_dma' below. (If the clocks have
+ * slowed down too much for the rate since then, nothing is sent,
+ * and 'stream_busy' returns false.)
  */
 void pGPIO::stream(volatile void* buf, int len) {
   volatile uint32_t* gpiobuf = (volatile uint32_t*) buf;
   if (status == pSTATUS_ERR) { return; }
+  if (stream_rate) {
+    stream_dma(buf, len);
+    return;
+  }
   // Write all of the values, one by one.
   for (int si = 0; si < len; ++si) {
     write(gpiobuf[si]);
   }
 }
 
+/*
+ * Send future 'stream' calls through DMA, with one word written
+ * every 1/rate_hz seconds. If 'circular' is set, the buffer
+ * repeats until 'stream_stop' is called.
+ * Only one bank can use the stream timer at a time.
+ * Returns false if the stream timer can't run that fast.
+ */
+bool pGPIO::stream_timed(uint32_t rate_hz, bool circular) {
+  uint32_t psc, arr;
+  if (status == pSTATUS_ERR) { return false; }
+  if (!pClock::tim_period(rate_hz, &psc, &arr)) { return false; }
+  stream_rate = rate_hz;
+  stream_circ = circular;
+  return true;
+}
+
+/* Go back to CPU-driven 'stream' calls. */
+void pGPIO::stream_untimed(void) {
+  stream_stop();
+  stream_rate = 0;
+}
+
+/*
+ * Start a timed DMA stream.
+ * In this mode, each word in the buffer is written to BSRR rather
+ * than ODR: bits 0-15 set pins and bits 16-31 reset them, so pins
+ * which aren't part of the waveform are never touched. Use
+ * 'bsrr_word' to build the buffer. The transfer runs in the
+ * background; the buffer must stay valid until 'stream_busy'
+ * returns false, and the pins hold the last value afterwards.
+ * Returns false, without starting, if the rate is too high for
+ * the current clock speed.
+ */
+bool pGPIO::stream_dma(volatile void* buf, int len) {
+  uint32_t psc, arr;
+  if (len <= 0 || len > 0xFFFF) { return false; }
+  if (!pClock::tim_period(stream_rate, &psc, &arr)) { return false; }
+  stream_stop();
+  // Enable the DMA and timer clocks, until the stream ends.
+  pClockGate::acquire<pRCC_AHBENR::DMA1EN>();
+  pClockGate::acquire<pGPIO_stream_tim_en>();
+  pGPIO_STREAM_TIM->CR1  = 0;
+  pGPIO_STREAM_TIM->DIER = 0;
+  pGPIO_STREAM_TIM->PSC  = psc;
+  pGPIO_STREAM_TIM->ARR  = arr;
+  // Load the prescaler before the DMA request is enabled, since
+  // the 'update generation' event would trigger a transfer.
+  pGPIO_stream_tim::EGR::write(pTIM_EGR::UG::set());
+  pGPIO_STREAM_TIM->SR   = 0;
+  // Configure the DMA channel: 32-bit memory -> 32-bit BSRR.
+  pDMA1_regs::IFCR::write(pGPIO_stream_dma_clr::set());
+  pGPIO_STREAM_DMA->CCR   = 0;
+  pGPIO_STREAM_DMA->CPAR  = (uint32_t)&(gpio->BSRR);
+  pGPIO_STREAM_DMA->CMAR  = (uint32_t)buf;
+  pGPIO_STREAM_DMA->CNDTR = len;
+  const pDMA_CCR::value ccr = (pDMA_CCR::MSIZE::val<2>() |
+                               pDMA_CCR::PSIZE::val<2>() |
+                               pDMA_CCR::MINC::set()     |
+                               pDMA_CCR::DIR::set()      |
+                               pDMA_CCR::PL::val<2>());
+  if (stream_circ) {
+    pGPIO_stream_dma::CCR::write(ccr | pDMA_CCR::CIRC::set());
+  }
+  else {
+    // Stop the timer from the 'transfer complete' interrupt.
+    pGPIO_stream_dma::CCR::write(ccr | pDMA_CCR::TCIE::set());
+    NVIC_EnableIRQ(pGPIO_STREAM_DMA_IRQn);
+  }
+  gpio_stream_running = true;
+  pLowPower::stop_lock();
+  pGPIO_stream_dma::CCR::modify(pDMA_CCR::EN::set());
+  // Start the timer; each update event moves one word.
+  pGPIO_stream_tim::DIER::write(pTIM_DIER::UDE::set());
+  pGPIO_stream_tim::CR1::write(pTIM_CR1::CEN::set());
+  return true;
+}
+
+/* Is a timed stream still running? */
+bool pGPIO::stream_busy(void) {
+  return gpio_stream_running;
+}
+
+/* Stop a timed stream, if one is running. */
+void pGPIO::stream_stop(void) {
+  if (!gpio_stream_running) { return; }
+  // (The 'transfer complete' interrupt could also end the stream.)
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  pGPIO_STREAM_TIM->CR1   = 0;
+  pGPIO_STREAM_TIM->DIER  = 0;
+  pGPIO_stream_dma::CCR::modify(pDMA_CCR::EN::clear());
+  pDMA1_regs::IFCR::write(pGPIO_stream_dma_clr::set());
+  gpio_stream_finished();
+  __set_PRIMASK(primask);
+}
+
+/*
+ * Build a BSRR word which drives the pins in 'pin_mask'
+ * to the matching bits in 'values'.
+ */
+uint32_t pGPIO::bsrr_word(uint16_t pin_mask, uint16_t values) {
+  return (((uint32_t)(~values & pin_mask)) << 16) |
+         (values & pin_mask);
+}
+
+/*
+ * Timed stream 'transfer complete' interrupt.
+ */
+extern "C" pRAM_FUNC void DMA1_chan2_IRQ_handler(void) {
+  pTRACE_ISR_ENTER();
+  if (DMA1->ISR & pGPIO_STREAM_DMA_TCIF) {
+    pGPIO_STREAM_TIM->CR1   = 0;
+    pGPIO_STREAM_TIM->DIER  = 0;
+    pGPIO_stream_dma::CCR::modify(pDMA_CCR::EN::clear());
+    pDMA1_regs::IFCR::write(pGPIO_stream_dma_clr::set());
+    gpio_stream_finished();
+  }
+  pTRACE_ISR_EXIT();
+}
+
 /*
  * Read a single pin's state.
+ * On the F1 series, the GPIO banks are inside of the Cortex-M3's
+ * peripheral bit-band region, so the pin's IDR bit can be read
+ * through its own word-sized alias. The F3's GPIO banks are on
+ * an AHB bus outside of that region, so they use a masked read.
  */
 bool pGPIO::read_pin(unsigned pin_num) {
   if (status == pSTATUS_ERR) { return 0; }
-  return (gpio->IDR & (1 << pin_num));
+  #if   defined(STARm_F1)
+    return *STARm_BITBAND_PERIPH(&gpio->IDR, pin_num);
+  #else
+    return (gpio->IDR & (1 << pin_num));
+  #endif
 }
 
+/*
+ * Pin writes use the BSRR ('bit set/reset') and BRR ('bit reset')
+ * registers instead of read-modify-writes to ODR. Writing a '1'
+ * to one of their bits sets or clears the matching pin, and
+ * writing a '0' has no effect; so each write is a single store,
+ * and it can't clobber a concurrent change to another pin in
+ * the same bank from a different task or interrupt.
+ */
+
 /*
  * Turn a single pin on.
  */
 void pGPIO::pin_on(unsigned pin_num) {
   if (status == pSTATUS_ERR) { return; }
-  gpio->ODR |= (1 << pin_num);
+  gpio->BSRR = (1 << pin_num);
 }
 
 /*
@@ -205,7 +371,7 @@ void pGPIO::pin_on(unsigned pin_num) {
 void pGPIO::pins_on(uint16_t pin_mask) {
   if (status == pSTATUS_ERR) { return; }
   // Turn on all of the requested pins.
-  gpio->ODR |= pin_mask;
+  gpio->BSRR = pin_mask;
 }
 
 /*
@@ -214,7 +380,7 @@ void pGPIO::pins_on(uint16_t pin_mask) {
 void pGPIO::pin_off(unsigned pin_num) {
   if (status == pSTATUS_ERR) { return; }
   // Pull a single pin to ground.
-  gpio->ODR &= ~(1 << pin_num);
+  gpio->BRR = (1 << pin_num);
 }
 
 /*
@@ -223,7 +389,7 @@ void pGPIO::pin_off(unsigned pin_num) {
 void pGPIO::pins_off(uint16_t pin_mask) {
   if (status == pSTATUS_ERR) { return; }
   // Pull all of the requested pins down.
-  gpio->ODR &= ~(pin_mask);
+  gpio->BRR = pin_mask;
 }
 
 /*
@@ -231,16 +397,30 @@ void pGPIO::pins_off(uint16_t pin_mask) {
  */
 void pGPIO::pin_toggle(unsigned pin_num) {
   if (status == pSTATUS_ERR) { return; }
-  gpio->ODR ^= (1 << pin_num);
+  pins_toggle(1 << pin_num);
 }
 
 /*
  * Toggle all requested pins, leaving the rest unaffected.
+ * The new state is computed from ODR, then written to BSRR in
+ * one store: requested pins which are on go in the upper 'reset'
+ * half-word, and requested pins which are off go in the lower
+ * 'set' half-word. Other pins are never written.
  */
 void pGPIO::pins_toggle(uint16_t pin_mask) {
   if (status == pSTATUS_ERR) { return; }
-  // Toggle all of the requested pins between on/off states.
-  gpio->ODR ^= pin_mask;
+  uint32_t odr = gpio->ODR;
+  gpio->BSRR = ((odr & pin_mask) << 16) | (~odr & pin_mask);
+}
+
+/*
+ * Return the bank's index, counting from GPIOA = 0.
+ * The banks are spaced 1KB apart on both the F1 and F3 lines,
+ * and this index is what the EXTI line selection registers use.
+ */
+unsigned pGPIO::get_port_index(void) {
+  if (status == pSTATUS_ERR) { return 0; }
+  return (((uint32_t)gpio) - GPIOA_BASE) / 0x400;
 }
 
 /* (Platform-specific GPIO pin methods.) */
@@ -319,6 +499,46 @@ void pGPIO::set_pin_af(unsigned pin_num, unsigned af) {
   }
 }
 
+/*
+ * Configure every pin in 'pin_mask' with the same quick-init
+ * mode, alternate function, and output speed. The register
+ * fields for all of the pins are calculated first, and then each
+ * configuration register gets a single read-modify-write; so
+ * setting up a whole parallel bus costs the same as one pin.
+ * ('af' is only applied to pins in an alternate function mode.)
+ */
+void pGPIO::configure(uint16_t pin_mask, pGPIO_pin_qinit q,
+                      unsigned af, unsigned ospeed) {
+  if (status == pSTATUS_ERR || !pin_mask) { return; }
+  unsigned mode  = pGPIO_q_mode(q);
+  unsigned pupd  = pGPIO_q_pupd(q);
+  uint32_t f2_mask = 0, moder = 0, ospeedr = 0, pupdr = 0;
+  uint32_t afr_mask[2] = { 0, 0 };
+  uint32_t afr[2]      = { 0, 0 };
+  for (unsigned pin_num = 0; pin_num < 16; ++pin_num) {
+    if (!(pin_mask & (1 << pin_num))) { continue; }
+    f2_mask |= (3U     << (pin_num * 2));
+    moder   |= (mode   << (pin_num * 2));
+    ospeedr |= (ospeed << (pin_num * 2));
+    pupdr   |= (pupd   << (pin_num * 2));
+    afr_mask[pin_num / 8] |= (0xFU << ((pin_num & 0x07) * 4));
+    afr[pin_num / 8]      |= (af   << ((pin_num & 0x07) * 4));
+  }
+  gpio->MODER   = (gpio->MODER   & ~f2_mask) | moder;
+  if (pGPIO_q_otype(q) == pGPIO_OTYPE_OD) {
+    gpio->OTYPER |=  pin_mask;
+  }
+  else {
+    gpio->OTYPER &= ~pin_mask;
+  }
+  gpio->OSPEEDR = (gpio->OSPEEDR & ~f2_mask) | ospeedr;
+  gpio->PUPDR   = (gpio->PUPDR   & ~f2_mask) | pupdr;
+  if (mode == pGPIO_MODE_ALT) {
+    if (afr_mask[0]) { gpio->AFR[0] = (gpio->AFR[0] & ~afr_mask[0]) | afr[0]; }
+    if (afr_mask[1]) { gpio->AFR[1] = (gpio->AFR[1] & ~afr_mask[1]) | afr[1]; }
+  }
+}
+
 #elif STARm_F1
 
 /*
@@ -346,148 +566,48 @@ void pGPIO::set_pin_cfg(unsigned pin_num, unsigned cfg) {
   }
 }
 
+/*
+ * Configure every pin in 'pin_mask' with the same quick-init
+ * mode. The CRL/CRH fields for all of the pins are calculated
+ * first, and then each register gets a single read-modify-write.
+ * Pull-up/pull-down selection is a single write to BSRR.
+ */
+void pGPIO::configure(uint16_t pin_mask, pGPIO_pin_qinit q) {
+  if (status == pSTATUS_ERR || !pin_mask) { return; }
+  unsigned cfg = pGPIO_q_cfg(q);
+  uint32_t cr_mask[2] = { 0, 0 };
+  uint32_t cr[2]      = { 0, 0 };
+  for (unsigned pin_num = 0; pin_num < 16; ++pin_num) {
+    if (!(pin_mask & (1 << pin_num))) { continue; }
+    cr_mask[pin_num / 8] |= (0xFU << ((pin_num & 0x07) * 4));
+    cr[pin_num / 8]      |= (cfg  << ((pin_num & 0x07) * 4));
+  }
+  // Writing a '1' to ODR selects pull-up, '0' pull-down.
+  if (pGPIO_q_is_pullup(q))        { gpio->BSRR = pin_mask; }
+  else if (pGPIO_q_is_pulldown(q)) { gpio->BRR  = pin_mask; }
+  if (cr_mask[0]) { gpio->CRL = (gpio->CRL & ~cr_mask[0]) | cr[0]; }
+  if (cr_mask[1]) { gpio->CRH = (gpio->CRH & ~cr_mask[1]) | cr[1]; }
+}
+
 #endif
 
 /* GPIO Pin class methods. */
-// Default constructor.
-pGPIO_pin::pGPIO_pin() {}
-
-// Convenience constructor.
-pGPIO_pin::pGPIO_pin(pGPIO* pin_bank, uint8_t pin_num,
+/*
+ * Choose a pin and configure it in one of the quick-init modes.
+ * Returns false if the bank or pin number is not valid.
+ */
+bool pGPIO_pin::init(pGPIO* pin_bank, uint8_t pin_num,
                      pGPIO_pin_qinit q) {
   // Set basic values.
   bank = pin_bank;
   pin = pin_num;
+  if (!bank || pin >= 16) { return false; }
   // Set the pin registers according to the quick reference.
-  // Different registers for different lines of chips.
-  #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
-    switch(q) {
-      case pGPIO_IN_FLOATING:
-        bank->set_pin_mode(pin, pGPIO_MODE_IN);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_NONE);
-        break;
-      case pGPIO_IN_PULLUP:
-        bank->set_pin_mode(pin, pGPIO_MODE_IN);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_UP);
-        break;
-      case pGPIO_IN_PULLDOWN:
-        bank->set_pin_mode(pin, pGPIO_MODE_IN);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_DOWN);
-        break;
-      case pGPIO_IN_ANALOG:
-        bank->set_pin_mode(pin, pGPIO_MODE_AIN);
-        break;
-      case pGPIO_OUT_PP:
-        bank->set_pin_mode(pin, pGPIO_MODE_OUT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_PP);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_NONE);
-        break;
-      case pGPIO_OUT_OD:
-        bank->set_pin_mode(pin, pGPIO_MODE_OUT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_OD);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_NONE);
-        break;
-      case pGPIO_AF_PP:
-        bank->set_pin_mode(pin, pGPIO_MODE_ALT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_PP);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_NONE);
-        break;
-      case pGPIO_AF_OD:
-        bank->set_pin_mode(pin, pGPIO_MODE_ALT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_OD);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_NONE);
-        break;
-      case pGPIO_OUT_PP_PULLUP:
-        bank->set_pin_mode(pin, pGPIO_MODE_OUT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_PP);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_UP);
-        break;
-      case pGPIO_OUT_OD_PULLUP:
-        bank->set_pin_mode(pin, pGPIO_MODE_OUT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_OD);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_UP);
-        break;
-      case pGPIO_OUT_PP_PULLDOWN:
-        bank->set_pin_mode(pin, pGPIO_MODE_OUT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_PP);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_DOWN);
-        break;
-      case pGPIO_OUT_OD_PULLDOWN:
-        bank->set_pin_mode(pin, pGPIO_MODE_OUT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_OD);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_DOWN);
-        break;
-      case pGPIO_AF_PP_PULLUP:
-        bank->set_pin_mode(pin, pGPIO_MODE_ALT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_PP);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_UP);
-        break;
-      case pGPIO_AF_OD_PULLUP:
-        bank->set_pin_mode(pin, pGPIO_MODE_ALT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_OD);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_UP);
-        break;
-      case pGPIO_AF_PP_PULLDOWN:
-        bank->set_pin_mode(pin, pGPIO_MODE_ALT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_PP);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_DOWN);
-        break;
-      case pGPIO_AF_OD_PULLDOWN:
-        bank->set_pin_mode(pin, pGPIO_MODE_ALT);
-        bank->set_pin_type(pin, pGPIO_OTYPE_OD);
-        bank->set_pin_speed(pin, pGPIO_SPEED_LOW);
-        bank->set_pin_pupd(pin, pGPIO_PUPD_DOWN);
-        break;
-      default:
-        status = pSTATUS_ERR;
-        return;
-    }
-  #elif STARm_F1
-    switch(q) {
-      case pGPIO_IN_FLOATING:
-        bank->set_pin_cfg(pin, pGPIO_CFG_IN_FLT);
-        break;
-      case pGPIO_IN_PULLUP:
-        bank->set_pin_cfg(pin, pGPIO_CFG_IN_PUPD);
-        bank->pin_on(pin);
-        break;
-      case pGPIO_IN_PULLDOWN:
-        bank->set_pin_cfg(pin, pGPIO_CFG_IN_PUPD);
-        bank->pin_off(pin);
-        break;
-      case pGPIO_IN_ANALOG:
-        bank->set_pin_cfg(pin, pGPIO_CFG_IN_ANALOG);
-        break;
-      case pGPIO_OUT_PP:
-        bank->set_pin_cfg(pin, pGPIO_CFG_OUT_PP);
-        break;
-      case pGPIO_OUT_OD:
-        bank->set_pin_cfg(pin, pGPIO_CFG_OUT_OD);
-        break;
-      case pGPIO_AF_PP:
-        bank->set_pin_cfg(pin, pGPIO_CFG_AF_PP);
-        break;
-      case pGPIO_AF_OD:
-        bank->set_pin_cfg(pin, pGPIO_CFG_AF_OD);
-        break;
-      default:
-        status = pSTATUS_ERR;
-        return;
-    }
-  #endif
+  // (One write per configuration register.)
+  bank->configure(1 << pin, q);
   // Mark the pin status as initialized.
   status = pSTATUS_SET;
+  return true;
 }
 
 /* Turn the GPIO pin on ('1') */
@@ -514,10 +634,33 @@ bool pGPIO_pin::read(void) {
   return bank->read_pin(pin);
 }
 
+/*
+ * Enable an external interrupt on the pin's EXTI line.
+ * 'edge' is one of the 'pEXTI_EDGE_x' values. The callback is
+ * deferred to a task, so it is safe to call FreeRTOS methods
+ * from it. If 'debounce_ms' is not 0, edges are ignored for that
+ * long after the first one, and the callback only runs if the
+ * pin has settled at a level matching the requested edge.
+ * Only one pin can use each EXTI line; PA3 and PB3 share line 3.
+ */
+bool pGPIO_pin::irq_en(unsigned edge, pEXTI_callback cb,
+                       void* arg, unsigned debounce_ms) {
+  if (status == pSTATUS_ERR) { return false; }
+  return pEXTI::attach(this, pin, edge, cb, arg, debounce_ms);
+}
+
+/* Disable the pin's external interrupt. */
+void pGPIO_pin::irq_disable(void) {
+  if (status == pSTATUS_ERR) { return; }
+  pEXTI::detach(pin);
+}
+
 /* Getters/setters. */
 // This checks if the pin is initialized; it
 // does NOT read the value of an input pin.
 int pGPIO_pin::get_status(void) { return status; }
+// GPIO bank which the pin belongs to.
+pGPIO* pGPIO_pin::get_bank(void) { return bank; }
 
 #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
 
@@ -3,6 +3,7 @@
 
 // Project includes.
 #include "core.h"
+#include "exti.h"
 
 // Project macro definitions.
 // GPIO pin state macros.
@@ -28,6 +29,18 @@
   #define pGPIO_CFG_AF_PP      (0x0A)
   #define pGPIO_CFG_AF_OD      (0x0E)
 #endif
+// Timer and DMA channel which pace 'timed' GPIO streams.
+// (TIM2's update event is routed to DMA1 channel 2 on
+//  both the F1 and F3 lines.)
+#define pGPIO_STREAM_TIM       (TIM2)
+#define pGPIO_STREAM_DMA       (DMA1_Channel2)
+#define pGPIO_STREAM_DMA_IRQn  (DMA1_Channel2_IRQn)
+#define pGPIO_STREAM_DMA_TCIF  (DMA_ISR_TCIF2)
+// (Register descriptions for the same peripherals; see 'regs.h'.)
+typedef pTIM_regs<TIM2_BASE>               pGPIO_stream_tim;
+typedef pDMA_chan_regs<DMA1_Channel2_BASE> pGPIO_stream_dma;
+typedef pRCC_APB1ENR::TIM2EN               pGPIO_stream_tim_en;
+typedef pDMA_IFCR::CGIF<2>                 pGPIO_stream_dma_clr;
 // GPIO enum for convenience instantiation.
 // Output speed is not currently specified; it can
 // be set after the initialization, but 2MHz /
@@ -53,14 +66,67 @@ enum pGPIO_pin_qinit {
   #endif
 };
 
+/*
+ * Register field values for each quick-init pin mode.
+ * These are 'constexpr', so they fold away when the mode
+ * is known at compile-time.
+ */
+#if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
+  constexpr bool pGPIO_q_is_pullup(pGPIO_pin_qinit q) {
+    return (q == pGPIO_IN_PULLUP     || q == pGPIO_OUT_PP_PULLUP ||
+            q == pGPIO_OUT_OD_PULLUP || q == pGPIO_AF_PP_PULLUP  ||
+            q == pGPIO_AF_OD_PULLUP);
+  }
+  constexpr bool pGPIO_q_is_pulldown(pGPIO_pin_qinit q) {
+    return (q == pGPIO_IN_PULLDOWN     || q == pGPIO_OUT_PP_PULLDOWN ||
+            q == pGPIO_OUT_OD_PULLDOWN || q == pGPIO_AF_PP_PULLDOWN  ||
+            q == pGPIO_AF_OD_PULLDOWN);
+  }
+  constexpr unsigned pGPIO_q_mode(pGPIO_pin_qinit q) {
+    return (q == pGPIO_IN_FLOATING || q == pGPIO_IN_PULLUP ||
+            q == pGPIO_IN_PULLDOWN) ? pGPIO_MODE_IN :
+           (q == pGPIO_IN_ANALOG) ? pGPIO_MODE_AIN :
+           (q == pGPIO_OUT_PP || q == pGPIO_OUT_OD ||
+            q == pGPIO_OUT_PP_PULLUP || q == pGPIO_OUT_PP_PULLDOWN ||
+            q == pGPIO_OUT_OD_PULLUP || q == pGPIO_OUT_OD_PULLDOWN) ?
+             pGPIO_MODE_OUT : pGPIO_MODE_ALT;
+  }
+  constexpr unsigned pGPIO_q_otype(pGPIO_pin_qinit q) {
+    return (q == pGPIO_OUT_OD || q == pGPIO_AF_OD ||
+            q == pGPIO_OUT_OD_PULLUP || q == pGPIO_OUT_OD_PULLDOWN ||
+            q == pGPIO_AF_OD_PULLUP  || q == pGPIO_AF_OD_PULLDOWN) ?
+             pGPIO_OTYPE_OD : pGPIO_OTYPE_PP;
+  }
+  constexpr unsigned pGPIO_q_pupd(pGPIO_pin_qinit q) {
+    return pGPIO_q_is_pullup(q)   ? pGPIO_PUPD_UP :
+           pGPIO_q_is_pulldown(q) ? pGPIO_PUPD_DOWN : pGPIO_PUPD_NONE;
+  }
+#elif STARm_F1
+  constexpr bool pGPIO_q_is_pullup(pGPIO_pin_qinit q) {
+    return (q == pGPIO_IN_PULLUP);
+  }
+  constexpr bool pGPIO_q_is_pulldown(pGPIO_pin_qinit q) {
+    return (q == pGPIO_IN_PULLDOWN);
+  }
+  constexpr unsigned pGPIO_q_cfg(pGPIO_pin_qinit q) {
+    return (q == pGPIO_IN_FLOATING) ? pGPIO_CFG_IN_FLT :
+           (q == pGPIO_IN_PULLUP || q == pGPIO_IN_PULLDOWN) ?
+             pGPIO_CFG_IN_PUPD :
+           (q == pGPIO_IN_ANALOG) ? pGPIO_CFG_IN_ANALOG :
+           (q == pGPIO_OUT_PP) ? pGPIO_CFG_OUT_PP :
+           (q == pGPIO_OUT_OD) ? pGPIO_CFG_OUT_OD :
+           (q == pGPIO_AF_PP)  ? pGPIO_CFG_AF_PP : pGPIO_CFG_AF_OD;
+  }
+#endif
+
 /*
  * GPIO peripheral class.
  */
 class pGPIO : public pIO {
 public:
-  // Constructors.
-  pGPIO();
-  pGPIO(GPIO_TypeDef* bank);
+  // Constructor; call 'init' to choose a GPIO bank.
+  constexpr pGPIO() {}
+  bool     init(GPIO_TypeDef* bank);
   // Common r/w methods from the core I/O class.
   unsigned read(void);
   void     write(unsigned dat);
@@ -74,6 +140,14 @@ public:
   void     pins_off(uint16_t pin_mask);
   void     pin_toggle(unsigned pin_num);
   void     pins_toggle(uint16_t pin_mask);
+  // Timed DMA stream methods.
+  bool     stream_timed(uint32_t rate_hz, bool circular = false);
+  void     stream_untimed(void);
+  bool     stream_busy(void);
+  void     stream_stop(void);
+  static uint32_t bsrr_word(uint16_t pin_mask, uint16_t values);
+  // Getters/setters.
+  unsigned get_port_index(void);
   // Register modification methods; platform-specific.
   #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
     void   set_pin_mode(unsigned pin_num, unsigned mode);
@@ -81,12 +155,22 @@ public:
     void   set_pin_speed(unsigned pin_num, unsigned ospeed);
     void   set_pin_pupd(unsigned pin_num, unsigned pupd);
     void   set_pin_af(unsigned pin_num, unsigned af);
+    // Configure multiple pins with one write per register.
+    void   configure(uint16_t pin_mask, pGPIO_pin_qinit q,
+                     unsigned af = 0,
+                     unsigned ospeed = pGPIO_SPEED_LOW);
   #elif STARm_F1
     void   set_pin_cfg(unsigned pin_num, unsigned cfg);
+    // Configure multiple pins with one write per register.
+    void   configure(uint16_t pin_mask, pGPIO_pin_qinit q);
   #endif
 protected:
   // Reference GPIO register struct.
   GPIO_TypeDef* gpio        = NULL;
+  // Timed stream settings; a rate of 0 means 'CPU writes'.
+  uint32_t      stream_rate = 0;
+  bool          stream_circ = false;
+  bool          stream_dma(volatile void* buf, int len);
 private:
 };
 
@@ -95,10 +179,12 @@ private:
  */
 class pGPIO_pin {
 public:
-  pGPIO_pin();
-  // Convenience constructor.
+  // Constructor; call 'init' to choose and configure a pin.
+  constexpr pGPIO_pin() {}
+  pGPIO_pin(const pGPIO_pin&)            = delete;
+  pGPIO_pin& operator=(const pGPIO_pin&) = delete;
   // Pass in an enum value from the pin modes defined above.
-  pGPIO_pin(pGPIO* pin_bank, uint8_t pin_num, pGPIO_pin_qinit q);
+  bool init(pGPIO* pin_bank, uint8_t pin_num, pGPIO_pin_qinit q);
   // GPIO pin methods.
   // TODO: add a flag for reversing 'on/off' for e.g. a pin
   // wired to an LED's cathode.
@@ -106,8 +192,13 @@ public:
   void off(void);
   void toggle(void);
   bool read(void);
+  // External interrupt methods.
+  bool irq_en(unsigned edge, pEXTI_callback cb,
+              void* arg = NULL, unsigned debounce_ms = 0);
+  void irq_disable(void);
   // Getters/setters.
-  int  get_status(void);
+  int    get_status(void);
+  pGPIO* get_bank(void);
   // Platform-specific pin configuration methods.
   #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
     void set_mode(unsigned mode);
@@ -0,0 +1,243 @@
+#ifndef __STARm_GPIO_STATIC_H
+#define __STARm_GPIO_STATIC_H
+
+#include <stddef.h>
+
+// Project includes.
+#include "gpio.h"
+#include "clockgate.h"
+
+/*
+ * Compile-time GPIO classes.
+ * These are 'zero-overhead' alternatives to the pGPIO and
+ * pGPIO_pin classes, for pins which are known when the program
+ * is compiled. They have no member variables, so register
+ * addresses and bitmasks are compile-time constants; a call like
+ * 'pPin<pPortB, 12>::on()' compiles down to a single store.
+ * These classes don't track any status, so the port's clock
+ * must be enabled before they are used. ('clock_en' adds a user
+ * to the bank's clock which is never removed; see 'clockgate.h')
+ */
+
+/*
+ * GPIO bank, identified by its base address.
+ */
+template<uint32_t Base>
+class pPort {
+public:
+  static constexpr uint32_t base  = Base;
+  // Bank index; 0 = GPIOA, 1 = GPIOB, etc.
+  static constexpr unsigned index = (Base - GPIOA_BASE) / 0x400;
+  // Peripheral clock enable field.
+  #if   defined(STARm_F3)
+    typedef pRCC_AHBENR::GPIOEN<index>  enable_field;
+  #elif STARm_F1
+    typedef pRCC_APB2ENR::GPIOEN<index> enable_field;
+  #endif
+  static constexpr uint32_t enable_bit = enable_field::mask;
+
+  static GPIO_TypeDef* regs(void) { return (GPIO_TypeDef*)Base; }
+  static void clock_en(void) {
+    pClockGate::acquire<enable_field>();
+  }
+  // Bank-wide reads and writes.
+  static uint16_t read(void)           { return regs()->IDR; }
+  static void     write(uint16_t dat)  { regs()->ODR  = dat; }
+  static void     set(uint16_t mask)   { regs()->BSRR = mask; }
+  static void     clear(uint16_t mask) { regs()->BRR  = mask; }
+  static void     toggle(uint16_t mask) {
+    uint32_t odr = regs()->ODR;
+    regs()->BSRR = ((odr & mask) << 16) | (~odr & mask);
+  }
+};
+
+// Convenience definitions for the available banks.
+typedef pPort<GPIOA_BASE> pPortA;
+#ifdef GPIOB
+  typedef pPort<GPIOB_BASE> pPortB;
+#endif
+#ifdef GPIOC
+  typedef pPort<GPIOC_BASE> pPortC;
+#endif
+#ifdef GPIOD
+  typedef pPort<GPIOD_BASE> pPortD;
+#endif
+#ifdef GPIOE
+  typedef pPort<GPIOE_BASE> pPortE;
+#endif
+#ifdef GPIOF
+  typedef pPort<GPIOF_BASE> pPortF;
+#endif
+
+/*
+ * Single GPIO pin in a compile-time bank.
+ */
+template<typename Port, unsigned N>
+class pPin {
+  static_assert(N < 16, "GPIO pin numbers must be 0-15.");
+public:
+  typedef Port port;
+  static constexpr unsigned num  = N;
+  static constexpr uint16_t mask = (1 << N);
+
+  static void on(void)     { Port::regs()->BSRR = mask; }
+  static void off(void)    { Port::regs()->BRR  = mask; }
+  static void toggle(void) { Port::toggle(mask); }
+  static void write(bool on) {
+    Port::regs()->BSRR = on ? mask : (mask << 16);
+  }
+  static bool read(void) {
+    #if   defined(STARm_F1)
+      // Read the IDR bit through its bit-band alias.
+      return *STARm_BITBAND_PERIPH(Port::base + offsetof(GPIO_TypeDef, IDR), N);
+    #else
+      return (Port::regs()->IDR & mask);
+    #endif
+  }
+  // Configure the pin with one of the quick-init modes.
+  // (Defined below, because it uses the pin group class.)
+  template<pGPIO_pin_qinit Q, unsigned AF = 0>
+  static void init(void);
+};
+
+/*
+ * Pin configuration: a pin, a quick-init mode, and
+ * an alternate function number. (F0/F3/L0 only.)
+ * This just calculates the pin's register fields.
+ */
+template<typename Pin, pGPIO_pin_qinit Q, unsigned AF = 0>
+class pPinCfg {
+  static_assert(AF < 16, "Alternate function numbers must be 0-15.");
+public:
+  typedef typename Pin::port port;
+  static constexpr uint16_t mask     = Pin::mask;
+  static constexpr uint32_t pull_set = pGPIO_q_is_pullup(Q)   ? Pin::mask : 0;
+  static constexpr uint32_t pull_rst = pGPIO_q_is_pulldown(Q) ? Pin::mask : 0;
+  #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
+    static constexpr uint32_t f2_mask  = (3U << (Pin::num * 2));
+    static constexpr uint32_t moder    = (pGPIO_q_mode(Q)  << (Pin::num * 2));
+    static constexpr uint32_t otyper   = (pGPIO_q_otype(Q) << Pin::num);
+    static constexpr uint32_t ospeedr  = (pGPIO_SPEED_LOW  << (Pin::num * 2));
+    static constexpr uint32_t pupdr    = (pGPIO_q_pupd(Q)  << (Pin::num * 2));
+    // Only alternate function pins write their AFR fields.
+    static constexpr bool     is_af    = (pGPIO_q_mode(Q) == pGPIO_MODE_ALT);
+    static constexpr uint32_t afrl_msk = (is_af && Pin::num < 8) ?
+                                         (0xFU << (Pin::num * 4)) : 0;
+    static constexpr uint32_t afrh_msk = (is_af && Pin::num >= 8) ?
+                                         (0xFU << ((Pin::num - 8) * 4)) : 0;
+    static constexpr uint32_t afrl     = (is_af && Pin::num < 8) ?
+                                         (AF << (Pin::num * 4)) : 0;
+    static constexpr uint32_t afrh     = (is_af && Pin::num >= 8) ?
+                                         (AF << ((Pin::num - 8) * 4)) : 0;
+  #elif STARm_F1
+    static constexpr uint32_t crl_mask = (Pin::num < 8) ?
+                                         (0xFU << (Pin::num * 4)) : 0;
+    static constexpr uint32_t crh_mask = (Pin::num >= 8) ?
+                                         (0xFU << ((Pin::num - 8) * 4)) : 0;
+    static constexpr uint32_t crl      = (Pin::num < 8) ?
+                                         (pGPIO_q_cfg(Q) << (Pin::num * 4)) : 0;
+    static constexpr uint32_t crh      = (Pin::num >= 8) ?
+                                         (pGPIO_q_cfg(Q) << ((Pin::num - 8) * 4)) : 0;
+  #endif
+};
+
+/*
+ * Group of pin configurations in the same bank.
+ * The register fields of every pin are OR'd together at
+ * compile-time, so 'apply()' performs a single read-modify-write
+ * per configuration register, no matter how many pins there are.
+ * Usage:
+ *   pPinGroup<pPinCfg<pPin<pPortB, 6>, pGPIO_AF_OD_PULLUP, 4>,
+ *             pPinCfg<pPin<pPortB, 7>, pGPIO_AF_OD_PULLUP, 4> >::apply();
+ */
+template<typename... Cfgs>
+class pPinGroup;
+
+template<>
+class pPinGroup<> {
+public:
+  static constexpr uint16_t mask     = 0;
+  static constexpr uint32_t pull_set = 0;
+  static constexpr uint32_t pull_rst = 0;
+  #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
+    static constexpr uint32_t f2_mask  = 0;
+    static constexpr uint32_t moder    = 0;
+    static constexpr uint32_t otyper   = 0;
+    static constexpr uint32_t ospeedr  = 0;
+    static constexpr uint32_t pupdr    = 0;
+    static constexpr uint32_t afrl_msk = 0;
+    static constexpr uint32_t afrh_msk = 0;
+    static constexpr uint32_t afrl     = 0;
+    static constexpr uint32_t afrh     = 0;
+  #elif STARm_F1
+    static constexpr uint32_t crl_mask = 0;
+    static constexpr uint32_t crh_mask = 0;
+    static constexpr uint32_t crl      = 0;
+    static constexpr uint32_t crh      = 0;
+  #endif
+  static constexpr bool same_port(uint32_t base) { return true; }
+};
+
+template<typename Cfg, typename... Rest>
+class pPinGroup<Cfg, Rest...> {
+  typedef pPinGroup<Rest...> rest;
+public:
+  typedef typename Cfg::port port;
+  static constexpr bool same_port(uint32_t base) {
+    return (port::base == base) && rest::same_port(base);
+  }
+  static_assert(rest::same_port(port::base),
+                "All pins in a pPinGroup must be in the same bank.");
+  static_assert(!(Cfg::mask & rest::mask),
+                "Pins can only appear once in a pPinGroup.");
+  static constexpr uint16_t mask     = Cfg::mask     | rest::mask;
+  static constexpr uint32_t pull_set = Cfg::pull_set | rest::pull_set;
+  static constexpr uint32_t pull_rst = Cfg::pull_rst | rest::pull_rst;
+  #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
+    static constexpr uint32_t f2_mask  = Cfg::f2_mask  | rest::f2_mask;
+    static constexpr uint32_t moder    = Cfg::moder    | rest::moder;
+    static constexpr uint32_t otyper   = Cfg::otyper   | rest::otyper;
+    static constexpr uint32_t ospeedr  = Cfg::ospeedr  | rest::ospeedr;
+    static constexpr uint32_t pupdr    = Cfg::pupdr    | rest::pupdr;
+    static constexpr uint32_t afrl_msk = Cfg::afrl_msk | rest::afrl_msk;
+    static constexpr uint32_t afrh_msk = Cfg::afrh_msk | rest::afrh_msk;
+    static constexpr uint32_t afrl     = Cfg::afrl     | rest::afrl;
+    static constexpr uint32_t afrh     = Cfg::afrh     | rest::afrh;
+  #elif STARm_F1
+    static constexpr uint32_t crl_mask = Cfg::crl_mask | rest::crl_mask;
+    static constexpr uint32_t crh_mask = Cfg::crh_mask | rest::crh_mask;
+    static constexpr uint32_t crl      = Cfg::crl      | rest::crl;
+    static constexpr uint32_t crh      = Cfg::crh      | rest::crh;
+  #endif
+
+  /*
+   * Write the combined configuration to the bank's registers.
+   * Registers which no pin in the group uses are not touched;
+   * those checks are on constants, so they compile away.
+   */
+  static void apply(void) {
+    GPIO_TypeDef* gpio = port::regs();
+    #if   defined(STARm_F0) || defined(STARm_F3) || defined(STARm_L0)
+      gpio->MODER   = (gpio->MODER   & ~f2_mask) | moder;
+      gpio->OTYPER  = (gpio->OTYPER  & ~mask)    | otyper;
+      gpio->OSPEEDR = (gpio->OSPEEDR & ~f2_mask) | ospeedr;
+      gpio->PUPDR   = (gpio->PUPDR   & ~f2_mask) | pupdr;
+      if (afrl_msk) { gpio->AFR[0] = (gpio->AFR[0] & ~afrl_msk) | afrl; }
+      if (afrh_msk) { gpio->AFR[1] = (gpio->AFR[1] & ~afrh_msk) | afrh; }
+    #elif STARm_F1
+      // On the F1, ODR selects between pull-up and pull-down.
+      if (pull_set | pull_rst) { gpio->BSRR = (pull_rst << 16) | pull_set; }
+      if (crl_mask) { gpio->CRL = (gpio->CRL & ~crl_mask) | crl; }
+      if (crh_mask) { gpio->CRH = (gpio->CRH & ~crh_mask) | crh; }
+    #endif
+  }
+};
+
+// Single-pin configuration.
+template<typename Port, unsigned N>
+template<pGPIO_pin_qinit Q, unsigned AF>
+void pPin<Port, N>::init(void) {
+  pPinGroup<pPinCfg<pPin<Port, N>, Q, AF> >::apply();
+}
+
+#endif
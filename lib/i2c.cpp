@@ -1,23 +1,22 @@
 #include "i2c.h"
+#include "clock.h"
 
-// Default constructor.
-pI2C::pI2C() {}
-
-// Basic constructor; simply set the base I2C registers,
+// Choose the I2C peripheral; simply set the base registers,
 // no timing control or default initialization yet.
-pI2C::pI2C(I2C_TypeDef* i2c_regs) {
+bool pI2C::init(I2C_TypeDef* i2c_regs) {
   i2c = i2c_regs;
   if (i2c_regs == I2C1) {
-    enable_reg = STARm_RCC_APB1ENR;
-    enable_bit = RCC_APB1ENR_I2C1EN;
-    reset_reg  = STARm_RCC_APB1RSTR;
-    reset_bit  = RCC_APB1RSTR_I2C1RST;
+    enable_reg = pRCC_regs::APB1ENR::ptr();
+    enable_bit = pRCC_APB1ENR::I2C1EN::mask;
+    reset_reg  = pRCC_regs::APB1RSTR::ptr();
+    reset_bit  = pRCC_APB1RSTR::I2C1RST::mask;
   }
   else {
     status = pSTATUS_ERR;
-    return;
+    return false;
   }
   status = pSTATUS_SET;
+  return true;
 }
 
 /*
@@ -26,6 +25,7 @@ pI2C::pI2C(I2C_TypeDef* i2c_regs) {
  * (Currently not implemented for STM32F1 lines.)
  */
 unsigned pI2C::read(void) {
+  wake();
   #if    defined(STARm_F3)
     // Wait for a byte of data to be available, then read it.
     while (!(i2c->ISR & I2C_ISR_RXNE)) {}
@@ -41,6 +41,7 @@ unsigned pI2C::read(void) {
  * Write a byte of data to the I2C bus.
  */
 void pI2C::write(unsigned dat) {
+  wake();
   #if    defined(STARm_F3)
     // Transmit a byte of data, and wait for it to send.
     i2c->TXDR = (i2c->TXDR & 0xFFFFFF00) | dat;
@@ -61,6 +62,7 @@ void pI2C::write(unsigned dat) {
  */
 void pI2C::stream(volatile void* buf, int len) {
   volatile uint8_t *i2cbuf = (volatile uint8_t*) buf;
+  wake();
   #if    defined(STARm_F3)
     // The more recent chips have an internal counter to keep
     // track of how many bytes they send/receive, and it's
@@ -100,73 +102,118 @@ void pI2C::stream(volatile void* buf, int len) {
  */
 void pI2C::i2c_init(void) {
   if (status == pSTATUS_ERR) { return; }
+  wake();
   #if defined(STARm_F3)
-    // First, disable the peripheral.
-    i2c->CR1     &= ~(I2C_CR1_PE);
-    // Clear some 'CR1' bits.
-    i2c->CR1     &= ~( I2C_CR1_DNF    |
-                       I2C_CR1_ANFOFF |
-                       I2C_CR1_SMBHEN |
-                       I2C_CR1_SMBDEN );
+    // First, disable the peripheral. ('PE' must stay low for
+    // at least 3 APB cycles, which the next few writes cover.)
+    pI2C_CR1::modify(i2c->CR1, pI2C_CR1::PE::clear());
     // Clear some 'CR2' bits.
-    i2c->CR2     &= ~( I2C_CR2_RD_WRN  |
-                       I2C_CR2_NACK    |
-                       I2C_CR2_RELOAD  |
-                       I2C_CR2_AUTOEND );
-    // Clear all 'ICR' flags.
-    i2c->ICR     |=  ( I2C_ICR_ADDRCF   |
-                       I2C_ICR_NACKCF   |
-                       I2C_ICR_STOPCF   |
-                       I2C_ICR_BERRCF   |
-                       I2C_ICR_ARLOCF   |
-                       I2C_ICR_OVRCF    |
-                       I2C_ICR_PECCF    |
-                       I2C_ICR_TIMOUTCF |
-                       I2C_ICR_ALERTCF  );
-    // Configure I2C timing.
-    // Reset all but the reserved bits.
-    i2c->TIMINGR &=  (0x0F000000);
-    // set the given timing value.
+    pI2C_CR2::modify(i2c->CR2, pI2C_CR2::RD_WRN::clear() |
+                               pI2C_CR2::NACK::clear()   |
+                               pI2C_CR2::RELOAD::clear() |
+                               pI2C_CR2::AUTOEND::clear());
+    // Clear all 'ICR' flags. (Writing 0 to a flag does nothing.)
+    pI2C_ICR::write(i2c->ICR, pI2C_ICR::all());
+    // Configure I2C timing; the reserved bits are kept.
     // TODO; default to...I think 1MHz @ 48MHz?
-    i2c->TIMINGR |=  (0x50100103);
-    // Enable the peripheral.
-    i2c->CR1     |=  I2C_CR1_PE;
+    pI2C_TIMINGR::modify(i2c->TIMINGR, pI2C_TIMINGR::PRESC::val<0x5>()  |
+                                       pI2C_TIMINGR::SCLDEL::val<0x1>() |
+                                       pI2C_TIMINGR::SDADEL::val<0x0>() |
+                                       pI2C_TIMINGR::SCLH::val<0x01>()  |
+                                       pI2C_TIMINGR::SCLL::val<0x03>());
+    // Clear the filter and SMBus settings, which can only be
+    // changed while the peripheral is disabled, and enable it.
+    pI2C_CR1::modify(i2c->CR1, pI2C_CR1::DNF::clear()    |
+                               pI2C_CR1::ANFOFF::clear() |
+                               pI2C_CR1::SMBHEN::clear() |
+                               pI2C_CR1::SMBDEN::clear() |
+                               pI2C_CR1::PE::set());
   #elif  STARm_F1
-    // Perform a software reset.
-    i2c->CR1     |=  (I2C_CR1_SWRST);
-    i2c->CR1     &= ~(I2C_CR1_SWRST);
-    // Disable the peripheral.
-    i2c->CR1     &= ~(I2C_CR1_PE);
-    // The F1 series uses a different I2C peripheral than
-    // most other STM32s, so the timing parameter doesn't apply.
-    // But these don't have to be precise to work, so
-    // set the 'frequency' bits to...I dunno, 36MHz?
-    i2c->CR2     &= ~(I2C_CR2_FREQ);
-    i2c->CR2     |=  (36 << I2C_CR2_FREQ_Pos);
-    // Set the CCR bits to...uh...TODO: calculte an actual value.
-    i2c->CCR     &= ~(I2C_CCR_CCR);
-    i2c->CCR     |=  (I2C_CCR_FS | 0x24);
+    // Perform a software reset; this also clears 'PE', and
+    // the rest of the register's bits.
+    pI2C_CR1::write(i2c->CR1, pI2C_CR1::SWRST::set());
+    pI2C_CR1::write(i2c->CR1, pI2C_CR1::SWRST::clear());
+    // Set the bus timing from the current APB1 clock speed.
+    set_timing();
     // Enable the peripheral.
-    i2c->CR1     |=  (I2C_CR1_PE);
+    pI2C_CR1::write(i2c->CR1, pI2C_CR1::PE::set());
   #endif
   status = pSTATUS_RUN;
+  idle();
 }
 
+/*
+ * Clock manager callback: re-calculate the bus timing after
+ * the APB1 clock changes. The F3's I2C peripheral is clocked
+ * from HSI regardless of the core clock speed, so its
+ * 'TIMINGR' value does not need to change.
+ */
+void pI2C::clock_update(void) {
+  if (status != pSTATUS_RUN) { return; }
+  #if    defined(STARm_F1)
+    // (The registers can only be written while clocked.)
+    bool was_held = clock_held;
+    wake();
+    pI2C_CR1::modify(i2c->CR1, pI2C_CR1::PE::clear());
+    set_timing();
+    pI2C_CR1::modify(i2c->CR1, pI2C_CR1::PE::set());
+    if (!was_held) { idle(); }
+  #endif
+}
+
+/*
+ * Turn automatic clock gating on or off. While it is on, the
+ * peripheral clock is released after every 'stop' and taken
+ * again by the next access; the peripheral keeps its settings
+ * while it is not clocked. (Other drivers, like 'pI2C1Bus',
+ * may still hold the clock on.) The peripheral must have been
+ * set up with 'i2c_init' first.
+ */
+void pI2C::set_auto_gate(bool on) {
+  if (status != pSTATUS_RUN) { return; }
+  auto_gate = on;
+  if (on) { clock_hold(false); }
+  else    { clock_hold(true); }
+}
+
+#if defined(STARm_F1)
+
+/*
+ * Set the F1 I2C timing registers for 400KHz 'fast mode',
+ * using the current APB1 clock speed. The peripheral must be
+ * disabled. With a 2:1 low/high duty cycle, one SCL period is
+ * 3 * CCR peripheral clock cycles, and the maximum fast-mode
+ * rise time is 300ns.
+ */
+void pI2C::set_timing(void) {
+  uint32_t pclk = pClock::get_pclk1_hz();
+  uint32_t freq = pclk / 1000000;
+  uint32_t ccr  = pclk / (3 * 400000);
+  // 'FREQ' must be 2-36MHz, and 'CCR' must be at least 1 in FS.
+  if (freq < 2)  { freq = 2; }
+  if (freq > 36) { freq = 36; }
+  if (ccr < 1)   { ccr = 1; }
+  pI2C_CR2::modify(i2c->CR2, pI2C_CR2::FREQ::val(freq));
+  pI2C_CCR::write(i2c->CCR, pI2C_CCR::FS::set() | pI2C_CCR::CCR::val(ccr));
+  pI2C_TRISE::write(i2c->TRISE, pI2C_TRISE::TRISE::val(((freq * 300) / 1000) + 1));
+}
+
+#endif
+
 /*
  * Send a 'start' condition to the bus, asking to talk
  * with a device that has the provided 7-bit address.
  */
 void pI2C::start(uint8_t address) {
+  wake();
 #if    defined(STARm_F3)
-  // Set the device address.
-  i2c->CR2 &= ~(I2C_CR2_SADD);
-  i2c->CR2 |=  (address << I2C_CR2_SADD_Pos);
-  // Send a 'start' condition.
-  i2c->CR2 |=  (I2C_CR2_START);
+  // Set the device address, and send a 'start' condition.
+  pI2C_CR2::modify(i2c->CR2, pI2C_CR2::SADD::val(address) |
+                             pI2C_CR2::START::set());
   while ((i2c->CR2 & I2C_CR2_START)) {};
 #elif  STARm_F1
   // Generate a start condition to set the chip as a host.
-  i2c->CR1 |=  (I2C_CR1_START);
+  pI2C_CR1::modify(i2c->CR1, pI2C_CR1::START::set());
   while (!(i2c->SR1 & I2C_SR1_SB)) {};
   // Wait for the peripheral to update its role.
   while (!(i2c->SR2 & I2C_SR2_MSL)) {};
@@ -184,20 +231,23 @@ void pI2C::start(uint8_t address) {
  * Send a 'stop' condition to the I2C bus.
  */
 void pI2C::stop(void) {
+  wake();
 #if    defined(STARm_F3)
   // Send 'Stop' condition, and wait for acknowledge.
-  i2c->CR2 |=  (I2C_CR2_STOP);
+  pI2C_CR2::modify(i2c->CR2, pI2C_CR2::STOP::set());
   while ((i2c->CR2 & I2C_CR2_STOP)) {}
   // Reset the ICR ('Interrupt Clear Register') event flag.
-  i2c->ICR |=  (I2C_ICR_STOPCF);
+  pI2C_ICR::write(i2c->ICR, pI2C_ICR::STOPCF::set());
   while ((i2c->ICR & I2C_ICR_STOPCF)) {}
   // Ensure that the 'RELOAD' flag is un-set.
   set_reload_flag(0);
 #elif  STARm_F1
   // Send 'Stop' condition, and wait for acknowledge.
-  i2c->CR1 |=  (I2C_CR1_STOP);
+  pI2C_CR1::modify(i2c->CR1, pI2C_CR1::STOP::set());
   while (i2c->SR2 & I2C_SR2_MSL) {};
 #endif
+  // The bus is idle now.
+  idle();
 }
 
 #if defined(STARm_F3)
@@ -208,21 +258,17 @@ void pI2C::stop(void) {
  * bytes before you need to use the 'RELOAD' flag.
  */
 void pI2C::set_num_bytes(uint8_t nbytes) {
+  wake();
   // Set number of bytes to process in the next transmission.
-  i2c->CR2 &= ~(I2C_CR2_NBYTES);
-  i2c->CR2 |=  (nbytes << I2C_CR2_NBYTES_Pos);
+  pI2C_CR2::modify(i2c->CR2, pI2C_CR2::NBYTES::val(nbytes));
 }
 
 /*
  * Set the 'RELOAD' flag on or off.
  */
 void pI2C::set_reload_flag(bool reload) {
-  if (reload) {
-    i2c->CR2 |=  I2C_CR2_RELOAD;
-  }
-  else {
-    i2c->CR2 &= ~I2C_CR2_RELOAD;
-  }
+  wake();
+  pI2C_CR2::modify(i2c->CR2, pI2C_CR2::RELOAD::val(reload));
 }
 
 #endif
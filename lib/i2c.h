@@ -14,9 +14,9 @@
  */
 class pI2C : public pIO {
 public:
-  // Constructors.
-  pI2C();
-  pI2C(I2C_TypeDef* i2c_regs);
+  // Constructor; call 'init' to choose an I2C peripheral.
+  constexpr pI2C() {}
+  bool     init(I2C_TypeDef* i2c_regs);
   // Common r/w methods from the core I/O class.
   unsigned read(void);
   void     write(unsigned dat);
@@ -25,6 +25,11 @@ public:
   void     i2c_init(void); /* TODO: Timing */
   void     start(uint8_t address);
   void     stop(void);
+  // Turn the peripheral clock off whenever the bus is idle,
+  // between a 'stop' and the next access.
+  void     set_auto_gate(bool on);
+  // Clock manager callback.
+  void     clock_update(void);
   #if   defined(STARm_F3)
     void   set_num_bytes(uint8_t nbytes);
     void   set_reload_flag(bool reload);
@@ -32,6 +37,13 @@ public:
 protected:
   // I2C struct from the device header files.
   I2C_TypeDef* i2c = NULL;
+  // Is the clock gated off while the bus is idle?
+  bool         auto_gate = false;
+  void         wake(void) { if (auto_gate) { clock_hold(true); } }
+  void         idle(void) { if (auto_gate) { clock_hold(false); } }
+  #if   defined(STARm_F1)
+    void   set_timing(void);
+  #endif
 private:
 };
 
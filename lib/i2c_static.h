@@ -0,0 +1,163 @@
+#ifndef __STARm_I2C_STATIC_H
+#define __STARm_I2C_STATIC_H
+
+// Project includes.
+#include "io_static.h"
+#include "clock.h"
+
+/*
+ * Compile-time I2C bus driver; see 'io_static.h'.
+ * This works the same way as the 'pI2C' class, but every method
+ * is static and inline, so streaming a buffer is a single loop
+ * with the register polling inlined. For example:
+ *   pI2C1Bus::init();
+ *   pI2C1Bus::start(0x78);
+ *   pI2C1Bus::stream(buf, len);
+ *   pI2C1Bus::stop();
+ * The pins must be set up separately, like with 'pI2C'.
+ */
+template<uint32_t Base>
+class pI2CBus : public pIOBase<pI2CBus<Base> > {
+  static_assert(Base == I2C1_BASE, "Only I2C1 is currently supported.");
+public:
+  static constexpr uint32_t base        = Base;
+  static constexpr uint32_t enable_addr = pRCC_regs::APB1ENR::addr;
+  static constexpr uint32_t enable_bit  = pRCC_APB1ENR::I2C1EN::mask;
+  static constexpr uint32_t reset_addr  = pRCC_regs::APB1RSTR::addr;
+  static constexpr uint32_t reset_bit   = pRCC_APB1RSTR::I2C1RST::mask;
+  // Register descriptions; see 'regs.h'.
+  typedef pI2C_regs<Base> r;
+
+  static I2C_TypeDef* regs(void) { return (I2C_TypeDef*)Base; }
+
+  /*
+   * Initialize and enable the peripheral, with the same timing
+   * as 'pI2C::i2c_init'.
+   */
+  static void init(void) {
+    #if   defined(STARm_F3)
+      r::CR1::modify(pI2C_CR1::PE::clear());
+      r::CR2::modify(pI2C_CR2::RD_WRN::clear() | pI2C_CR2::NACK::clear() |
+                     pI2C_CR2::RELOAD::clear() | pI2C_CR2::AUTOEND::clear());
+      r::ICR::write(pI2C_ICR::all());
+      r::TIMINGR::modify(pI2C_TIMINGR::PRESC::val<0x5>()  |
+                         pI2C_TIMINGR::SCLDEL::val<0x1>() |
+                         pI2C_TIMINGR::SDADEL::val<0x0>() |
+                         pI2C_TIMINGR::SCLH::val<0x01>()  |
+                         pI2C_TIMINGR::SCLL::val<0x03>());
+      r::CR1::modify(pI2C_CR1::DNF::clear()    | pI2C_CR1::ANFOFF::clear() |
+                     pI2C_CR1::SMBHEN::clear() | pI2C_CR1::SMBDEN::clear() |
+                     pI2C_CR1::PE::set());
+    #elif STARm_F1
+      r::CR1::write(pI2C_CR1::SWRST::set());
+      r::CR1::write(pI2C_CR1::SWRST::clear());
+      set_timing();
+      r::CR1::write(pI2C_CR1::PE::set());
+    #endif
+  }
+
+  // Send a 'start' condition and a 7-bit write address.
+  static void start(uint8_t address) {
+    I2C_TypeDef* i2c = regs();
+    #if   defined(STARm_F3)
+      r::CR2::modify(pI2C_CR2::SADD::val(address) | pI2C_CR2::START::set());
+      while ((i2c->CR2 & I2C_CR2_START)) {};
+    #elif STARm_F1
+      r::CR1::modify(pI2C_CR1::START::set());
+      while (!(i2c->SR1 & I2C_SR1_SB)) {};
+      while (!(i2c->SR2 & I2C_SR2_MSL)) {};
+      i2c->DR   =  (address);
+      while (!(i2c->SR1 & I2C_SR1_ADDR)) {};
+      (void) i2c->SR2;
+    #endif
+  }
+
+  // Send a 'stop' condition.
+  static void stop(void) {
+    I2C_TypeDef* i2c = regs();
+    #if   defined(STARm_F3)
+      r::CR2::modify(pI2C_CR2::STOP::set());
+      while ((i2c->CR2 & I2C_CR2_STOP)) {}
+      r::ICR::write(pI2C_ICR::STOPCF::set());
+      while ((i2c->ICR & I2C_ICR_STOPCF)) {}
+      set_reload_flag(0);
+    #elif STARm_F1
+      r::CR1::modify(pI2C_CR1::STOP::set());
+      while (i2c->SR2 & I2C_SR2_MSL) {};
+    #endif
+  }
+
+  // Write one byte, and wait for it to send.
+  static void write(unsigned dat) {
+    I2C_TypeDef* i2c = regs();
+    #if   defined(STARm_F3)
+      i2c->TXDR = (uint8_t)dat;
+      while (!(i2c->ISR & (I2C_ISR_TXIS | I2C_ISR_TC |
+                           I2C_ISR_TCR))) {};
+    #elif STARm_F1
+      i2c->DR   = (uint8_t)dat;
+      while (!(i2c->SR1 & I2C_SR1_TXE)) {};
+    #endif
+  }
+
+  // Read one byte. (Not implemented for the F1, like 'pI2C'.)
+  static unsigned read(void) {
+    #if   defined(STARm_F3)
+      while (!(regs()->ISR & I2C_ISR_RXNE)) {}
+      return (regs()->RXDR & 0xFF);
+    #elif STARm_F1
+      return 0x00;
+    #endif
+  }
+
+  #if defined(STARm_F3)
+    /*
+     * Stream a buffer; the F3 peripheral can only send 255 bytes
+     * per 'NBYTES' block, so the 'RELOAD' flag must be set
+     * before streaming more than that.
+     */
+    static void stream(const volatile void* buf, int len) {
+      const volatile uint8_t* bytes = (const volatile uint8_t*)buf;
+      while (len > 0) {
+        int block = (len > 255) ? 255 : len;
+        set_num_bytes(block);
+        for (int i = 0; i < block; ++i) { write(bytes[i]); }
+        bytes += block;
+        len   -= block;
+      }
+    }
+    static void set_num_bytes(uint8_t nbytes) {
+      r::CR2::modify(pI2C_CR2::NBYTES::val(nbytes));
+    }
+    static void set_reload_flag(bool reload) {
+      r::CR2::modify(pI2C_CR2::RELOAD::val(reload));
+    }
+  #elif STARm_F1
+    // Re-calculate the bus timing after the APB1 clock changes.
+    // (The clock may be gated off while the bus is idle.)
+    static void clock_update(void) {
+      pIOBase<pI2CBus<Base> >::clock_en();
+      r::CR1::modify(pI2C_CR1::PE::clear());
+      set_timing();
+      r::CR1::modify(pI2C_CR1::PE::set());
+      pIOBase<pI2CBus<Base> >::disable();
+    }
+    // 400KHz 'fast mode' timing; see 'pI2C::set_timing'.
+    static void set_timing(void) {
+      uint32_t pclk = pClock::get_pclk1_hz();
+      uint32_t freq = pclk / 1000000;
+      uint32_t ccr  = pclk / (3 * 400000);
+      if (freq < 2)  { freq = 2; }
+      if (freq > 36) { freq = 36; }
+      if (ccr < 1)   { ccr = 1; }
+      r::CR2::modify(pI2C_CR2::FREQ::val(freq));
+      r::CCR::write(pI2C_CCR::FS::set() | pI2C_CCR::CCR::val(ccr));
+      r::TRISE::write(pI2C_TRISE::TRISE::val(((freq * 300) / 1000) + 1));
+    }
+  #endif
+};
+
+// Convenience definitions for the available buses.
+typedef pI2CBus<I2C1_BASE> pI2C1Bus;
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __STARm_IO_STATIC_H
+#define __STARm_IO_STATIC_H
+
+#include <stddef.h>
+
+// Project includes.
+#include "core.h"
+#include "clockgate.h"
+
+/*
+ * Compile-time I/O peripheral base class.
+ * This is a static ('CRTP') alternative to the 'pIO' class, for
+ * peripherals which are known when the program is compiled; like
+ * the 'pPort' / 'pPin' GPIO templates, the drivers built on it
+ * have no member variables and no virtual methods. Each driver
+ * passes itself in as 'Derived', and provides:
+ *   - 'enable_addr' / 'enable_bit' and 'reset_addr' / 'reset_bit':
+ *     its RCC register addresses and bits, as constants. (So the
+ *     'register descriptors' are immediate values in flash,
+ *     instead of four words of RAM per object.)
+ *   - 'read()' and 'write(dat)'.
+ * The common methods call the driver's methods directly, so
+ * 'stream' becomes a loop with the driver's 'write' inlined,
+ * rather than one virtual call per byte.
+ * These classes don't track any status; 'init' must be called
+ * before the other methods are used. They also don't track their
+ * clock references, so every 'clock_en' must be matched by one
+ * 'disable'. (See 'clockgate.h')
+ */
+template<typename Derived>
+class pIOBase {
+public:
+  // Peripheral clock and reset control.
+  static void clock_en(void) {
+    pClockGate::acquire((__IO uint32_t*)Derived::enable_addr,
+                        Derived::enable_bit);
+  }
+  static void disable(void) {
+    pClockGate::release((__IO uint32_t*)Derived::enable_addr,
+                        Derived::enable_bit);
+  }
+  static void reset(void) {
+    *(__IO uint32_t*)Derived::reset_addr  |=  (Derived::reset_bit);
+    *(__IO uint32_t*)Derived::reset_addr  &= ~(Derived::reset_bit);
+  }
+  // Write a buffer of bytes, one by one.
+  static void stream(const volatile void* buf, int len) {
+    const volatile uint8_t* bytes = (const volatile uint8_t*)buf;
+    for (int i = 0; i < len; ++i) {
+      Derived::write(bytes[i]);
+    }
+  }
+  // Wait for buffered output to finish sending.
+  // (Drivers which buffer any hide this with their own version.)
+  static void flush(void) {}
+  // Re-calculate any clock-dependent settings.
+  // (Drivers which have any hide this with their own version.)
+  static void clock_update(void) {}
+};
+
+/*
+ * Run-time wrapper for a compile-time driver: a 'pIO' object
+ * whose virtual methods call the driver's static ones. It lets a
+ * static driver be passed to code which takes a 'pIO*', like the
+ * stack monitor's reports or the clock manager's listeners,
+ * without giving up the inlined versions elsewhere. For example:
+ *   static pIOAdapter<pUART2Port<115200> > report_io;
+ *   pStackMon::start_task(10000, &report_io);
+ */
+template<typename Driver>
+class pIOAdapter : public pIO {
+public:
+  constexpr pIOAdapter() {}
+  unsigned read(void)                       { return Driver::read(); }
+  void     write(unsigned dat)              { Driver::write(dat); }
+  void     stream(volatile void* buf, int len) { Driver::stream(buf, len); }
+  void     flush(void)                      { Driver::flush(); }
+  void     clock_en(void)                   { Driver::clock_en(); }
+  void     reset(void)                      { Driver::reset(); }
+  void     disable(void)                    { Driver::disable(); }
+  int      get_status(void)                 { return pSTATUS_RUN; }
+  void     clock_update(void)               { Driver::clock_update(); }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "log.h"
+#include "semihost.h"
+
+// Record buffer; see 'logring.h'.
+static pLogRing<pLOG_BUFFER_WORDS> ring;
+// Messages dropped because the buffer was full.
+static volatile uint32_t dropped    = 0;
+// Drain task settings.
+static pRTOS_RAM pTask<pLOG_TASK_STACK> drain_task_mem;
+static unsigned          drain_period = 0;
+static pIO*              drain_link   = NULL;
+// Semihosting file handle, once it is open.
+static int               semihost_file = -1;
+
+/* Enable the DWT cycle counter, for timestamps. */
+void pLog::init(void) {
+  CoreDebug->DEMCR |= (CoreDebug_DEMCR_TRCENA_Msk);
+  DWT->CTRL        |= (DWT_CTRL_CYCCNTENA_Msk);
+}
+
+/*
+ * Write a record into the buffer, or count it as dropped if
+ * there is not enough room.
+ */
+void pLog::record(uint32_t id, unsigned nargs, const uint32_t* args) {
+  uint32_t stamp = DWT->CYCCNT;
+  if (!ring.write(id, stamp, nargs, args)) {
+    __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+  }
+}
+
+/*
+ * Send one record, to a link or with semihosting (if 'link' is
+ * NULL). Semihosting output is discarded if no debugger is
+ * attached.
+ */
+void pLog::emit(pIO* link, const uint32_t* words, unsigned len) {
+  if (link) {
+    link->write(pLOG_SYNC);
+    for (unsigned i = 0; i < len; ++i) { link->write_le(words[i]); }
+    return;
+  }
+  if (!(CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk)) { return; }
+  if (semihost_file < 0) {
+    const char* name = pLOG_SEMIHOST_FILE;
+    uint32_t open_args[3] = { (uint32_t)name, pSEMIHOST_MODE_WB,
+                              sizeof(pLOG_SEMIHOST_FILE) - 1 };
+    semihost_file = pSemihost::call(pSEMIHOST_SYS_OPEN, open_args);
+    if (semihost_file < 0) { return; }
+  }
+  // (The cores are little-endian, so the words can be copied.)
+  uint8_t bytes[1 + ((pLOG_MAX_ARGS + 2) * 4)];
+  bytes[0] = pLOG_SYNC;
+  for (unsigned i = 0; i < (len * 4); ++i) {
+    bytes[1 + i] = ((const uint8_t*)words)[i];
+  }
+  uint32_t write_args[3] = { (uint32_t)semihost_file, (uint32_t)bytes,
+                             1 + (len * 4) };
+  pSemihost::call(pSEMIHOST_SYS_WRITE, write_args);
+}
+
+/*
+ * Send every finished record, followed by a 'dropped' record
+ * if any messages were lost.
+ */
+unsigned pLog::drain_to(pIO* link) {
+  unsigned sent = 0;
+  uint32_t rec[pLOG_MAX_ARGS + 2];
+  unsigned len;
+  while ((len = ring.read(rec))) {
+    emit(link, rec, len);
+    ++sent;
+  }
+  uint32_t lost = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+  if (lost) {
+    rec[0] = ((pLOG_ID_DROPPED << 4) | 1);
+    rec[1] = DWT->CYCCNT;
+    rec[2] = lost;
+    emit(link, rec, 3);
+    ++sent;
+  }
+  if (link) { link->flush(); }
+  return sent;
+}
+
+unsigned pLog::drain(pIO* link) {
+  if (!link) { return 0; }
+  return drain_to(link);
+}
+
+unsigned pLog::drain_semihosting(void) { return drain_to(NULL); }
+
+unsigned pLog::get_dropped(void) { return dropped; }
+
+/* Drain task: send the buffered records periodically. */
+void pLog::drain_task(void* args) {
+  (void)args;
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(drain_period));
+    drain_to(drain_link);
+  }
+}
+
+/* Start the drain task. */
+bool pLog::start_task(unsigned period_ms, pIO* link) {
+  if (!period_ms) { return false; }
+  drain_period = period_ms;
+  drain_link   = link;
+  return (drain_task_mem.start_background(drain_task, "Log_Drain") != NULL);
+}
@@ -0,0 +1,105 @@
+#ifndef __STARm_LOG_H
+#define __STARm_LOG_H
+
+#include <stdint.h>
+
+// Project includes.
+#include "core.h"
+#include "rtos.h"
+#include "logring.h"
+
+// Project macro definitions.
+// Log buffer size, in words. (Must be a power of two.)
+#define pLOG_BUFFER_WORDS (256)
+// Maximum number of arguments per log message.
+#define pLOG_MAX_ARGS     (15)
+// Drain task stack size, in words.
+#define pLOG_TASK_STACK   (128)
+// Byte which starts every record in the output stream.
+#define pLOG_SYNC         (0xA5)
+// Message ID of the 'records were dropped' record.
+#define pLOG_ID_DROPPED   (0)
+// File which 'drain_semihosting' writes on the debugger's host.
+#define pLOG_SEMIHOST_FILE "starm_log.bin"
+
+/*
+ * Log a message, printf-style:
+ *   pLOG("frame took %u cycles", cycles);
+ * The format string is never formatted, copied, or even stored
+ * in flash: it goes in the '.log_fmt' ELF section, which is not
+ * loaded onto the chip, and its address in that section is the
+ * message's ID. Only the ID, a timestamp and the raw argument
+ * words are recorded; the 'log_decode' host tool looks the
+ * strings up in the ELF file and formats the messages.
+ * Format strings must be string literals.
+ */
+#define pLOG(fmt, ...) pLog::write(pLOG_ID(fmt), ##__VA_ARGS__)
+#define pLOG_ID(fmt) ([]() -> uint32_t {                        \
+    static const char pLOG_fmt[]                                \
+      __attribute__((section(".log_fmt"), used)) = fmt;         \
+    return (uint32_t)(uintptr_t)pLOG_fmt; }())
+
+/*
+ * Deferred binary logger.
+ * Messages are written into a RAM ring buffer of 32-bit words,
+ * one record each:
+ *   header:    (ID << 4) | number of arguments
+ *   timestamp: DWT cycle counter
+ *   arguments: one word each
+ * Space is reserved with a compare-and-swap on the write index,
+ * so any task or interrupt handler can log without a lock; see
+ * 'logring.h'. If the buffer is full, the message is dropped
+ * and counted, and the count is sent once there is room.
+ *
+ * 'drain' sends finished records to a serial link, and
+ * 'drain_semihosting' to a 'pLOG_SEMIHOST_FILE' file on the
+ * debugger's host; each record is sent as a 'pLOG_SYNC' byte
+ * followed by its words, little-endian. 'start_task' starts a
+ * low-priority task which drains the buffer periodically. Only
+ * one task should drain the buffer.
+ * Arguments are stored as 32-bit words: integers, pointers, and
+ * 'float' / 'double' values (as single-precision floats). A '%s'
+ * argument is decoded from the ELF file, so it must point to a
+ * constant string.
+ * This is a static class.
+ */
+class pLog {
+public:
+  // Enable the cycle counter for timestamps.
+  static void     init(void);
+  // Record a message; use the 'pLOG' macro instead.
+  template<typename... Args>
+  static void write(uint32_t id, Args... args) {
+    static_assert(sizeof...(Args) <= pLOG_MAX_ARGS,
+                  "Too many log message arguments.");
+    const uint32_t words[sizeof...(Args) + 1] = { arg(args)..., 0 };
+    record(id, sizeof...(Args), words);
+  }
+  static void     record(uint32_t id, unsigned nargs,
+                         const uint32_t* args);
+  // Send finished records; returns the number sent.
+  static unsigned drain(pIO* link);
+  static unsigned drain_semihosting(void);
+  // Start a low-priority task which drains the buffer every
+  // 'period_ms', to 'link', or with semihosting if it is NULL.
+  static bool     start_task(unsigned period_ms, pIO* link);
+  // Number of messages dropped since the last drain.
+  static unsigned get_dropped(void);
+protected:
+  // Argument conversions.
+  static uint32_t arg(float v) {
+    union { float f; uint32_t u; } c;
+    c.f = v;
+    return c.u;
+  }
+  static uint32_t arg(double v) { return arg((float)v); }
+  template<typename T>
+  static uint32_t arg(T* v)     { return (uint32_t)(uintptr_t)v; }
+  template<typename T>
+  static uint32_t arg(T v)      { return (uint32_t)v; }
+  static unsigned drain_to(pIO* link);
+  static void     emit(pIO* link, const uint32_t* words, unsigned len);
+  static void     drain_task(void* args);
+};
+
+#endif
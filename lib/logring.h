@@ -0,0 +1,102 @@
+#ifndef __STARm_LOGRING_H
+#define __STARm_LOGRING_H
+
+// Standard library includes.
+#include <stdint.h>
+
+/*
+ * Lock-free multi-producer, single-consumer buffer of
+ * variable-length records, for the 'pLog' class. Each record is:
+ *   header:    (ID << 4) | number of arguments (non-zero)
+ *   timestamp
+ *   arguments: one word each
+ * Writers reserve space with a compare-and-swap on 'head', so
+ * any task or interrupt handler can write without a lock; if an
+ * interrupt writes a record between the load and the swap, the
+ * swap fails and retries. A record's header is written last,
+ * with a 'release' store.
+ *
+ * Every word outside of the reserved records is 0. The reader
+ * clears all of a record's words before it frees them, so a
+ * reserved record whose header is still 0 is not finished yet,
+ * and the reader waits for it; it never reads past 'head'.
+ * Only one task should read.
+ *
+ * The same code is correct across threads on a PC, which lets
+ * 'tools/log_stress' test it. 'N' must be a power of two. Like
+ * 'pRingBuffer', this has no constructor; zeroed memory is a
+ * valid empty buffer, so declare these at file scope.
+ */
+template<unsigned N>
+class pLogRing {
+  static_assert(N >= 32 && (N & (N - 1)) == 0,
+                "Log buffer length must be a power of two.");
+public:
+  static constexpr unsigned length = N;
+
+  // Length of a record in words, from its header.
+  static unsigned record_len(uint32_t header) {
+    return (header & 0xF) + 2;
+  }
+
+  // Writer side: returns false if there is not enough room.
+  bool write(uint32_t id, uint32_t stamp,
+             unsigned nargs, const uint32_t* args) {
+    uint32_t len = nargs + 2;
+    uint32_t h   = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    do {
+      if (((h + len) - load_acquire(&tail)) > N) { return false; }
+    } while (!__atomic_compare_exchange_n(&head, &h, h + len, true,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+    buffer[(h + 1) & (N - 1)] = stamp;
+    for (unsigned i = 0; i < nargs; ++i) {
+      buffer[(h + 2 + i) & (N - 1)] = args[i];
+    }
+    // Publish the record by writing its header.
+    __atomic_store_n(&buffer[h & (N - 1)], ((id << 4) | nargs),
+                     __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // Reader side: copy the oldest finished record into 'rec',
+  // which must hold 17 words, and free its space. Returns the
+  // record's length in words, or 0 if there is none yet.
+  unsigned read(uint32_t* rec) {
+    uint32_t t = tail;
+    if (t == load_acquire(&head)) { return 0; }
+    uint32_t header = __atomic_load_n(&buffer[t & (N - 1)],
+                                      __ATOMIC_ACQUIRE);
+    if (!header) { return 0; }
+    unsigned len = record_len(header);
+    rec[0] = header;
+    __atomic_store_n(&buffer[t & (N - 1)], 0, __ATOMIC_RELAXED);
+    for (unsigned i = 1; i < len; ++i) {
+      rec[i] = buffer[(t + i) & (N - 1)];
+      buffer[(t + i) & (N - 1)] = 0;
+    }
+    // (The cleared words are handed back with the space.)
+    store_release(&tail, t + len);
+    return len;
+  }
+
+  // Either side.
+  unsigned size(void) {
+    return load_acquire(&head) - load_acquire(&tail);
+  }
+  bool     empty(void) { return size() == 0; }
+
+protected:
+  static uint32_t load_acquire(const volatile uint32_t* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+  }
+  static void store_release(volatile uint32_t* p, uint32_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+  }
+
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  uint32_t          buffer[N];
+};
+
+#endif
@@ -0,0 +1,457 @@
+#include "lowpower.h"
+#include "trace.h"
+
+// Calibrated RTC counter speed; 0 until the LSI is calibrated,
+// which keeps the chip out of STOP mode.
+static volatile uint32_t rtc_hz      = 0;
+// Number of drivers which need the high-speed clocks.
+static volatile uint32_t stop_locks  = 0;
+// Statistics.
+static volatile uint32_t sleep_count = 0;
+static volatile uint32_t stop_count  = 0;
+
+#if defined(STARm_F3)
+  // The F3 RTC counts in 'seconds + subseconds', and wraps
+  // around once per day.
+  #define pLOWPOWER_RTC_WRAP      (86400UL * pLOWPOWER_RTC_NOMINAL_HZ)
+  // The wakeup timer's reload register is 16 bits wide.
+  #define pLOWPOWER_RTC_MAX_WAIT  (0x10000UL)
+#elif STARm_F1
+  // The F1 RTC is a plain 32-bit counter.
+  #define pLOWPOWER_RTC_MAX_WAIT  (0x7FFFFFFFUL)
+#endif
+
+/*
+ * Kernel hook: with 'configUSE_TICKLESS_IDLE' set to 2, the port
+ * layer leaves 'vPortSuppressTicksAndSleep' to the application.
+ */
+extern "C" void vPortSuppressTicksAndSleep(TickType_t expected_ticks) {
+  pLowPower::idle(expected_ticks);
+}
+
+/*
+ * RTC wakeup interrupt handlers. They only clear the flags;
+ * 'idle_stop' does the rest once the chip is awake.
+ */
+#if defined(STARm_F3)
+extern "C" void RTC_wakeup_IRQ_handler(void) {
+  pTRACE_ISR_ENTER();
+  // (Write-protection does not cover the ISR flag bits.)
+  RTC->ISR &= ~(RTC_ISR_WUTF);
+  EXTI->PR  =  (EXTI_PR_PR20);
+  pTRACE_ISR_EXIT();
+}
+#elif STARm_F1
+extern "C" void RTC_alarm_IRQ_handler(void) {
+  pTRACE_ISR_ENTER();
+  RTC->CRL &= ~(RTC_CRL_ALRF);
+  EXTI->PR  =  (EXTI_PR_PR17);
+  pTRACE_ISR_EXIT();
+}
+#endif
+
+/*
+ * Number of RTC counts from 'start' to 'now'.
+ */
+static uint32_t rtc_diff(uint32_t start, uint32_t now) {
+  #if defined(STARm_F3)
+    if (now < start) { return (now + pLOWPOWER_RTC_WRAP) - start; }
+  #endif
+  return now - start;
+}
+
+/*
+ * Set up the RTC to count at about 20KHz from the LSI oscillator,
+ * and calibrate it. Returns false if the LSI did not calibrate;
+ * in that case only SLEEP mode is used.
+ */
+bool pLowPower::init(void) {
+  // Enable the power interface and backup domain access.
+  #if defined(STARm_F3)
+    RCC->APB1ENR |=  (RCC_APB1ENR_PWREN);
+  #elif STARm_F1
+    RCC->APB1ENR |=  (RCC_APB1ENR_PWREN |
+                      RCC_APB1ENR_BKPEN);
+  #endif
+  PWR->CR        |=  (PWR_CR_DBP);
+  // Start the LSI oscillator.
+  RCC->CSR       |=  (RCC_CSR_LSION);
+  while (!(RCC->CSR & RCC_CSR_LSIRDY)) {};
+  // The RTC clock source can only be changed after a backup
+  // domain reset.
+  if ((RCC->BDCR & RCC_BDCR_RTCSEL) != RCC_BDCR_RTCSEL_LSI) {
+    RCC->BDCR    |=  (RCC_BDCR_BDRST);
+    RCC->BDCR    &= ~(RCC_BDCR_BDRST);
+    RCC->BDCR    |=  (RCC_BDCR_RTCSEL_LSI);
+  }
+  RCC->BDCR      |=  (RCC_BDCR_RTCEN);
+  #if defined(STARm_F3)
+    // Unlock the RTC registers and enter initialization mode.
+    RTC->WPR      =  (0xCA);
+    RTC->WPR      =  (0x53);
+    RTC->ISR     |=  (RTC_ISR_INIT);
+    while (!(RTC->ISR & RTC_ISR_INITF)) {};
+    // 40KHz / (1 + 1) = 20KHz subsecond counter, and
+    // 20KHz / (19999 + 1) = 1Hz seconds counter. The prescalers
+    // must be written in two separate steps.
+    RTC->PRER     =  (pLOWPOWER_RTC_NOMINAL_HZ - 1);
+    RTC->PRER    |=  (1 << RTC_PRER_PREDIV_A_Pos);
+    RTC->TR       =  (0);
+    RTC->ISR     &= ~(RTC_ISR_INIT);
+    // Wakeup timer: RTCCLK / 2, the same rate as the subsecond
+    // counter. It is enabled before each STOP period.
+    RTC->CR      &= ~(RTC_CR_WUTE);
+    while (!(RTC->ISR & RTC_ISR_WUTWF)) {};
+    RTC->CR       =  ((RTC->CR & ~(RTC_CR_WUCKSEL)) |
+                      RTC_CR_WUCKSEL_0 | RTC_CR_WUCKSEL_1);
+    RTC->CR      |=  (RTC_CR_WUTIE);
+    RTC->WPR      =  (0xFF);
+    // The wakeup timer is connected to EXTI line 20.
+    EXTI->IMR    |=  (EXTI_IMR_MR20);
+    EXTI->RTSR   |=  (EXTI_RTSR_TR20);
+    EXTI->PR      =  (EXTI_PR_PR20);
+    NVIC_SetPriority(RTC_WKUP_IRQn, 0x06);
+    NVIC_EnableIRQ(RTC_WKUP_IRQn);
+  #elif STARm_F1
+    // 40KHz / (1 + 1) = 20KHz counter.
+    rtc_sync();
+    while (!(RTC->CRL & RTC_CRL_RTOFF)) {};
+    RTC->CRL     |=  (RTC_CRL_CNF);
+    RTC->PRLH     =  (0);
+    RTC->PRLL     =  (1);
+    RTC->CNTH     =  (0);
+    RTC->CNTL     =  (0);
+    RTC->CRL     &= ~(RTC_CRL_CNF);
+    while (!(RTC->CRL & RTC_CRL_RTOFF)) {};
+    // The RTC alarm is connected to EXTI line 17.
+    RTC->CRH     |=  (RTC_CRH_ALRIE);
+    EXTI->IMR    |=  (EXTI_IMR_MR17);
+    EXTI->RTSR   |=  (EXTI_RTSR_TR17);
+    EXTI->PR      =  (EXTI_PR_PR17);
+    NVIC_SetPriority(RTC_Alarm_IRQn, 0x06);
+    NVIC_EnableIRQ(RTC_Alarm_IRQn);
+  #endif
+  return calibrate();
+}
+
+/*
+ * Measure the RTC counter speed against the core clock.
+ * The LSI oscillator's speed varies a lot between chips, and
+ * with temperature, so the nominal speed is not good enough to
+ * keep track of time in STOP mode.
+ */
+bool pLowPower::calibrate(void) {
+  // Use the DWT cycle counter. (Already running if the
+  // run-time stats are enabled.)
+  CoreDebug->DEMCR |= (CoreDebug_DEMCR_TRCENA_Msk);
+  DWT->CTRL        |= (DWT_CTRL_CYCCNTENA_Msk);
+  rtc_sync();
+  // Start on the edge of an RTC count.
+  uint32_t start = rtc_now();
+  while (rtc_now() == start) {};
+  start = rtc_now();
+  uint32_t cycles_start = DWT->CYCCNT;
+  while (rtc_diff(start, rtc_now()) < pLOWPOWER_CAL_COUNTS) {};
+  uint32_t cycles = DWT->CYCCNT - cycles_start;
+  uint32_t hz = (uint32_t)(((uint64_t)pLOWPOWER_CAL_COUNTS *
+                            sys_clock_hz) / cycles);
+  // The LSI should be within 50% of its nominal speed.
+  if (hz < (pLOWPOWER_RTC_NOMINAL_HZ / 2) ||
+      hz > (pLOWPOWER_RTC_NOMINAL_HZ * 2)) {
+    rtc_hz = 0;
+    return false;
+  }
+  rtc_hz = hz;
+  return true;
+}
+
+/*
+ * Keep the chip out of STOP mode.
+ */
+void pLowPower::stop_lock(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  ++stop_locks;
+  __set_PRIMASK(primask);
+}
+
+/*
+ * Allow STOP mode again, once every lock has been released.
+ */
+void pLowPower::stop_unlock(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (stop_locks) { --stop_locks; }
+  __set_PRIMASK(primask);
+}
+
+bool pLowPower::stop_allowed(void) {
+  return (stop_locks == 0 && rtc_hz != 0);
+}
+
+/* Statistics. */
+uint32_t pLowPower::get_sleep_count(void) { return sleep_count; }
+uint32_t pLowPower::get_stop_count(void)  { return stop_count; }
+uint32_t pLowPower::get_rtc_hz(void)      { return rtc_hz; }
+
+/*
+ * Tickless idle entry point; pick a sleep mode.
+ */
+void pLowPower::idle(TickType_t expected_ticks) {
+  if (expected_ticks >= pLOWPOWER_STOP_MIN_TICKS && stop_allowed()) {
+    idle_stop(expected_ticks);
+  }
+  else {
+    idle_sleep(expected_ticks);
+  }
+}
+
+/*
+ * SLEEP mode: stretch the SysTick period to cover the idle time.
+ * This follows the FreeRTOS port's default implementation, but
+ * the SysTick speed is read at run-time, since it changes with
+ * the system clock.
+ */
+void pLowPower::idle_sleep(TickType_t expected_ticks) {
+  uint32_t per_tick  = (configSYSTICK_CLOCK_HZ / configTICK_RATE_HZ);
+  uint32_t max_ticks = (0x00FFFFFF / per_tick);
+  uint32_t clk_bits  = (SysTick->CTRL & SysTick_CTRL_CLKSOURCE_Msk);
+  if (expected_ticks > max_ticks) { expected_ticks = max_ticks; }
+  // Stop the SysTick timer while its period is changed.
+  SysTick->CTRL &= ~(SysTick_CTRL_ENABLE_Msk);
+  uint32_t reload = SysTick->VAL + (per_tick * (expected_ticks - 1));
+  if (reload > pLOWPOWER_SYSTICK_COMP) {
+    reload -= pLOWPOWER_SYSTICK_COMP;
+  }
+  __disable_irq();
+  __DSB();
+  __ISB();
+  if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+    // A task became ready; restart the current tick period.
+    SysTick->LOAD  = SysTick->VAL;
+    SysTick->CTRL |=  (SysTick_CTRL_ENABLE_Msk);
+    SysTick->LOAD  =  (per_tick - 1);
+    __enable_irq();
+    return;
+  }
+  SysTick->LOAD = reload;
+  SysTick->VAL  = 0;
+  SysTick->CTRL |= (SysTick_CTRL_ENABLE_Msk);
+  __DSB();
+  __WFI();
+  __ISB();
+  ++sleep_count;
+  // Re-enable interrupts briefly so that the interrupt which
+  // woke the core up is handled first.
+  __enable_irq();
+  __DSB();
+  __ISB();
+  __disable_irq();
+  SysTick->CTRL = (clk_bits | SysTick_CTRL_TICKINT_Msk);
+  uint32_t completed;
+  if (SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) {
+    // The SysTick timer ran out, so the full time passed.
+    uint32_t calc = (per_tick - 1) - (reload - SysTick->VAL);
+    if (calc >= per_tick || calc > reload) { calc = per_tick - 1; }
+    SysTick->LOAD = calc;
+    completed     = expected_ticks - 1;
+  }
+  else {
+    // Something else woke the core up.
+    uint32_t elapsed = (expected_ticks * per_tick) - SysTick->VAL;
+    completed        = elapsed / per_tick;
+    SysTick->LOAD    = ((completed + 1) * per_tick) - elapsed;
+  }
+  SysTick->VAL  = 0;
+  SysTick->CTRL = (clk_bits | SysTick_CTRL_TICKINT_Msk |
+                   SysTick_CTRL_ENABLE_Msk);
+  vTaskStepTick(completed);
+  SysTick->LOAD = (per_tick - 1);
+  __enable_irq();
+}
+
+/*
+ * STOP mode: turn off the SysTick timer and the high-speed
+ * clocks, and let the RTC wake the chip up.
+ */
+void pLowPower::idle_stop(TickType_t expected_ticks) {
+  uint32_t per_tick = (configSYSTICK_CLOCK_HZ / configTICK_RATE_HZ);
+  uint32_t clk_bits = (SysTick->CTRL & SysTick_CTRL_CLKSOURCE_Msk);
+  uint32_t hz       = rtc_hz;
+  __disable_irq();
+  __DSB();
+  __ISB();
+  if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+    __enable_irq();
+    return;
+  }
+  // If the current tick has already ended, let it be counted.
+  SysTick->CTRL &= ~(SysTick_CTRL_ENABLE_Msk);
+  if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+    SysTick->CTRL |= (SysTick_CTRL_ENABLE_Msk);
+    __enable_irq();
+    return;
+  }
+  // Part of the current tick which has already passed, and the
+  // RTC counts to wait, leaving time for the clocks to restart.
+  uint32_t into_tick = (per_tick - 1) - SysTick->VAL;
+  uint64_t into_rtc  = ((uint64_t)into_tick * hz * configTICK_RATE_HZ) /
+                       configSYSTICK_CLOCK_HZ;
+  uint64_t wait = ((uint64_t)expected_ticks * hz) / configTICK_RATE_HZ;
+  uint64_t wake = ((uint64_t)pLOWPOWER_STOP_WAKE_US * hz) / 1000000;
+  if (wait <= (into_rtc + wake + 1)) {
+    SysTick->CTRL |= (SysTick_CTRL_ENABLE_Msk);
+    __enable_irq();
+    return;
+  }
+  wait -= (into_rtc + wake);
+  if (wait > pLOWPOWER_RTC_MAX_WAIT) { wait = pLOWPOWER_RTC_MAX_WAIT; }
+  rtc_sync();
+  uint32_t start = rtc_now();
+  rtc_set_wakeup(start, (uint32_t)wait);
+  // Enter STOP mode with the voltage regulator in low-power mode.
+  PWR->CR   = ((PWR->CR & ~(PWR_CR_PDDS)) | PWR_CR_LPDS);
+  SCB->SCR |=  (SCB_SCR_SLEEPDEEP_Msk);
+  __DSB();
+  __WFI();
+  __ISB();
+  SCB->SCR &= ~(SCB_SCR_SLEEPDEEP_Msk);
+  // The chip wakes up running from the HSI oscillator.
+  pClock::resume_after_stop();
+  // The RTC registers must be re-synchronized before reading.
+  rtc_sync();
+  uint32_t slept = rtc_diff(start, rtc_now());
+  rtc_clear_wakeup();
+  ++stop_count;
+  // Convert the time asleep back to whole ticks, and carry the
+  // rest of a tick into the next SysTick period.
+  uint64_t total     = ((uint64_t)into_rtc + slept) * configTICK_RATE_HZ;
+  uint32_t completed = (uint32_t)(total / hz);
+  uint32_t partial   = (uint32_t)(((total % hz) * per_tick) / hz);
+  if (completed >= expected_ticks) {
+    // (Woke up late; end the next tick as soon as possible.)
+    completed = expected_ticks - 1;
+    partial   = per_tick;
+  }
+  uint32_t load = (per_tick - 1);
+  if (partial + pLOWPOWER_SYSTICK_COMP >= load) {
+    load = pLOWPOWER_SYSTICK_COMP;
+  }
+  else {
+    load -= partial;
+  }
+  SysTick->LOAD = load;
+  SysTick->VAL  = 0;
+  SysTick->CTRL = (clk_bits | SysTick_CTRL_TICKINT_Msk |
+                   SysTick_CTRL_ENABLE_Msk);
+  vTaskStepTick(completed);
+  SysTick->LOAD = (per_tick - 1);
+  __enable_irq();
+}
+
+/*
+ * Read the RTC counter.
+ */
+uint32_t pLowPower::rtc_now(void) {
+  #if defined(STARm_F3)
+    // Reading SSR locks the shadow TR and DR registers until DR
+    // is read, so the values are consistent.
+    uint32_t ssr = RTC->SSR;
+    uint32_t tr  = RTC->TR;
+    (void)RTC->DR;
+    uint32_t secs =
+      ((((tr & RTC_TR_HT)  >> RTC_TR_HT_Pos)  * 10 +
+        ((tr & RTC_TR_HU)  >> RTC_TR_HU_Pos)) * 3600) +
+      ((((tr & RTC_TR_MNT) >> RTC_TR_MNT_Pos) * 10 +
+        ((tr & RTC_TR_MNU) >> RTC_TR_MNU_Pos)) * 60) +
+      (((tr & RTC_TR_ST)  >> RTC_TR_ST_Pos)  * 10 +
+       ((tr & RTC_TR_SU)  >> RTC_TR_SU_Pos));
+    return ((secs * pLOWPOWER_RTC_NOMINAL_HZ) +
+            ((pLOWPOWER_RTC_NOMINAL_HZ - 1) - ssr));
+  #elif STARm_F1
+    // Read the high half twice, in case the low half overflowed.
+    uint32_t hi = RTC->CNTH;
+    uint32_t lo = RTC->CNTL;
+    if (RTC->CNTH != hi) {
+      hi = RTC->CNTH;
+      lo = RTC->CNTL;
+    }
+    return ((hi & 0xFFFF) << 16) | (lo & 0xFFFF);
+  #endif
+}
+
+/*
+ * Wait for the RTC registers to be synchronized with the RTC
+ * clock domain. (Needed after a reset, or after STOP mode.)
+ * On the F3, 'RSF' is write-protected, so the registers are
+ * unlocked to clear it. The other flags are written with 1s,
+ * which leaves them alone, and 'INIT' with 0.
+ */
+void pLowPower::rtc_sync(void) {
+  #if defined(STARm_F3)
+    RTC->WPR  =  (0xCA);
+    RTC->WPR  =  (0x53);
+    RTC->ISR  = ~(RTC_ISR_INIT | RTC_ISR_RSF);
+    while (!(RTC->ISR & RTC_ISR_RSF)) {};
+    RTC->WPR  =  (0xFF);
+  #elif STARm_F1
+    RTC->CRL &= ~(RTC_CRL_RSF);
+    while (!(RTC->CRL & RTC_CRL_RSF)) {};
+  #endif
+}
+
+/*
+ * Set the RTC to wake the chip up 'counts' RTC counts after 'start'.
+ */
+void pLowPower::rtc_set_wakeup(uint32_t start, uint32_t counts) {
+  #if defined(STARm_F3)
+    // (The wakeup timer counts from when it is enabled, which
+    // is close enough to 'start'.)
+    (void)start;
+    RTC->WPR  =  (0xCA);
+    RTC->WPR  =  (0x53);
+    RTC->CR  &= ~(RTC_CR_WUTE);
+    while (!(RTC->ISR & RTC_ISR_WUTWF)) {};
+    RTC->WUTR =  (counts - 1);
+    RTC->ISR &= ~(RTC_ISR_WUTF);
+    RTC->CR  |=  (RTC_CR_WUTE | RTC_CR_WUTIE);
+    RTC->WPR  =  (0xFF);
+  #elif STARm_F1
+    uint32_t alarm = start + counts;
+    while (!(RTC->CRL & RTC_CRL_RTOFF)) {};
+    RTC->CRL |=  (RTC_CRL_CNF);
+    RTC->ALRH =  (alarm >> 16);
+    RTC->ALRL =  (alarm & 0xFFFF);
+    RTC->CRL &= ~(RTC_CRL_CNF | RTC_CRL_ALRF);
+    while (!(RTC->CRL & RTC_CRL_RTOFF)) {};
+    EXTI->PR  =  (EXTI_PR_PR17);
+  #endif
+}
+
+/*
+ * Cancel the RTC wakeup, if it has not happened yet.
+ */
+void pLowPower::rtc_clear_wakeup(void) {
+  #if defined(STARm_F3)
+    RTC->WPR  =  (0xCA);
+    RTC->WPR  =  (0x53);
+    RTC->CR  &= ~(RTC_CR_WUTE);
+    RTC->WPR  =  (0xFF);
+    RTC->ISR &= ~(RTC_ISR_WUTF);
+    EXTI->PR  =  (EXTI_PR_PR20);
+    NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+  #elif STARm_F1
+    // The alarm can not be turned off without turning off its
+    // interrupt, and after an early wakeup it is still a few
+    // counts ahead; so move it to the counter's last value,
+    // which is about 2.5 days away at 20KHz.
+    while (!(RTC->CRL & RTC_CRL_RTOFF)) {};
+    RTC->CRL |=  (RTC_CRL_CNF);
+    RTC->ALRH =  (0xFFFF);
+    RTC->ALRL =  (0xFFFF);
+    RTC->CRL &= ~(RTC_CRL_CNF | RTC_CRL_ALRF);
+    while (!(RTC->CRL & RTC_CRL_RTOFF)) {};
+    EXTI->PR  =  (EXTI_PR_PR17);
+    NVIC_ClearPendingIRQ(RTC_Alarm_IRQn);
+  #endif
+}
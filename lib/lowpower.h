@@ -0,0 +1,81 @@
+#ifndef __STARm_LOWPOWER_H
+#define __STARm_LOWPOWER_H
+
+// FreeRTOS includes.
+extern "C" {
+  #include "FreeRTOS.h"
+  #include "task.h"
+}
+
+// Project includes.
+#include "core.h"
+#include "clock.h"
+
+// Project macro definitions.
+// Idle periods of at least this many ticks use STOP mode;
+// shorter ones use SLEEP mode.
+#define pLOWPOWER_STOP_MIN_TICKS  (10)
+// Time to allow for restarting the oscillators and PLL after
+// STOP mode, in microseconds; the RTC wakes the chip up this
+// much earlier than the next scheduled task.
+#define pLOWPOWER_STOP_WAKE_US    (2000)
+// SysTick counts lost while the SysTick timer is stopped and
+// re-started, like the FreeRTOS port's 'ulStoppedTimerCompensation'.
+#define pLOWPOWER_SYSTICK_COMP    (6)
+// RTC counts used to calibrate the LSI oscillator.
+#define pLOWPOWER_CAL_COUNTS      (400)
+// Nominal RTC counter speed. (LSI / 2 = 20KHz, but the LSI
+// can be off by as much as 50%, so it is calibrated.)
+#define pLOWPOWER_RTC_NOMINAL_HZ  (20000)
+
+/*
+ * Low-power idle manager for the FreeRTOS 'tickless idle' mode.
+ * When every task is blocked, the kernel calls
+ * 'vPortSuppressTicksAndSleep' with the number of ticks until
+ * the next task is due to run:
+ *  - Short idle periods use SLEEP mode, with the SysTick timer
+ *    re-programmed to wake the core when the next task is due.
+ *  - Long idle periods use STOP mode, where the core, PLL, and
+ *    high-speed oscillators are off. An RTC running from the LSI
+ *    oscillator wakes the chip up, and it measures the time that
+ *    passed if something else woke the chip up first. The clock
+ *    tree is restored afterwards.
+ * The kernel's tick count is stepped forward by the time spent
+ * asleep, and partial ticks are carried into the next SysTick
+ * period, so task timing doesn't drift. (It is only as accurate
+ * as the LSI calibration while in STOP mode; 'calibrate' can be
+ * called again if the temperature changes a lot.)
+ * Peripherals which need the high-speed clocks while every task
+ * is blocked, like a DMA transfer or UART reception, should call
+ * 'stop_lock' to keep the chip out of STOP mode until they call
+ * 'stop_unlock'. Serial output should be finished with 'flush'
+ * before a task blocks, so the last bytes are not cut off.
+ * EXTI pin interrupts can wake the chip from STOP.
+ * This is a static class.
+ */
+class pLowPower {
+public:
+  // Set up the RTC and calibrate the LSI oscillator.
+  static bool     init(void);
+  static bool     calibrate(void);
+  // Keep the chip out of STOP mode. (Can be nested, and called
+  // from interrupt handlers.)
+  static void     stop_lock(void);
+  static void     stop_unlock(void);
+  static bool     stop_allowed(void);
+  // Tickless idle entry point.
+  static void     idle(TickType_t expected_ticks);
+  // Statistics: how many times each mode was entered.
+  static uint32_t get_sleep_count(void);
+  static uint32_t get_stop_count(void);
+  static uint32_t get_rtc_hz(void);
+protected:
+  static void     idle_sleep(TickType_t expected_ticks);
+  static void     idle_stop(TickType_t expected_ticks);
+  static uint32_t rtc_now(void);
+  static void     rtc_sync(void);
+  static void     rtc_set_wakeup(uint32_t start, uint32_t counts);
+  static void     rtc_clear_wakeup(void);
+};
+
+#endif
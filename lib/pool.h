@@ -0,0 +1,142 @@
+#ifndef __STARm_POOL_H
+#define __STARm_POOL_H
+
+// Standard library includes.
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+/*
+ * Fixed-block memory pool: 'N' blocks, each big enough for one
+ * 'T'. Allocating and freeing a block takes constant time and is
+ * safe from interrupt handlers, so per-transfer objects like I2C
+ * transactions or UART frames can come from a pool instead of a
+ * general-purpose heap, and a full pool can not fragment.
+ *
+ * Free blocks are kept on a lock-free linked list ('Treiber
+ * stack'). The list head is one 32-bit word which holds the first
+ * free block's index in the low half and a counter in the high
+ * half, and it is updated with a compare-and-swap, which GCC builds
+ * from LDREX/STREX on Cortex-M3/M4 cores. The counter changes on
+ * every update, so an interrupt which takes and returns blocks
+ * while a task is half-way through an update makes the task's
+ * compare-and-swap fail and retry, instead of corrupting the list.
+ *
+ * Blocks which have never been used are handed out in order from
+ * a separate counter, so zeroed memory is a valid, empty pool and
+ * there is nothing to set up. Like 'pTask', this has no
+ * constructor; declare these at file scope, for example:
+ *   static pPool<i2c_xfer, 8> xfer_pool;
+ *   ...
+ *   i2c_xfer* x = xfer_pool.create();
+ *   ...
+ *   xfer_pool.destroy(x);
+ * 'alloc' and 'free' hand out raw memory without calling the
+ * object's constructor or destructor.
+ */
+template<typename T, unsigned N>
+class pPool {
+  static_assert(N >= 1 && N < 0xFFFF,
+                "Pool size must be between 1 and 65534 blocks.");
+public:
+  static constexpr unsigned length     = N;
+  static constexpr unsigned block_size = sizeof(T);
+
+  // Take a block; returns NULL if the pool is empty.
+  T* alloc(void) {
+    uint32_t index;
+    uint32_t old_head = __atomic_load_n(&free_head, __ATOMIC_ACQUIRE);
+    while (1) {
+      if (!(old_head & 0xFFFF)) {
+        // Free list is empty; try a block which was never used.
+        index = __atomic_fetch_add(&unused_next, 1, __ATOMIC_RELAXED);
+        if (index >= N) {
+          // (Put the counter back so that it can not wrap around.)
+          __atomic_fetch_sub(&unused_next, 1, __ATOMIC_RELAXED);
+          __atomic_fetch_add(&failures, 1, __ATOMIC_RELAXED);
+          return NULL;
+        }
+        break;
+      }
+      index = (old_head & 0xFFFF) - 1;
+      uint32_t new_head = next_free[index] |
+                          ((old_head + 0x10000) & 0xFFFF0000);
+      if (__atomic_compare_exchange_n(&free_head, &old_head, new_head,
+                                      true, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_ACQUIRE)) {
+        break;
+      }
+    }
+    count_alloc();
+    return (T*)&storage[index * sizeof(T)];
+  }
+
+  // Return a block. Returns false if it is not from this pool.
+  bool free(T* block) {
+    if (!owns(block)) { return false; }
+    uint32_t index    = ((uint8_t*)block - storage) / sizeof(T);
+    uint32_t old_head = __atomic_load_n(&free_head, __ATOMIC_ACQUIRE);
+    uint32_t new_head;
+    do {
+      next_free[index] = (uint16_t)(old_head & 0xFFFF);
+      new_head = (index + 1) | ((old_head + 0x10000) & 0xFFFF0000);
+    } while (!__atomic_compare_exchange_n(&free_head, &old_head, new_head,
+                                          true, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_ACQUIRE));
+    __atomic_fetch_sub(&in_use, 1, __ATOMIC_RELAXED);
+    return true;
+  }
+
+  // Take a block and construct an object in it.
+  template<typename... Args>
+  T* create(Args... args) {
+    T* block = alloc();
+    if (!block) { return NULL; }
+    return new (block) T(args...);
+  }
+  // Destroy an object and return its block.
+  bool destroy(T* obj) {
+    if (!owns(obj)) { return false; }
+    obj->~T();
+    return free(obj);
+  }
+
+  // Is this pointer the start of one of the pool's blocks?
+  bool owns(const T* block) {
+    const uint8_t* p = (const uint8_t*)block;
+    if (p < storage || p >= &storage[N * sizeof(T)]) { return false; }
+    return ((p - storage) % sizeof(T)) == 0;
+  }
+
+  // Usage statistics.
+  unsigned get_in_use(void)     { return in_use; }
+  unsigned get_free(void)       { return N - in_use; }
+  unsigned get_high_water(void) { return high_water; }
+  unsigned get_failures(void)   { return failures; }
+
+protected:
+  // Update the usage count and its high-water mark.
+  void count_alloc(void) {
+    uint32_t used = __atomic_add_fetch(&in_use, 1, __ATOMIC_RELAXED);
+    uint32_t peak = __atomic_load_n(&high_water, __ATOMIC_RELAXED);
+    while (used > peak &&
+           !__atomic_compare_exchange_n(&high_water, &peak, used, true,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {};
+  }
+
+  alignas(T) uint8_t storage[N * sizeof(T)];
+  // Free list: each free block's successor, as 'index + 1'.
+  uint16_t          next_free[N];
+  // Free list head: 'index + 1' of the first free block (or 0),
+  // and an update counter in the upper 16 bits.
+  volatile uint32_t free_head;
+  // Index of the next block which was never used.
+  volatile uint32_t unused_next;
+  // Statistics.
+  volatile uint32_t in_use;
+  volatile uint32_t high_water;
+  volatile uint32_t failures;
+};
+
+#endif
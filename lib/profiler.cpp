@@ -0,0 +1,192 @@
+#include "profiler.h"
+#include "clock.h"
+#include "clockgate.h"
+#include "lowpower.h"
+
+// The profiler is only built with 'PROFILER' defined, since its
+// sample timer's interrupt handler (and the table that it fills)
+// would otherwise be linked into every program.
+#ifdef PROFILER
+
+// Index mask for the hash table.
+#define pPROFILER_MASK   (pPROFILER_SLOTS - 1)
+static_assert((pPROFILER_SLOTS & pPROFILER_MASK) == 0,
+              "The profiler table size must be a power of two.");
+// Number of slots to try before a sample is dropped.
+#define pPROFILER_PROBES (16)
+
+/*
+ * Sample count for one address.
+ */
+struct pProfiler_entry {
+  uint32_t pc;
+  uint32_t lr;
+  uint32_t count;
+};
+
+// Sample table and counters.
+static pProfiler_entry   table[pPROFILER_SLOTS];
+static volatile uint32_t total_samples   = 0;
+static volatile uint32_t dropped_samples = 0;
+static uint32_t          sample_hz       = 0;
+static bool              record_lr       = false;
+static bool              running         = false;
+// Dump task settings.
+static pRTOS_RAM pTask<pPROFILER_TASK_STACK> dump_task_mem;
+static unsigned          dump_period     = 0;
+static pIO*              dump_link       = NULL;
+
+/*
+ * Count one sample. 'frame' is the interrupted code's exception
+ * stack frame: R0-R3, R12, LR, PC, xPSR.
+ */
+extern "C" __attribute__((used)) pRAM_FUNC
+void profiler_sample(const uint32_t* frame) {
+  pPROFILER_TIM->SR = 0;
+  uint32_t pc = frame[6];
+  uint32_t lr = record_lr ? frame[5] : 0;
+  ++total_samples;
+  // (Fibonacci hashing; the low bit of a Thumb address is 0.)
+  uint32_t slot = ((((pc ^ lr) >> 1) * 2654435761UL) >> 16);
+  for (unsigned i = 0; i < pPROFILER_PROBES; ++i) {
+    pProfiler_entry* e = &table[(slot + i) & pPROFILER_MASK];
+    if (!e->count) {
+      e->pc    = pc;
+      e->lr    = lr;
+      e->count = 1;
+      return;
+    }
+    if (e->pc == pc && e->lr == lr) {
+      ++e->count;
+      return;
+    }
+  }
+  ++dropped_samples;
+}
+
+/*
+ * Sample timer interrupt. The interrupted code's registers were
+ * stacked on the main stack (by interrupts and the kernel) or the
+ * process stack (by tasks); bit 2 of the EXC_RETURN value in LR
+ * says which. This does not touch the stack itself, so the frame
+ * is at the top of it.
+ */
+extern "C" __attribute__((naked)) void pPROFILER_IRQ_handler(void) {
+  __asm__ volatile(
+    "tst   lr, #4               \n"
+    "ite   eq                   \n"
+    "mrseq r0, msp              \n"
+    "mrsne r0, psp              \n"
+    "ldr   r1, =profiler_sample \n"
+    "bx    r1                   \n"
+    ".ltorg                     \n");
+}
+
+/*
+ * Clear the table, and start sampling at 'rate_hz'.
+ * Returns false if the sample timer can't run that fast.
+ */
+bool pProfiler::start(uint32_t rate_hz, bool with_lr) {
+  uint32_t psc, arr;
+  if (!pClock::tim_period(rate_hz, &psc, &arr)) { return false; }
+  stop();
+  reset();
+  record_lr = with_lr;
+  pClockGate::acquire<pPROFILER_tim_en>();
+  pPROFILER_TIM->CR1  = 0;
+  pPROFILER_TIM->PSC  = psc;
+  pPROFILER_TIM->ARR  = arr;
+  pPROFILER_tim::EGR::write(pTIM_EGR::UG::set());
+  pPROFILER_TIM->SR   = 0;
+  // (The actual rate, after rounding.)
+  sample_hz = pClock::get_tim_apb1_hz() / ((psc + 1) * (arr + 1));
+  NVIC_SetPriority(pPROFILER_IRQn, pPROFILER_IRQ_PRIORITY);
+  NVIC_EnableIRQ(pPROFILER_IRQn);
+  // The sample timer needs the high-speed clocks.
+  pLowPower::stop_lock();
+  running = true;
+  pPROFILER_tim::DIER::write(pTIM_DIER::UIE::set());
+  pPROFILER_tim::CR1::write(pTIM_CR1::CEN::set());
+  return true;
+}
+
+/* Stop sampling; the table is kept for 'dump'. */
+void pProfiler::stop(void) {
+  if (!running) { return; }
+  pPROFILER_TIM->CR1  = 0;
+  pPROFILER_TIM->DIER = 0;
+  NVIC_DisableIRQ(pPROFILER_IRQn);
+  running = false;
+  pClockGate::release<pPROFILER_tim_en>();
+  pLowPower::stop_unlock();
+}
+
+/* Clear the table. */
+void pProfiler::reset(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (unsigned i = 0; i < pPROFILER_SLOTS; ++i) {
+    table[i].count = 0;
+  }
+  total_samples   = 0;
+  dropped_samples = 0;
+  __set_PRIMASK(primask);
+}
+
+uint32_t pProfiler::get_samples(void) { return total_samples; }
+uint32_t pProfiler::get_dropped(void) { return dropped_samples; }
+
+/*
+ * Send the sample table. Sampling is paused while it is sent,
+ * so the dump does not show up in the profile.
+ */
+void pProfiler::dump(pIO* link) {
+  if (!link) { return; }
+  if (running) { NVIC_DisableIRQ(pPROFILER_IRQn); }
+  unsigned entries = 0;
+  for (unsigned i = 0; i < pPROFILER_SLOTS; ++i) {
+    if (table[i].count) { ++entries; }
+  }
+  link->write(pPROFILER_MAGIC_0);
+  link->write(pPROFILER_MAGIC_1);
+  link->write(pPROFILER_MAGIC_2);
+  link->write(pPROFILER_MAGIC_3);
+  link->write(pPROFILER_VERSION);
+  link->write_le(sample_hz);
+  link->write_le(total_samples);
+  link->write_le(dropped_samples);
+  link->write(entries & 0xFF);
+  link->write((entries >> 8) & 0xFF);
+  for (unsigned i = 0; i < pPROFILER_SLOTS; ++i) {
+    if (!table[i].count) { continue; }
+    link->write_le(table[i].pc);
+    link->write_le(table[i].lr);
+    link->write_le(table[i].count);
+  }
+  link->flush();
+  if (running) {
+    // (Drop the update which happened during the dump.)
+    pPROFILER_TIM->SR = 0;
+    NVIC_ClearPendingIRQ(pPROFILER_IRQn);
+    NVIC_EnableIRQ(pPROFILER_IRQn);
+  }
+}
+
+/* Dump task: send the table periodically. */
+void pProfiler::dump_task(void* args) {
+  (void)args;
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(dump_period));
+    dump(dump_link);
+  }
+}
+
+/* Start the dump task. */
+bool pProfiler::start_task(unsigned period_ms, pIO* link) {
+  if (!period_ms || !link) { return false; }
+  dump_period = period_ms;
+  dump_link   = link;
+  return (dump_task_mem.start_background(dump_task, "Profile_Dump") != NULL);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __STARm_PROFILER_H
+#define __STARm_PROFILER_H
+
+// Project includes.
+#include "core.h"
+#include "rtos.h"
+
+// Project macro definitions.
+// Timer which paces the samples. (A basic timer on the F3;
+// the F1 has none, so it uses TIM4.)
+#if   defined(STARm_F3)
+  #define pPROFILER_TIM         (TIM6)
+  #define pPROFILER_IRQn        (TIM6_DAC1_IRQn)
+  #define pPROFILER_IRQ_handler TIM6_DAC1_IRQ_handler
+  typedef pTIM_regs<TIM6_BASE>         pPROFILER_tim;
+  typedef pRCC_APB1ENR::TIM6EN         pPROFILER_tim_en;
+#elif STARm_F1
+  #define pPROFILER_TIM         (TIM4)
+  #define pPROFILER_IRQn        (TIM4_IRQn)
+  #define pPROFILER_IRQ_handler TIM4_IRQ_handler
+  typedef pTIM_regs<TIM4_BASE>         pPROFILER_tim;
+  typedef pRCC_APB1ENR::TIM4EN         pPROFILER_tim_en;
+#endif
+// Sample interrupt priority. This is above
+// 'configMAX_SYSCALL_INTERRUPT_PRIORITY', so the kernel's
+// critical sections can be sampled too.
+#define pPROFILER_IRQ_PRIORITY (1)
+// Number of distinct sample addresses which can be counted.
+// (Must be a power of two.)
+#define pPROFILER_SLOTS        (128)
+// Dump task stack size, in words.
+#define pPROFILER_TASK_STACK   (128)
+// Dump format identifiers.
+#define pPROFILER_MAGIC_0      ('P')
+#define pPROFILER_MAGIC_1      ('R')
+#define pPROFILER_MAGIC_2      ('O')
+#define pPROFILER_MAGIC_3      ('F')
+#define pPROFILER_VERSION      (1)
+
+/*
+ * Statistical PC-sampling profiler.
+ * A timer interrupt reads the program counter which was stacked
+ * when it interrupted the running code, and counts how many
+ * times each address was seen in a small hash table. With
+ * 'with_lr', the stacked link register is recorded too, which
+ * is usually the caller's return address in leaf functions.
+ * The sample interrupt has a higher priority than the kernel,
+ * so only code which masks every interrupt (with PRIMASK) is
+ * invisible; the time spent there is counted in the instruction
+ * after it. Samples which do not fit in the table are counted
+ * as 'dropped'. The timer needs the high-speed clocks, so the
+ * chip stays out of STOP mode while the profiler runs. It is
+ * only built with 'PROFILER' defined ('make PROFILER=1').
+ *
+ * 'dump' sends the table to a serial link:
+ *   "PROF", version (1 byte), sample rate in Hz (4 bytes),
+ *   total samples (4 bytes), dropped samples (4 bytes),
+ *   number of entries (2 bytes), then for each entry:
+ *     PC (4 bytes), LR (4 bytes, 0 without 'with_lr'),
+ *     sample count (4 bytes),
+ * all little-endian. The counts keep adding up between dumps,
+ * until 'reset' or 'start' is called. The 'prof_decode' host
+ * tool maps the addresses to functions and source lines with
+ * the ELF file.
+ * Sample rates which are not a multiple of the RTOS tick rate
+ * (like 997Hz) avoid sampling in step with the periodic tasks.
+ * This is a static class; there is only one sample timer.
+ */
+class pProfiler {
+public:
+  // Clear the table and start sampling, or stop.
+  static bool     start(uint32_t rate_hz, bool with_lr);
+  static void     stop(void);
+  static void     reset(void);
+  // Results.
+  static uint32_t get_samples(void);
+  static uint32_t get_dropped(void);
+  // Send the table to a serial link.
+  static void     dump(pIO* link);
+  // Start a low-priority task which dumps the table
+  // every 'period_ms'.
+  static bool     start_task(unsigned period_ms, pIO* link);
+protected:
+  static void     dump_task(void* args);
+};
+
+#endif
@@ -0,0 +1,528 @@
+#ifndef __STARm_REGS_H
+#define __STARm_REGS_H
+
+// Standard library includes.
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+/*
+ * Compile-time register and field descriptions.
+ *
+ * A 'layout' class describes the fields of one kind of register,
+ * like an I2C peripheral's 'CR1'. Its fields are built from the
+ * masks in ST's device headers, and each field checks at compile
+ * time that its mask is one contiguous run of bits. Field values
+ * can be OR'd together, but only with other fields of the same
+ * layout; mixing up two registers' fields is a compile error.
+ * Values given as template parameters are also checked against
+ * the field's width:
+ *   pI2C_CR1::modify(i2c->CR1, pI2C_CR1::PE::set() |
+ *                              pI2C_CR1::DNF::val<2>());
+ *   pDMA_CCR::PL::val<4>()   // error: value does not fit in field
+ *   pI2C_CR1::modify(i2c->CR1, pI2C_CR2::START::set());  // error
+ *
+ * However many fields a value holds, 'modify' applies it with a
+ * single read-modify-write, and 'write' with a single store. The
+ * masks and values are constants, so the compiler folds them into
+ * immediate operands; a value which covers every bit of the
+ * register is stored without reading it first.
+ *
+ * Registers at a fixed address are described by 'pReg', which
+ * also gives access to the layout's fields. The peripheral groups
+ * at the bottom of this file name the registers of each peripheral
+ * instance, for example:
+ *   typedef pI2C_regs<I2C1_BASE> i2c1;
+ *   i2c1::CR1::modify(i2c1::CR1::PE::clear());
+ *
+ * Only registers with fields are described; plain data registers
+ * like 'TIMx->ARR' or 'DMA1_Channel1->CNDTR' are still accessed
+ * through the device header structures.
+ */
+
+// Bits to change in one register, and their new values.
+template<typename Layout>
+class pRegVal {
+public:
+  constexpr pRegVal(uint32_t m, uint32_t b) : mask(m), bits(b) {}
+  constexpr pRegVal operator|(pRegVal other) const {
+    return pRegVal(mask | other.mask, bits | other.bits);
+  }
+  const uint32_t mask;
+  const uint32_t bits;
+};
+
+/*
+ * A field: the bits in 'Mask' of a register with layout 'Layout'.
+ */
+template<typename Layout, uint32_t Mask>
+class pField {
+  static_assert(Mask != 0, "Register fields must have at least one bit.");
+public:
+  typedef Layout layout;
+  static constexpr uint32_t mask = Mask;
+  static constexpr unsigned pos  = __builtin_ctz(Mask);
+  static constexpr uint32_t max  = (Mask >> pos);
+  static_assert((max & (max + 1)) == 0,
+                "Register field masks must be contiguous.");
+
+  // Set every bit in the field, or clear them.
+  static constexpr pRegVal<Layout> set(void)   { return pRegVal<Layout>(Mask, Mask); }
+  static constexpr pRegVal<Layout> clear(void) { return pRegVal<Layout>(Mask, 0); }
+  // Set the field to a constant value, which must fit.
+  template<uint32_t V>
+  static constexpr pRegVal<Layout> val(void) {
+    static_assert(V <= max, "Value does not fit in the register field.");
+    return pRegVal<Layout>(Mask, (V << pos));
+  }
+  // Set the field to a value which is only known at run-time.
+  // (Extra bits are masked off.)
+  static constexpr pRegVal<Layout> val(uint32_t v) {
+    return pRegVal<Layout>(Mask, ((v << pos) & Mask));
+  }
+  // Extract the field from a register value.
+  static constexpr uint32_t get(uint32_t reg) { return ((reg & Mask) >> pos); }
+};
+
+/*
+ * Layout base class; 'Derived' is the layout itself. These
+ * methods take the register as an argument, for drivers which
+ * hold a pointer to their peripheral.
+ */
+template<typename Derived>
+class pRegLayout {
+public:
+  typedef pRegVal<Derived> value;
+  // Change only the given fields.
+  static void modify(volatile uint32_t& reg, value v) {
+    if (v.mask == 0xFFFFFFFF) { reg = v.bits; }
+    else                      { reg = (reg & ~(v.mask)) | v.bits; }
+  }
+  // Write the given fields, and 0 to every other bit.
+  // (Also for 'write 1 to clear' flag registers.)
+  static void write(volatile uint32_t& reg, value v) { reg = v.bits; }
+  // Read one field.
+  template<typename F>
+  static uint32_t get(const volatile uint32_t& reg) {
+    static_assert(std::is_same<typename F::layout, Derived>::value,
+                  "Field does not belong to this register.");
+    return F::get(reg);
+  }
+};
+
+/*
+ * Mask of a per-pin or per-channel field: 'mask' moved to slot 'n'
+ * of 'count', 'stride' bits apart. An out-of-range slot gives an
+ * empty mask, which 'pField' rejects at compile time.
+ */
+constexpr uint32_t pReg_slot(uint32_t mask, unsigned n,
+                             unsigned count, unsigned stride) {
+  return (n < count) ? (mask << (n * stride)) : 0;
+}
+
+/*
+ * A register with layout 'Layout', at address 'Addr'.
+ */
+template<typename Layout, uint32_t Addr>
+class pReg : public Layout {
+public:
+  typedef pRegVal<Layout> value;
+  static constexpr uint32_t addr = Addr;
+
+  static volatile uint32_t& ref(void) { return *(volatile uint32_t*)Addr; }
+  static volatile uint32_t* ptr(void) { return (volatile uint32_t*)Addr; }
+  static uint32_t read(void)          { return ref(); }
+  static void     modify(value v)     { Layout::modify(ref(), v); }
+  static void     write(value v)      { Layout::write(ref(), v); }
+  template<typename F>
+  static uint32_t get(void) { return Layout::template get<F>(ref()); }
+};
+
+/*
+ * Cortex-M3/M4 bit-band alias for a bit in the peripheral region.
+ * Each bit in 0x40000000-0x400FFFFF has a word in the alias region
+ * at 0x42000000; reading it returns the bit's value in one load.
+ * (Only valid for registers inside of that 1MB region.)
+ */
+#define STARm_PERIPH_BB        (0x42000000U)
+#define STARm_BITBAND_PERIPH(reg, bit) \
+  ((__IO uint32_t*)(STARm_PERIPH_BB + \
+                    ((((uint32_t)(reg)) - 0x40000000U) * 32) + ((bit) * 4)))
+
+/*
+ * RCC register layouts.
+ */
+class pRCC_CR : public pRegLayout<pRCC_CR> {
+public:
+  typedef pField<pRCC_CR, RCC_CR_HSION>  HSION;
+  typedef pField<pRCC_CR, RCC_CR_HSIRDY> HSIRDY;
+  typedef pField<pRCC_CR, RCC_CR_HSEON>  HSEON;
+  typedef pField<pRCC_CR, RCC_CR_HSERDY> HSERDY;
+  typedef pField<pRCC_CR, RCC_CR_HSEBYP> HSEBYP;
+  typedef pField<pRCC_CR, RCC_CR_CSSON>  CSSON;
+  typedef pField<pRCC_CR, RCC_CR_PLLON>  PLLON;
+  typedef pField<pRCC_CR, RCC_CR_PLLRDY> PLLRDY;
+};
+class pRCC_CFGR : public pRegLayout<pRCC_CFGR> {
+public:
+  typedef pField<pRCC_CFGR, RCC_CFGR_SW>       SW;
+  typedef pField<pRCC_CFGR, RCC_CFGR_SWS>      SWS;
+  typedef pField<pRCC_CFGR, RCC_CFGR_HPRE>     HPRE;
+  typedef pField<pRCC_CFGR, RCC_CFGR_PPRE1>    PPRE1;
+  typedef pField<pRCC_CFGR, RCC_CFGR_PPRE2>    PPRE2;
+  typedef pField<pRCC_CFGR, RCC_CFGR_PLLSRC>   PLLSRC;
+  typedef pField<pRCC_CFGR, RCC_CFGR_PLLXTPRE> PLLXTPRE;
+  typedef pField<pRCC_CFGR, RCC_CFGR_MCO>      MCO;
+  #if   defined(STARm_F3)
+    typedef pField<pRCC_CFGR, RCC_CFGR_PLLMUL>  PLLMUL;
+  #elif STARm_F1
+    typedef pField<pRCC_CFGR, RCC_CFGR_PLLMULL> PLLMUL;
+  #endif
+};
+class pRCC_AHBENR : public pRegLayout<pRCC_AHBENR> {
+public:
+  typedef pField<pRCC_AHBENR, RCC_AHBENR_DMA1EN>  DMA1EN;
+  typedef pField<pRCC_AHBENR, RCC_AHBENR_SRAMEN>  SRAMEN;
+  typedef pField<pRCC_AHBENR, RCC_AHBENR_FLITFEN> FLITFEN;
+  typedef pField<pRCC_AHBENR, RCC_AHBENR_CRCEN>   CRCEN;
+  #if defined(STARm_F3)
+    // GPIO banks, by index: 0 = GPIOA, 1 = GPIOB, etc.
+    template<unsigned N>
+    using GPIOEN = pField<pRCC_AHBENR, pReg_slot(RCC_AHBENR_GPIOAEN, N, 6, 1)>;
+  #endif
+};
+class pRCC_APB1ENR : public pRegLayout<pRCC_APB1ENR> {
+public:
+  typedef pField<pRCC_APB1ENR, RCC_APB1ENR_TIM2EN>   TIM2EN;
+  typedef pField<pRCC_APB1ENR, RCC_APB1ENR_TIM3EN>   TIM3EN;
+  typedef pField<pRCC_APB1ENR, RCC_APB1ENR_WWDGEN>   WWDGEN;
+  typedef pField<pRCC_APB1ENR, RCC_APB1ENR_USART2EN> USART2EN;
+  typedef pField<pRCC_APB1ENR, RCC_APB1ENR_I2C1EN>   I2C1EN;
+  typedef pField<pRCC_APB1ENR, RCC_APB1ENR_PWREN>    PWREN;
+  #if   defined(STARm_F3)
+    typedef pField<pRCC_APB1ENR, RCC_APB1ENR_TIM6EN> TIM6EN;
+  #elif STARm_F1
+    typedef pField<pRCC_APB1ENR, RCC_APB1ENR_TIM4EN> TIM4EN;
+    typedef pField<pRCC_APB1ENR, RCC_APB1ENR_BKPEN>  BKPEN;
+  #endif
+};
+class pRCC_APB2ENR : public pRegLayout<pRCC_APB2ENR> {
+public:
+  typedef pField<pRCC_APB2ENR, RCC_APB2ENR_TIM1EN>   TIM1EN;
+  typedef pField<pRCC_APB2ENR, RCC_APB2ENR_SPI1EN>   SPI1EN;
+  typedef pField<pRCC_APB2ENR, RCC_APB2ENR_USART1EN> USART1EN;
+  #if   defined(STARm_F3)
+    typedef pField<pRCC_APB2ENR, RCC_APB2ENR_SYSCFGEN> SYSCFGEN;
+  #elif STARm_F1
+    typedef pField<pRCC_APB2ENR, RCC_APB2ENR_AFIOEN>   AFIOEN;
+    // GPIO banks, by index: 0 = GPIOA, 1 = GPIOB, etc.
+    template<unsigned N>
+    using GPIOEN = pField<pRCC_APB2ENR, pReg_slot(RCC_APB2ENR_IOPAEN, N, 5, 1)>;
+  #endif
+};
+#if defined(STARm_F3)
+  class pRCC_AHBRSTR : public pRegLayout<pRCC_AHBRSTR> {
+  public:
+    template<unsigned N>
+    using GPIORST = pField<pRCC_AHBRSTR, pReg_slot(RCC_AHBRSTR_GPIOARST, N, 6, 1)>;
+  };
+#endif
+class pRCC_APB1RSTR : public pRegLayout<pRCC_APB1RSTR> {
+public:
+  typedef pField<pRCC_APB1RSTR, RCC_APB1RSTR_TIM2RST>   TIM2RST;
+  typedef pField<pRCC_APB1RSTR, RCC_APB1RSTR_TIM3RST>   TIM3RST;
+  typedef pField<pRCC_APB1RSTR, RCC_APB1RSTR_USART2RST> USART2RST;
+  typedef pField<pRCC_APB1RSTR, RCC_APB1RSTR_I2C1RST>   I2C1RST;
+};
+class pRCC_APB2RSTR : public pRegLayout<pRCC_APB2RSTR> {
+public:
+  typedef pField<pRCC_APB2RSTR, RCC_APB2RSTR_TIM1RST>   TIM1RST;
+  typedef pField<pRCC_APB2RSTR, RCC_APB2RSTR_SPI1RST>   SPI1RST;
+  typedef pField<pRCC_APB2RSTR, RCC_APB2RSTR_USART1RST> USART1RST;
+  #if defined(STARm_F1)
+    template<unsigned N>
+    using GPIORST = pField<pRCC_APB2RSTR, pReg_slot(RCC_APB2RSTR_IOPARST, N, 5, 1)>;
+  #endif
+};
+class pRCC_BDCR : public pRegLayout<pRCC_BDCR> {
+public:
+  typedef pField<pRCC_BDCR, RCC_BDCR_LSEON>  LSEON;
+  typedef pField<pRCC_BDCR, RCC_BDCR_RTCSEL> RTCSEL;
+  typedef pField<pRCC_BDCR, RCC_BDCR_RTCEN>  RTCEN;
+  typedef pField<pRCC_BDCR, RCC_BDCR_BDRST>  BDRST;
+};
+class pRCC_CSR : public pRegLayout<pRCC_CSR> {
+public:
+  typedef pField<pRCC_CSR, RCC_CSR_LSION>  LSION;
+  typedef pField<pRCC_CSR, RCC_CSR_LSIRDY> LSIRDY;
+};
+
+/*
+ * GPIO register layouts. Per-pin fields take the pin number.
+ */
+#if   defined(STARm_F3)
+  class pGPIO_MODER : public pRegLayout<pGPIO_MODER> {
+  public:
+    template<unsigned N> using MODE  = pField<pGPIO_MODER, pReg_slot(0x3U, N, 16, 2)>;
+  };
+  class pGPIO_OTYPER : public pRegLayout<pGPIO_OTYPER> {
+  public:
+    template<unsigned N> using OT    = pField<pGPIO_OTYPER, pReg_slot(0x1U, N, 16, 1)>;
+  };
+  class pGPIO_OSPEEDR : public pRegLayout<pGPIO_OSPEEDR> {
+  public:
+    template<unsigned N> using SPEED = pField<pGPIO_OSPEEDR, pReg_slot(0x3U, N, 16, 2)>;
+  };
+  class pGPIO_PUPDR : public pRegLayout<pGPIO_PUPDR> {
+  public:
+    template<unsigned N> using PUPD  = pField<pGPIO_PUPDR, pReg_slot(0x3U, N, 16, 2)>;
+  };
+  class pGPIO_AFRL : public pRegLayout<pGPIO_AFRL> {
+  public:
+    template<unsigned N> using AF    = pField<pGPIO_AFRL, pReg_slot(0xFU, N, 8, 4)>;
+  };
+  class pGPIO_AFRH : public pRegLayout<pGPIO_AFRH> {
+  public:
+    template<unsigned N> using AF    = pField<pGPIO_AFRH, pReg_slot(0xFU, N - 8, 8, 4)>;
+  };
+#elif STARm_F1
+  // 'CRL' holds pins 0-7, and 'CRH' holds pins 8-15.
+  class pGPIO_CRL : public pRegLayout<pGPIO_CRL> {
+  public:
+    template<unsigned N> using MODE = pField<pGPIO_CRL, pReg_slot(0x3U, N, 8, 4)>;
+    template<unsigned N> using CNF  = pField<pGPIO_CRL, pReg_slot(0xCU, N, 8, 4)>;
+  };
+  class pGPIO_CRH : public pRegLayout<pGPIO_CRH> {
+  public:
+    template<unsigned N> using MODE = pField<pGPIO_CRH, pReg_slot(0x3U, N - 8, 8, 4)>;
+    template<unsigned N> using CNF  = pField<pGPIO_CRH, pReg_slot(0xCU, N - 8, 8, 4)>;
+  };
+#endif
+
+/*
+ * I2C register layouts. The F3 has the newer I2C peripheral,
+ * which is quite different from the F1's.
+ */
+#if   defined(STARm_F3)
+  class pI2C_CR1 : public pRegLayout<pI2C_CR1> {
+  public:
+    typedef pField<pI2C_CR1, I2C_CR1_PE>        PE;
+    typedef pField<pI2C_CR1, I2C_CR1_ANFOFF>    ANFOFF;
+    typedef pField<pI2C_CR1, I2C_CR1_DNF>       DNF;
+    typedef pField<pI2C_CR1, I2C_CR1_TXDMAEN>   TXDMAEN;
+    typedef pField<pI2C_CR1, I2C_CR1_RXDMAEN>   RXDMAEN;
+    typedef pField<pI2C_CR1, I2C_CR1_NOSTRETCH> NOSTRETCH;
+    typedef pField<pI2C_CR1, I2C_CR1_SMBHEN>    SMBHEN;
+    typedef pField<pI2C_CR1, I2C_CR1_SMBDEN>    SMBDEN;
+  };
+  class pI2C_CR2 : public pRegLayout<pI2C_CR2> {
+  public:
+    typedef pField<pI2C_CR2, I2C_CR2_SADD>    SADD;
+    typedef pField<pI2C_CR2, I2C_CR2_RD_WRN>  RD_WRN;
+    typedef pField<pI2C_CR2, I2C_CR2_START>   START;
+    typedef pField<pI2C_CR2, I2C_CR2_STOP>    STOP;
+    typedef pField<pI2C_CR2, I2C_CR2_NACK>    NACK;
+    typedef pField<pI2C_CR2, I2C_CR2_NBYTES>  NBYTES;
+    typedef pField<pI2C_CR2, I2C_CR2_RELOAD>  RELOAD;
+    typedef pField<pI2C_CR2, I2C_CR2_AUTOEND> AUTOEND;
+  };
+  class pI2C_TIMINGR : public pRegLayout<pI2C_TIMINGR> {
+  public:
+    typedef pField<pI2C_TIMINGR, I2C_TIMINGR_SCLL>   SCLL;
+    typedef pField<pI2C_TIMINGR, I2C_TIMINGR_SCLH>   SCLH;
+    typedef pField<pI2C_TIMINGR, I2C_TIMINGR_SDADEL> SDADEL;
+    typedef pField<pI2C_TIMINGR, I2C_TIMINGR_SCLDEL> SCLDEL;
+    typedef pField<pI2C_TIMINGR, I2C_TIMINGR_PRESC>  PRESC;
+  };
+  // 'Write 1 to clear' flags; use 'write', not 'modify'.
+  class pI2C_ICR : public pRegLayout<pI2C_ICR> {
+  public:
+    typedef pField<pI2C_ICR, I2C_ICR_ADDRCF>   ADDRCF;
+    typedef pField<pI2C_ICR, I2C_ICR_NACKCF>   NACKCF;
+    typedef pField<pI2C_ICR, I2C_ICR_STOPCF>   STOPCF;
+    typedef pField<pI2C_ICR, I2C_ICR_BERRCF>   BERRCF;
+    typedef pField<pI2C_ICR, I2C_ICR_ARLOCF>   ARLOCF;
+    typedef pField<pI2C_ICR, I2C_ICR_OVRCF>    OVRCF;
+    typedef pField<pI2C_ICR, I2C_ICR_PECCF>    PECCF;
+    typedef pField<pI2C_ICR, I2C_ICR_TIMOUTCF> TIMOUTCF;
+    typedef pField<pI2C_ICR, I2C_ICR_ALERTCF>  ALERTCF;
+    // Every flag at once.
+    static constexpr value all(void) {
+      return ADDRCF::set() | NACKCF::set()  | STOPCF::set()   |
+             BERRCF::set() | ARLOCF::set()  | OVRCF::set()    |
+             PECCF::set()  | TIMOUTCF::set() | ALERTCF::set();
+    }
+  };
+#elif STARm_F1
+  class pI2C_CR1 : public pRegLayout<pI2C_CR1> {
+  public:
+    typedef pField<pI2C_CR1, I2C_CR1_PE>    PE;
+    typedef pField<pI2C_CR1, I2C_CR1_START> START;
+    typedef pField<pI2C_CR1, I2C_CR1_STOP>  STOP;
+    typedef pField<pI2C_CR1, I2C_CR1_ACK>   ACK;
+    typedef pField<pI2C_CR1, I2C_CR1_SWRST> SWRST;
+  };
+  class pI2C_CR2 : public pRegLayout<pI2C_CR2> {
+  public:
+    typedef pField<pI2C_CR2, I2C_CR2_FREQ>    FREQ;
+    typedef pField<pI2C_CR2, I2C_CR2_ITERREN> ITERREN;
+    typedef pField<pI2C_CR2, I2C_CR2_ITEVTEN> ITEVTEN;
+    typedef pField<pI2C_CR2, I2C_CR2_ITBUFEN> ITBUFEN;
+    typedef pField<pI2C_CR2, I2C_CR2_DMAEN>   DMAEN;
+  };
+  class pI2C_CCR : public pRegLayout<pI2C_CCR> {
+  public:
+    typedef pField<pI2C_CCR, I2C_CCR_CCR>  CCR;
+    typedef pField<pI2C_CCR, I2C_CCR_DUTY> DUTY;
+    typedef pField<pI2C_CCR, I2C_CCR_FS>   FS;
+  };
+  class pI2C_TRISE : public pRegLayout<pI2C_TRISE> {
+  public:
+    typedef pField<pI2C_TRISE, I2C_TRISE_TRISE> TRISE;
+  };
+#endif
+
+/*
+ * DMA register layouts. Per-channel flags take the channel
+ * number, starting at 1 like in the reference manuals.
+ */
+class pDMA_CCR : public pRegLayout<pDMA_CCR> {
+public:
+  typedef pField<pDMA_CCR, DMA_CCR_EN>      EN;
+  typedef pField<pDMA_CCR, DMA_CCR_TCIE>    TCIE;
+  typedef pField<pDMA_CCR, DMA_CCR_HTIE>    HTIE;
+  typedef pField<pDMA_CCR, DMA_CCR_TEIE>    TEIE;
+  typedef pField<pDMA_CCR, DMA_CCR_DIR>     DIR;
+  typedef pField<pDMA_CCR, DMA_CCR_CIRC>    CIRC;
+  typedef pField<pDMA_CCR, DMA_CCR_PINC>    PINC;
+  typedef pField<pDMA_CCR, DMA_CCR_MINC>    MINC;
+  // Transfer sizes: 0 = 8 bits, 1 = 16 bits, 2 = 32 bits.
+  typedef pField<pDMA_CCR, DMA_CCR_PSIZE>   PSIZE;
+  typedef pField<pDMA_CCR, DMA_CCR_MSIZE>   MSIZE;
+  // Priority: 0 = low ... 3 = very high.
+  typedef pField<pDMA_CCR, DMA_CCR_PL>      PL;
+  typedef pField<pDMA_CCR, DMA_CCR_MEM2MEM> MEM2MEM;
+};
+class pDMA_ISR : public pRegLayout<pDMA_ISR> {
+public:
+  template<unsigned C> using GIF  = pField<pDMA_ISR, pReg_slot(DMA_ISR_GIF1, C - 1, 7, 4)>;
+  template<unsigned C> using TCIF = pField<pDMA_ISR, pReg_slot(DMA_ISR_TCIF1, C - 1, 7, 4)>;
+  template<unsigned C> using HTIF = pField<pDMA_ISR, pReg_slot(DMA_ISR_HTIF1, C - 1, 7, 4)>;
+  template<unsigned C> using TEIF = pField<pDMA_ISR, pReg_slot(DMA_ISR_TEIF1, C - 1, 7, 4)>;
+};
+// 'Write 1 to clear' flags; use 'write', not 'modify'.
+class pDMA_IFCR : public pRegLayout<pDMA_IFCR> {
+public:
+  template<unsigned C> using CGIF  = pField<pDMA_IFCR, pReg_slot(DMA_IFCR_CGIF1, C - 1, 7, 4)>;
+  template<unsigned C> using CTCIF = pField<pDMA_IFCR, pReg_slot(DMA_IFCR_CTCIF1, C - 1, 7, 4)>;
+  template<unsigned C> using CHTIF = pField<pDMA_IFCR, pReg_slot(DMA_IFCR_CHTIF1, C - 1, 7, 4)>;
+  template<unsigned C> using CTEIF = pField<pDMA_IFCR, pReg_slot(DMA_IFCR_CTEIF1, C - 1, 7, 4)>;
+};
+
+/*
+ * Timer register layouts. (General-purpose timer fields; the
+ * advanced-control timer's extra fields are not listed yet.)
+ */
+class pTIM_CR1 : public pRegLayout<pTIM_CR1> {
+public:
+  typedef pField<pTIM_CR1, TIM_CR1_CEN>  CEN;
+  typedef pField<pTIM_CR1, TIM_CR1_UDIS> UDIS;
+  typedef pField<pTIM_CR1, TIM_CR1_URS>  URS;
+  typedef pField<pTIM_CR1, TIM_CR1_OPM>  OPM;
+  typedef pField<pTIM_CR1, TIM_CR1_DIR>  DIR;
+  typedef pField<pTIM_CR1, TIM_CR1_CMS>  CMS;
+  typedef pField<pTIM_CR1, TIM_CR1_ARPE> ARPE;
+  typedef pField<pTIM_CR1, TIM_CR1_CKD>  CKD;
+};
+class pTIM_DIER : public pRegLayout<pTIM_DIER> {
+public:
+  typedef pField<pTIM_DIER, TIM_DIER_UIE>   UIE;
+  typedef pField<pTIM_DIER, TIM_DIER_CC1IE> CC1IE;
+  typedef pField<pTIM_DIER, TIM_DIER_UDE>   UDE;
+  typedef pField<pTIM_DIER, TIM_DIER_CC1DE> CC1DE;
+};
+class pTIM_SR : public pRegLayout<pTIM_SR> {
+public:
+  typedef pField<pTIM_SR, TIM_SR_UIF>   UIF;
+  typedef pField<pTIM_SR, TIM_SR_CC1IF> CC1IF;
+};
+class pTIM_EGR : public pRegLayout<pTIM_EGR> {
+public:
+  typedef pField<pTIM_EGR, TIM_EGR_UG> UG;
+};
+
+/*
+ * Peripheral groups: the registers of one peripheral instance.
+ */
+class pRCC_regs {
+public:
+  typedef pReg<pRCC_CR,       RCC_BASE + offsetof(RCC_TypeDef, CR)>       CR;
+  typedef pReg<pRCC_CFGR,     RCC_BASE + offsetof(RCC_TypeDef, CFGR)>     CFGR;
+  typedef pReg<pRCC_AHBENR,   RCC_BASE + offsetof(RCC_TypeDef, AHBENR)>   AHBENR;
+  typedef pReg<pRCC_APB1ENR,  RCC_BASE + offsetof(RCC_TypeDef, APB1ENR)>  APB1ENR;
+  typedef pReg<pRCC_APB2ENR,  RCC_BASE + offsetof(RCC_TypeDef, APB2ENR)>  APB2ENR;
+  typedef pReg<pRCC_APB1RSTR, RCC_BASE + offsetof(RCC_TypeDef, APB1RSTR)> APB1RSTR;
+  typedef pReg<pRCC_APB2RSTR, RCC_BASE + offsetof(RCC_TypeDef, APB2RSTR)> APB2RSTR;
+  typedef pReg<pRCC_BDCR,     RCC_BASE + offsetof(RCC_TypeDef, BDCR)>     BDCR;
+  typedef pReg<pRCC_CSR,      RCC_BASE + offsetof(RCC_TypeDef, CSR)>      CSR;
+  #if defined(STARm_F3)
+    typedef pReg<pRCC_AHBRSTR, RCC_BASE + offsetof(RCC_TypeDef, AHBRSTR)> AHBRSTR;
+  #endif
+};
+
+template<uint32_t Base>
+class pGPIO_regs {
+public:
+  #if   defined(STARm_F3)
+    typedef pReg<pGPIO_MODER,   Base + offsetof(GPIO_TypeDef, MODER)>   MODER;
+    typedef pReg<pGPIO_OTYPER,  Base + offsetof(GPIO_TypeDef, OTYPER)>  OTYPER;
+    typedef pReg<pGPIO_OSPEEDR, Base + offsetof(GPIO_TypeDef, OSPEEDR)> OSPEEDR;
+    typedef pReg<pGPIO_PUPDR,   Base + offsetof(GPIO_TypeDef, PUPDR)>   PUPDR;
+    typedef pReg<pGPIO_AFRL,    Base + offsetof(GPIO_TypeDef, AFR)>     AFRL;
+    typedef pReg<pGPIO_AFRH,    Base + offsetof(GPIO_TypeDef, AFR) + 4> AFRH;
+  #elif STARm_F1
+    typedef pReg<pGPIO_CRL,     Base + offsetof(GPIO_TypeDef, CRL)>     CRL;
+    typedef pReg<pGPIO_CRH,     Base + offsetof(GPIO_TypeDef, CRH)>     CRH;
+  #endif
+};
+
+template<uint32_t Base>
+class pI2C_regs {
+public:
+  typedef pReg<pI2C_CR1,       Base + offsetof(I2C_TypeDef, CR1)>     CR1;
+  typedef pReg<pI2C_CR2,       Base + offsetof(I2C_TypeDef, CR2)>     CR2;
+  #if   defined(STARm_F3)
+    typedef pReg<pI2C_TIMINGR, Base + offsetof(I2C_TypeDef, TIMINGR)> TIMINGR;
+    typedef pReg<pI2C_ICR,     Base + offsetof(I2C_TypeDef, ICR)>     ICR;
+  #elif STARm_F1
+    typedef pReg<pI2C_CCR,     Base + offsetof(I2C_TypeDef, CCR)>     CCR;
+    typedef pReg<pI2C_TRISE,   Base + offsetof(I2C_TypeDef, TRISE)>   TRISE;
+  #endif
+};
+
+template<uint32_t Base>
+class pDMA_regs {
+public:
+  typedef pReg<pDMA_ISR,  Base + offsetof(DMA_TypeDef, ISR)>  ISR;
+  typedef pReg<pDMA_IFCR, Base + offsetof(DMA_TypeDef, IFCR)> IFCR;
+};
+typedef pDMA_regs<DMA1_BASE> pDMA1_regs;
+
+template<uint32_t Base>
+class pDMA_chan_regs {
+public:
+  typedef pReg<pDMA_CCR, Base + offsetof(DMA_Channel_TypeDef, CCR)> CCR;
+  static DMA_Channel_TypeDef* regs(void) { return (DMA_Channel_TypeDef*)Base; }
+};
+
+template<uint32_t Base>
+class pTIM_regs {
+public:
+  typedef pReg<pTIM_CR1,  Base + offsetof(TIM_TypeDef, CR1)>  CR1;
+  typedef pReg<pTIM_DIER, Base + offsetof(TIM_TypeDef, DIER)> DIER;
+  typedef pReg<pTIM_SR,   Base + offsetof(TIM_TypeDef, SR)>   SR;
+  typedef pReg<pTIM_EGR,  Base + offsetof(TIM_TypeDef, EGR)>  EGR;
+  static TIM_TypeDef* regs(void) { return (TIM_TypeDef*)Base; }
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef __STARm_RINGBUF_H
+#define __STARm_RINGBUF_H
+
+// Standard library includes.
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Lock-free single-producer, single-consumer ring buffer.
+ * One side (usually an interrupt handler) only writes, and the
+ * other side (usually a task) only reads, so neither side needs
+ * a critical section: the producer is the only one who moves
+ * 'head', and the consumer is the only one who moves 'tail'.
+ *
+ * Items are copied with 'memcpy' by the bulk methods, so 'T'
+ * should be a small, trivially-copyable type.
+ * 'N' must be a power of two. The indices run freely and wrap
+ * around at 2^32, so 'head - tail' is always the number of items
+ * stored and all N slots can be used.
+ *
+ * Memory ordering: an index is published with a 'release' store,
+ * after the items it covers have been written or read, and the
+ * other side's index is read with an 'acquire' load. On Cortex-M
+ * cores, GCC emits a 'DMB' instruction for each; that keeps DMA
+ * and the compiler from re-ordering the item accesses around the
+ * index update. The same code is correct across threads on a
+ * PC, which lets 'tools/ringbuf_bench' test it.
+ *
+ * The 'span' methods give direct access to the buffer for bulk
+ * transfers without an extra copy; a span is always contiguous,
+ * so it can be shorter than the total free space or data if it
+ * reaches the end of the buffer. For example, in a task:
+ *   unsigned len;
+ *   const uint8_t* data = rx_buf.read_span(len);
+ *   parse(data, len);
+ *   rx_buf.read_commit(len);
+ *
+ * Like 'pTask', this has no constructor; zeroed memory is a valid
+ * empty buffer, so declare these at file scope.
+ */
+template<typename T, unsigned N>
+class pRingBuffer {
+  static_assert(N >= 2 && (N & (N - 1)) == 0,
+                "Ring buffer length must be a power of two.");
+public:
+  static constexpr unsigned length = N;
+
+  // Producer side.
+  bool push(const T& item) {
+    uint32_t h = head;
+    if ((h - load_acquire(&tail)) >= N) { return false; }
+    buffer[h & (N - 1)] = item;
+    store_release(&head, h + 1);
+    return true;
+  }
+  // Copy in as many of 'count' items as fit; returns how many.
+  unsigned write(const T* items, unsigned count) {
+    uint32_t h     = head;
+    unsigned space = N - (h - load_acquire(&tail));
+    if (count > space) { count = space; }
+    unsigned first = N - (h & (N - 1));
+    if (first > count) { first = count; }
+    memcpy(&buffer[h & (N - 1)], items, first * sizeof(T));
+    memcpy(&buffer[0], items + first, (count - first) * sizeof(T));
+    store_release(&head, h + count);
+    return count;
+  }
+  // Contiguous free space; fill up to 'count' items, then commit.
+  T* write_span(unsigned& count) {
+    uint32_t h     = head;
+    unsigned space = N - (h - load_acquire(&tail));
+    unsigned first = N - (h & (N - 1));
+    count = (space < first) ? space : first;
+    return &buffer[h & (N - 1)];
+  }
+  void write_commit(unsigned count) {
+    store_release(&head, head + count);
+  }
+
+  // Consumer side.
+  bool pop(T& item) {
+    uint32_t t = tail;
+    if (load_acquire(&head) == t) { return false; }
+    item = buffer[t & (N - 1)];
+    store_release(&tail, t + 1);
+    return true;
+  }
+  // Copy out up to 'count' items; returns how many.
+  unsigned read(T* items, unsigned count) {
+    uint32_t t     = tail;
+    unsigned avail = load_acquire(&head) - t;
+    if (count > avail) { count = avail; }
+    unsigned first = N - (t & (N - 1));
+    if (first > count) { first = count; }
+    memcpy(items, &buffer[t & (N - 1)], first * sizeof(T));
+    memcpy(items + first, &buffer[0], (count - first) * sizeof(T));
+    store_release(&tail, t + count);
+    return count;
+  }
+  // Contiguous stored items; use up to 'count' items, then commit.
+  const T* read_span(unsigned& count) {
+    uint32_t t     = tail;
+    unsigned avail = load_acquire(&head) - t;
+    unsigned first = N - (t & (N - 1));
+    count = (avail < first) ? avail : first;
+    return &buffer[t & (N - 1)];
+  }
+  void read_commit(unsigned count) {
+    store_release(&tail, tail + count);
+  }
+  // Drop everything that is stored. (Consumer side.)
+  void flush(void) {
+    store_release(&tail, load_acquire(&head));
+  }
+
+  // Either side.
+  unsigned size(void) {
+    return load_acquire(&head) - load_acquire(&tail);
+  }
+  unsigned free_space(void) { return N - size(); }
+  bool     empty(void)      { return size() == 0; }
+  bool     full(void)       { return size() >= N; }
+
+protected:
+  static uint32_t load_acquire(const volatile uint32_t* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+  }
+  static void store_release(volatile uint32_t* p, uint32_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+  }
+
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  T                 buffer[N];
+};
+
+#endif
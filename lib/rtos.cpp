@@ -0,0 +1,32 @@
+#include "rtos.h"
+
+/*
+ * Memory for the kernel's own tasks.
+ * With 'configSUPPORT_STATIC_ALLOCATION' enabled, the kernel
+ * asks the application for these instead of using a heap.
+ */
+static pRTOS_RAM StaticTask_t idle_tcb;
+static pRTOS_RAM StackType_t  idle_stack[configMINIMAL_STACK_SIZE];
+
+extern "C" void vApplicationGetIdleTaskMemory(StaticTask_t** tcb,
+                                              StackType_t** stack,
+                                              uint32_t* stack_words) {
+  *tcb         = &idle_tcb;
+  *stack       = idle_stack;
+  *stack_words = configMINIMAL_STACK_SIZE;
+}
+
+#if ( configUSE_TIMERS == 1 )
+
+static pRTOS_RAM StaticTask_t timer_tcb;
+static pRTOS_RAM StackType_t  timer_stack[configTIMER_TASK_STACK_DEPTH];
+
+extern "C" void vApplicationGetTimerTaskMemory(StaticTask_t** tcb,
+                                               StackType_t** stack,
+                                               uint32_t* stack_words) {
+  *tcb         = &timer_tcb;
+  *stack       = timer_stack;
+  *stack_words = configTIMER_TASK_STACK_DEPTH;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef __STARm_RTOS_H
+#define __STARm_RTOS_H
+
+// FreeRTOS includes.
+extern "C" {
+  #include "FreeRTOS.h"
+  #include "task.h"
+  #include "queue.h"
+}
+
+// Project includes.
+#include "core.h"
+
+// Project macro definitions.
+// Place a statically-allocated RTOS object in the linker
+// scripts' 'rtos_static' block, so that its size is checked
+// against the RTOS RAM budget when the program is linked.
+// The block is part of '.bss', so it starts out zeroed.
+#define pRTOS_RAM __attribute__((section(".bss.rtos_static")))
+// Place a statically-allocated RTOS object in CCM RAM if the chip
+// has it, or in the 'rtos_static' block if it does not. Task
+// stacks which are busy and never hold DMA buffers fit well here.
+// (CCM RAM has its own size limit, so these are not counted
+// against the RTOS RAM budget.)
+#if defined(STARm_F3)
+  #define pRTOS_CCM_RAM pCCM_BSS
+#else
+  #define pRTOS_CCM_RAM pRTOS_RAM
+#endif
+
+/*
+ * Statically-allocated task: a task control block and a stack
+ * of 'StackWords' words. The kernel uses this memory instead of
+ * allocating it from a heap, so the program's RAM use is known
+ * when it is linked. Declare these at file scope, for example:
+ *   static pRTOS_RAM pTask<128> led_task_mem;
+ *   ...
+ *   led_task_mem.start(led_task, "Blink_LED", NULL, 1);
+ * These have no constructor, so they do not need the C++
+ * static initializers to run first.
+ */
+template<unsigned StackWords>
+class pTask {
+public:
+  static constexpr unsigned stack_words = StackWords;
+
+  // Create the task; returns NULL if it was already created.
+  TaskHandle_t start(TaskFunction_t fn, const char* name,
+                     void* arg, UBaseType_t priority) {
+    if (handle) { return NULL; }
+    handle = xTaskCreateStatic(fn, name, StackWords, arg, priority,
+                               stack, &tcb);
+    return handle;
+  }
+  // Create a background task, with no argument, at the lowest
+  // priority above idle; for reports and other slow work.
+  TaskHandle_t start_background(TaskFunction_t fn, const char* name) {
+    return start(fn, name, NULL, tskIDLE_PRIORITY + 1);
+  }
+  TaskHandle_t get_handle(void) { return handle; }
+
+  // (Public so that the struct stays an aggregate.)
+  StaticTask_t tcb;
+  StackType_t  stack[StackWords];
+  TaskHandle_t handle;
+};
+
+/*
+ * Statically-allocated queue of up to 'N' items of type 'T'.
+ * Items are copied in and out of the queue, so 'T' should be
+ * a small, trivially-copyable type.
+ */
+template<typename T, unsigned N>
+class pQueue {
+public:
+  static constexpr unsigned length = N;
+
+  // Create the queue; returns NULL if it was already created.
+  QueueHandle_t create(void) {
+    if (handle) { return NULL; }
+    handle = xQueueCreateStatic(N, sizeof(T), storage, &qcb);
+    return handle;
+  }
+  // Add an item, waiting up to 'wait' ticks for room.
+  bool send(const T& item, TickType_t wait) {
+    return (xQueueSend(handle, &item, wait) == pdPASS);
+  }
+  // Add an item from an interrupt handler.
+  bool send_from_isr(const T& item, BaseType_t* woken) {
+    return (xQueueSendFromISR(handle, &item, woken) == pdPASS);
+  }
+  // Take an item, waiting up to 'wait' ticks for one to arrive.
+  bool receive(T& item, TickType_t wait) {
+    return (xQueueReceive(handle, &item, wait) == pdPASS);
+  }
+  QueueHandle_t get_handle(void) { return handle; }
+
+  // (Public so that the struct stays an aggregate.)
+  StaticQueue_t qcb;
+  uint8_t       storage[N * sizeof(T)];
+  QueueHandle_t handle;
+};
+
+#endif
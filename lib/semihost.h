@@ -0,0 +1,36 @@
+#ifndef __STARm_SEMIHOST_H
+#define __STARm_SEMIHOST_H
+
+// Standard library includes.
+#include <stdint.h>
+
+// Semihosting operations.
+#define pSEMIHOST_SYS_OPEN   (0x01)
+#define pSEMIHOST_SYS_WRITE0 (0x04)
+#define pSEMIHOST_SYS_WRITE  (0x05)
+#define pSEMIHOST_SYS_EXIT   (0x18)
+// 'wb' file mode, for 'SYS_OPEN'.
+#define pSEMIHOST_MODE_WB    (5)
+// 'ADP_Stopped_ApplicationExit', for 'SYS_EXIT'.
+#define pSEMIHOST_EXIT_OK    (0x20026)
+
+/*
+ * Semihosting calls, which ask an attached debugger to do
+ * something on its host, like writing to a file or its console.
+ * This is a static class, like 'pClock'.
+ */
+class pSemihost {
+public:
+  /*
+   * Make a semihosting call. The debugger catches the 'BKPT 0xAB'
+   * instruction; without one attached, it would be a hard fault.
+   */
+  static inline int call(int op, void* args) {
+    register int   r0 __asm__("r0") = op;
+    register void* r1 __asm__("r1") = args;
+    __asm__ volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+    return r0;
+  }
+};
+
+#endif
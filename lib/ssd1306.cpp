@@ -1,20 +1,17 @@
 #include "ssd1306.h"
 
-// Default constructor.
-pSSD1306::pSSD1306() {}
-
-// Basic SSD1306 constructor. It accepts a W/H, but currently
-// only a resolution of 128x64 is supported.
-pSSD1306::pSSD1306(pI2C* I2Cx, uint8_t addr, int display_w, int display_h) {
+// Set the display's I2C bus and address. It accepts a W/H, but
+// currently only a resolution of 128x64 is supported.
+// (The framebuffer is not cleared; it starts out zeroed.)
+bool pSSD1306::init(pI2C* I2Cx, uint8_t addr,
+                    int display_w, int display_h) {
+  if (!I2Cx) { return false; }
   i2c = I2Cx;
   address = addr;
   oled_w = display_w;
   oled_h = display_h;
-  // Initialize the framebuffer to 0'x.
-  int fb_i;
-  for (fb_i = 0; fb_i < OLED_MAX_FB_SIZE; ++fb_i) {
-    framebuffer[fb_i] = 0x00;
-  }
+  status = pSTATUS_SET;
+  return true;
 }
 
 /* Drawing methods for the OLED framebuffer. */
@@ -34,12 +31,7 @@ void pSSD1306::draw_h_line(int x, int y,
   }
   int x_pos;
   for (x_pos = x; x_pos < (x+w); ++x_pos) {
-    if (color) {
-      framebuffer[x_pos + y_page_offset] |= bit_to_set;
-    }
-    else {
-      framebuffer[x_pos + y_page_offset] &= bit_to_set;
-    }
+    write_fb_byte(x_pos + y_page_offset, bit_to_set, color);
   }
 }
 
@@ -59,13 +51,10 @@ void pSSD1306::draw_v_line(int x, int y,
     y_page_offset = y_pos/8;
     y_page_offset *= 128;
     bit_to_set = 0x01 << (y_pos & 0x07);
-    if (color) {
-      framebuffer[x + y_page_offset] |= bit_to_set;
-    }
-    else {
+    if (!color) {
       bit_to_set = ~bit_to_set;
-      framebuffer[x + y_page_offset] &= bit_to_set;
     }
+    write_fb_byte(x + y_page_offset, bit_to_set, color);
   }
 }
 
@@ -131,20 +120,43 @@ void pSSD1306::draw_rect(int x, int y, int w, int h,
  *   Bit offset  = (y & 0x07)
  * 'color' indicates whether to set or unset the pixel.
  * '0' means 'pixel off', non-zero means 'pixel on'.
+ * (This and the other per-pixel methods run from RAM.)
  */
-void pSSD1306::draw_pixel(int x, int y, unsigned char color) {
+pRAM_FUNC void pSSD1306::draw_pixel(int x, int y, unsigned char color) {
   // I'm sure the compiler will optimize this away,
   // so I'll try to make the math self-documenting.
   int y_page = y / 8;
   int byte_to_mod = x + (y_page * 128);
   int bit_to_set = 0x01 << (y & 0x07);
-  if (color) {
-    framebuffer[byte_to_mod] |= bit_to_set;
-  }
-  else {
+  if (!color) {
     bit_to_set = ~bit_to_set;
-    framebuffer[byte_to_mod] &= bit_to_set;
   }
+  write_fb_byte(byte_to_mod, bit_to_set, color);
+}
+
+/*
+ * Apply a bitmask to one framebuffer byte: OR it in if 'color'
+ * is set, otherwise AND it. (So 'mask' is inverted for color 0.)
+ * The byte is only written if its value changes, and every
+ * change increments the framebuffer's version number; that
+ * lets the display be refreshed only when its contents change.
+ */
+pRAM_FUNC void pSSD1306::write_fb_byte(int index, int mask,
+                                       unsigned char color) {
+  uint8_t old_val = framebuffer[index];
+  uint8_t new_val = color ? (old_val | mask) : (old_val & mask);
+  if (new_val != old_val) {
+    framebuffer[index] = new_val;
+    ++fb_version;
+  }
+}
+
+/*
+ * Get the framebuffer's version number. It changes whenever
+ * a drawing method changes at least one pixel.
+ */
+uint32_t pSSD1306::get_fb_version(void) {
+  return fb_version;
 }
 
 /*
@@ -153,9 +165,9 @@ void pSSD1306::draw_pixel(int x, int y, unsigned char color) {
  * glyphs, so this function accepts the two relevant 32-bit
  * words and draws them to the framebuffer.
  */
-void pSSD1306::draw_letter(int x, int y,
-                           uint32_t w0, uint32_t w1,
-                           unsigned char color, char size) {
+pRAM_FUNC void pSSD1306::draw_letter(int x, int y,
+                                     uint32_t w0, uint32_t w1,
+                                     unsigned char color, char size) {
   // TODO: Comment this method, ffs...
   int w_iter = 0;
   int cur_x = x;
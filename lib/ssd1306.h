@@ -21,13 +21,34 @@ extern volatile uint8_t oled_fb[OLED_FB_SIZE];
 #define OLED_MAX_FB_SIZE ((128*64)/8)
 class pSSD1306 {
 public:
-  // Constructors.
-  pSSD1306();
-  pSSD1306(pI2C* I2Cx, uint8_t addr,
-           int display_w, int display_h);
+  // Constructor; call 'init' to choose the I2C bus and address.
+  // The framebuffer starts out zeroed. (It is too large to copy
+  // around, so copying is disabled.)
+  constexpr pSSD1306() {}
+  pSSD1306(const pSSD1306&)            = delete;
+  pSSD1306& operator=(const pSSD1306&) = delete;
+  bool init(pI2C* I2Cx, uint8_t addr, int display_w, int display_h);
   // Main display methods.
   void init_display(void);
   void draw_framebuffer(void);
+  // Send the framebuffer through a compile-time I2C bus driver,
+  // like 'pI2C1Bus', instead of the 'pI2C' object. The byte loop
+  // is inlined, with no virtual calls. (See 'i2c_static.h')
+  // The bus clock is only held while the frame is sent.
+  template<typename Bus>
+  void draw_framebuffer_on(void) {
+    Bus::clock_en();
+    #if   defined(STARm_F3)
+      Bus::set_reload_flag(1);
+      Bus::set_num_bytes(1);
+    #endif
+    Bus::start(address);
+    // Set a 'data' transmission, and send the framebuffer.
+    Bus::write(0x40);
+    Bus::stream(framebuffer, (oled_w * oled_h) / 8);
+    Bus::stop();
+    Bus::disable();
+  }
   // Drawing methods.
   // These write to the framebuffer and don't draw to the display.
   void draw_h_line(int x, int y, int w, unsigned char color);
@@ -45,18 +66,23 @@ public:
                  unsigned char color, const char size);
   // Getters/Setters.
   int get_status(void);
+  uint32_t get_fb_version(void);
 
   // Basic properties.
-  int     oled_w;
-  int     oled_h;
-  uint8_t address;
+  int     oled_w  = 0;
+  int     oled_h  = 0;
+  uint8_t address = 0;
 protected:
   // I2C peripheral interface.
-  pI2C*  i2c;
+  pI2C*  i2c = NULL;
   // Expected status.
   int status = pSTATUS_ERR;
   // TODO: Better way of sizing the framebuffer.
-  volatile uint8_t framebuffer[OLED_MAX_FB_SIZE];
+  volatile uint8_t framebuffer[OLED_MAX_FB_SIZE] = {};
+  // Incremented whenever the framebuffer's contents change.
+  volatile uint32_t fb_version = 0;
+
+  void write_fb_byte(int index, int mask, unsigned char color);
 
   void write_command_byte(uint8_t cmd);
   void write_data_byte(uint8_t dat);
@@ -0,0 +1,173 @@
+#include "stackmon.h"
+
+/*
+ * Information about one watched task.
+ */
+struct pStackMon_task {
+  TaskHandle_t handle;
+  unsigned     size;
+  unsigned     min_free;
+};
+
+// Watched tasks.
+static pStackMon_task watched[pSTACKMON_MAX_TASKS];
+static unsigned       num_watched = 0;
+// Monitor task settings.
+static pRTOS_RAM pTask<pSTACKMON_TASK_STACK> monitor_task_mem;
+static unsigned       monitor_period = 0;
+static pIO*           monitor_link   = NULL;
+// Name of the task which overflowed its stack, if any.
+// (Check this from a debugger if the program halts.)
+extern "C" const char* volatile stack_overflow_task;
+const char* volatile stack_overflow_task = NULL;
+
+/*
+ * Kernel stack overflow hook.
+ * With 'configCHECK_FOR_STACK_OVERFLOW' set to 2, the kernel
+ * checks each task's stack pointer and the last 16 bytes of
+ * its stack on every context switch. Once a stack has
+ * overflowed, memory next to it may be corrupt, so the safest
+ * thing to do is to record the task's name and stop.
+ */
+extern "C" void vApplicationStackOverflowHook(TaskHandle_t task,
+                                              char* name) {
+  (void)task;
+  taskDISABLE_INTERRUPTS();
+  stack_overflow_task = name;
+  while (1) {};
+}
+
+/*
+ * Start watching a task's stack. Returns false if the task
+ * handle is NULL, or if too many tasks are being watched.
+ */
+bool pStackMon::watch(TaskHandle_t task, unsigned stack_words) {
+  if (!task || num_watched >= pSTACKMON_MAX_TASKS) { return false; }
+  for (unsigned i = 0; i < num_watched; ++i) {
+    if (watched[i].handle == task) { return true; }
+  }
+  watched[num_watched].handle   = task;
+  watched[num_watched].size     = stack_words;
+  watched[num_watched].min_free = stack_words;
+  ++num_watched;
+  return true;
+}
+
+/*
+ * Update each watched task's high water mark.
+ */
+void pStackMon::check(void) {
+  for (unsigned i = 0; i < num_watched; ++i) {
+    unsigned free_w = uxTaskGetStackHighWaterMark(watched[i].handle);
+    if (free_w < watched[i].min_free) { watched[i].min_free = free_w; }
+  }
+}
+
+/* Number of watched tasks. */
+unsigned pStackMon::get_num_tasks(void) { return num_watched; }
+
+/* Fewest stack words that a task has had left, so far. */
+unsigned pStackMon::get_free_words(unsigned i) {
+  if (i >= num_watched) { return 0; }
+  return watched[i].min_free;
+}
+
+/* Most stack words that a task has used, so far. */
+unsigned pStackMon::get_used_words(unsigned i) {
+  if (i >= num_watched) { return 0; }
+  return watched[i].size - watched[i].min_free;
+}
+
+/*
+ * Suggested stack size for a task, based on its deepest use so
+ * far. If the whole stack was used, the task may have overflowed,
+ * so twice the current size is suggested instead.
+ */
+unsigned pStackMon::get_suggested_words(unsigned i) {
+  if (i >= num_watched) { return 0; }
+  if (watched[i].min_free == 0) { return watched[i].size * 2; }
+  unsigned used = get_used_words(i);
+  unsigned suggested = used + (used / 4) + pSTACKMON_MARGIN;
+  return ((suggested + 7) / 8) * 8;
+}
+
+/* Write a string to the link. */
+void pStackMon::print(pIO* link, const char* str) {
+  while (*str) { link->write(*str++); }
+}
+
+/* Write an unsigned value to the link, in decimal. */
+void pStackMon::print_uint(pIO* link, unsigned val) {
+  char digits[11];
+  int n = 0;
+  do {
+    digits[n++] = '0' + (val % 10);
+    val /= 10;
+  } while (val);
+  while (n) { link->write(digits[--n]); }
+}
+
+/*
+ * Print the sizing report, like:
+ *   // Stack sizing report: size / used / free, in words.
+ *   #define STACK_WORDS_BLINK_LED (48) // 128 / 22 / 106
+ */
+void pStackMon::report(pIO* link) {
+  if (!link) { return; }
+  check();
+  print(link, "// Stack sizing report: size / used / free, in words.\r\n");
+  for (unsigned i = 0; i < num_watched; ++i) {
+    print(link, "#define STACK_WORDS_");
+    // Task names are upper-cased, and anything other than
+    // letters and numbers is replaced with an underscore.
+    const char* name = pcTaskGetName(watched[i].handle);
+    for (; *name; ++name) {
+      char c = *name;
+      if (c >= 'a' && c <= 'z') { c -= ('a' - 'A'); }
+      else if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) {
+        c = '_';
+      }
+      link->write(c);
+    }
+    print(link, " (");
+    print_uint(link, get_suggested_words(i));
+    print(link, ") // ");
+    print_uint(link, watched[i].size);
+    print(link, " / ");
+    print_uint(link, get_used_words(i));
+    print(link, " / ");
+    print_uint(link, get_free_words(i));
+    if (watched[i].min_free == 0) { print(link, " (FULL)"); }
+    print(link, "\r\n");
+  }
+  // (The task blocks next, and the chip may enter STOP mode.)
+  link->flush();
+}
+
+/*
+ * Monitor task: check the stacks periodically, and print a
+ * report if a link was given.
+ */
+void pStackMon::monitor_task(void* args) {
+  (void)args;
+  // (The idle task only exists once the scheduler is running.)
+  watch(xTaskGetIdleTaskHandle(), configMINIMAL_STACK_SIZE);
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(monitor_period));
+    if (monitor_link) { report(monitor_link); }
+    else              { check(); }
+  }
+}
+
+/*
+ * Start the monitor task. It watches its own stack, too.
+ */
+bool pStackMon::start_task(unsigned period_ms, pIO* link) {
+  if (!period_ms) { return false; }
+  monitor_period = period_ms;
+  monitor_link   = link;
+  if (!monitor_task_mem.start_background(monitor_task, "Stack_Mon")) {
+    return false;
+  }
+  return watch(monitor_task_mem);
+}
@@ -0,0 +1,56 @@
+#ifndef __STARm_STACKMON_H
+#define __STARm_STACKMON_H
+
+// Project includes.
+#include "core.h"
+#include "rtos.h"
+
+// Project macro definitions.
+// Maximum number of tasks to watch.
+#define pSTACKMON_MAX_TASKS  (8)
+// Suggested stack sizes are the deepest use seen plus 25%,
+// plus this many words, rounded up to a multiple of 8 words.
+#define pSTACKMON_MARGIN     (16)
+// Monitor task stack size, in words.
+#define pSTACKMON_TASK_STACK (128)
+
+/*
+ * Task stack monitor.
+ * FreeRTOS fills each task's stack with a known pattern when it
+ * is created, and the 'high water mark' is the smallest number
+ * of words that have never been overwritten. Since the kernel
+ * doesn't record how large each stack is, tasks are registered
+ * with their sizes; 'pTask' objects can be passed directly.
+ * 'report' prints one '#define STACK_WORDS_<NAME> (n)' line per
+ * task with a suggested size, which can be pasted into
+ * 'src/stack_sizes.h' after a representative test run.
+ * Stack overflows are caught by the kernel's overflow check,
+ * which calls 'vApplicationStackOverflowHook'; see stackmon.cpp.
+ * This is a static class.
+ */
+class pStackMon {
+public:
+  // Task registration.
+  static bool     watch(TaskHandle_t task, unsigned stack_words);
+  template<unsigned N>
+  static bool     watch(pTask<N>& task) {
+    return watch(task.get_handle(), N);
+  }
+  // Measurement.
+  static void     check(void);
+  static unsigned get_num_tasks(void);
+  static unsigned get_free_words(unsigned i);
+  static unsigned get_used_words(unsigned i);
+  static unsigned get_suggested_words(unsigned i);
+  // Print a sizing report to a serial link.
+  static void     report(pIO* link);
+  // Start a low-priority task which calls 'check' every
+  // 'period_ms', and prints a report if 'link' is not NULL.
+  static bool     start_task(unsigned period_ms, pIO* link);
+protected:
+  static void     monitor_task(void* args);
+  static void     print(pIO* link, const char* str);
+  static void     print_uint(pIO* link, unsigned val);
+};
+
+#endif
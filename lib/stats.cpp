@@ -0,0 +1,141 @@
+#include <string.h>
+
+#include "stats.h"
+
+// Context switch counts, indexed by each task's trace number.
+// (Incremented by the kernel; see 'FreeRTOSConfig.h')
+extern "C" volatile uint32_t stats_switch_counts[pSTATS_MAX_TASKS + 1];
+volatile uint32_t stats_switch_counts[pSTATS_MAX_TASKS + 1];
+
+// Kernel task snapshot, and the previous sample's counters.
+static TaskStatus_t task_states[pSTATS_MAX_TASKS];
+static uint32_t     prev_runtime[pSTATS_MAX_TASKS + 1];
+static uint32_t     prev_switches[pSTATS_MAX_TASKS + 1];
+static uint32_t     prev_total  = 0;
+// Results from the last sample.
+static pStats_task  results[pSTATS_MAX_TASKS];
+static unsigned     num_results   = 0;
+static unsigned     idle_permille = pSTATS_PERMILLE;
+static uint32_t     window_switches = 0;
+static uint32_t     window_time     = 0;
+
+/*
+ * Start the DWT cycle counter, for the run-time stats clock.
+ * Called by the kernel when the scheduler starts.
+ */
+extern "C" void stats_timer_init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT       = 0;
+  DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/*
+ * Take a snapshot of the kernel's task counters, and calculate
+ * each task's share of the time since the previous snapshot.
+ * Returns false if there are more than 'pSTATS_MAX_TASKS' tasks.
+ */
+bool pStats::sample(void) {
+  uint32_t total = 0;
+  UBaseType_t n = uxTaskGetSystemState(task_states,
+                                       pSTATS_MAX_TASKS, &total);
+  if (n == 0) { return false; }
+  TaskHandle_t idle = xTaskGetIdleTaskHandle();
+  // (Unsigned subtraction handles counter wraparound.)
+  uint32_t window = total - prev_total;
+  prev_total = total;
+  window_time     = window;
+  window_switches = 0;
+  idle_permille   = 0;
+  num_results     = 0;
+  for (UBaseType_t i = 0; i < n; ++i) {
+    TaskStatus_t* ts = &task_states[i];
+    UBaseType_t num  = ts->xTaskNumber;
+    if (num > pSTATS_MAX_TASKS) { continue; }
+    uint32_t run = ts->ulRunTimeCounter - prev_runtime[num];
+    uint32_t sw  = stats_switch_counts[num] - prev_switches[num];
+    prev_runtime[num]  = ts->ulRunTimeCounter;
+    prev_switches[num] = stats_switch_counts[num];
+    pStats_task* r = &results[num_results++];
+    r->name     = ts->pcTaskName;
+    r->number   = num;
+    r->switches = sw;
+    r->is_idle  = (ts->xHandle == idle);
+    // (Scale down first, so that the multiply can't overflow.)
+    r->cpu_permille = 0;
+    if (window) {
+      uint32_t div = (window / pSTATS_PERMILLE) + 1;
+      r->cpu_permille = ((run / div) * pSTATS_PERMILLE) / (window / div);
+      if (r->cpu_permille > pSTATS_PERMILLE) {
+        r->cpu_permille = pSTATS_PERMILLE;
+      }
+    }
+    if (r->is_idle) { idle_permille = r->cpu_permille; }
+    window_switches += sw;
+  }
+  return true;
+}
+
+/* Number of tasks in the last sample. */
+unsigned pStats::get_num_tasks(void) { return num_results; }
+
+/* Results for one task from the last sample, or NULL. */
+const pStats_task* pStats::get_task(unsigned i) {
+  if (i >= num_results) { return NULL; }
+  return &results[i];
+}
+
+/* Share of time spent in the idle task, in tenths of a percent. */
+unsigned pStats::get_idle_permille(void) { return idle_permille; }
+
+/* Share of time spent in every other task. */
+unsigned pStats::get_cpu_permille(void) {
+  return pSTATS_PERMILLE - idle_permille;
+}
+
+/* Total context switches in the last window. */
+uint32_t pStats::get_switches(void) { return window_switches; }
+
+/* Length of the last window, in CPU cycles. */
+uint32_t pStats::get_window_cycles(void) {
+  return window_time;
+}
+
+/* The non-idle task which used the most CPU time, or NULL. */
+const pStats_task* pStats::busiest_task(void) {
+  const pStats_task* busiest = NULL;
+  for (unsigned i = 0; i < num_results; ++i) {
+    if (results[i].is_idle) { continue; }
+    if (!busiest || results[i].cpu_permille > busiest->cpu_permille) {
+      busiest = &results[i];
+    }
+  }
+  return busiest;
+}
+
+/*
+ * Draw the last sample's results as two small-text lines:
+ *   CPU:<percent> Sw:<context switches>
+ *   <busiest task's name>:<percent>
+ * The area is cleared first; it is 114x18 pixels.
+ * (The font does not have a '%' character.)
+ */
+void pStats::draw_overlay(pSSD1306* oled, int x, int y) {
+  if (!oled) { return; }
+  oled->draw_rect(x, y, 114, 18, 0, 0);
+  oled->draw_text(x, y, "CPU:", 1, 'S');
+  oled->draw_letter_i(x + 24, y, get_cpu_permille() / 10, 1, 'S');
+  oled->draw_text(x + 48, y, "Sw:", 1, 'S');
+  oled->draw_letter_i(x + 66, y, window_switches, 1, 'S');
+  const pStats_task* busiest = busiest_task();
+  if (busiest) {
+    // Only show the first 12 characters of the name.
+    char name[13];
+    strncpy(name, busiest->name, 12);
+    name[12] = '\0';
+    oled->draw_text(x, y + 10, name, 1, 'S');
+    int name_w = strlen(name) * 6;
+    oled->draw_letter_c(x + name_w, y + 10, ':', 1, 'S');
+    oled->draw_letter_i(x + name_w + 6, y + 10,
+                        busiest->cpu_permille / 10, 1, 'S');
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef __STARm_STATS_H
+#define __STARm_STATS_H
+
+// FreeRTOS includes.
+extern "C" {
+  #include "FreeRTOS.h"
+  #include "task.h"
+}
+
+// Project includes.
+#include "core.h"
+#include "ssd1306.h"
+
+// Project macro definitions.
+// ('pSTATS_MAX_TASKS' is set in 'FreeRTOSConfig.h',
+//  since the kernel uses it.)
+// CPU load values are in tenths of a percent.
+#define pSTATS_PERMILLE (1000)
+
+/*
+ * Statistics for one task, over the last sampling window.
+ */
+struct pStats_task {
+  const char* name;
+  UBaseType_t number;
+  // CPU time, in tenths of a percent.
+  uint16_t    cpu_permille;
+  // Number of times that the task was switched in.
+  uint32_t    switches;
+  bool        is_idle;
+};
+
+/*
+ * FreeRTOS run-time statistics.
+ * The kernel's run-time counter is the DWT cycle counter, so
+ * each task's CPU time is measured to within a few dozen cycles
+ * instead of the nearest tick. Context switches are counted by
+ * the 'traceTASK_SWITCHED_IN' hook.
+ * Call 'sample' periodically, for example once per second;
+ * each call measures the time since the previous call. The
+ * window must be shorter than the cycle counter's wraparound
+ * period, which is about 60 seconds at 72MHz (67 at 64MHz).
+ * This is a static class; there is only one scheduler.
+ */
+class pStats {
+public:
+  // Measurement.
+  static bool               sample(void);
+  // Results from the last sample.
+  static unsigned           get_num_tasks(void);
+  static const pStats_task* get_task(unsigned i);
+  static unsigned           get_idle_permille(void);
+  static unsigned           get_cpu_permille(void);
+  static uint32_t           get_switches(void);
+  static uint32_t           get_window_cycles(void);
+  // Draw a compact summary to a display's framebuffer.
+  static void               draw_overlay(pSSD1306* oled, int x, int y);
+protected:
+  static const pStats_task* busiest_task(void);
+};
+
+#endif
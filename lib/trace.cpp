@@ -0,0 +1,128 @@
+#include "trace.h"
+
+// Index mask for the ring buffer.
+#define pTRACE_MASK (pTRACE_BUFFER_EVENTS - 1)
+static_assert((pTRACE_BUFFER_EVENTS & pTRACE_MASK) == 0,
+              "The trace buffer size must be a power of two.");
+
+/*
+ * One recorded event.
+ */
+struct pTrace_event {
+  uint32_t stamp;
+  uint32_t event;
+};
+
+// Event buffer, and the total number of events recorded.
+// (The count goes up forever; the buffer index is
+//  'count & mask'.)
+static pTrace_event      events[pTRACE_BUFFER_EVENTS];
+static volatile uint32_t event_count = 0;
+static volatile bool     recording   = false;
+// Kernel task snapshot, for the task names.
+static TaskStatus_t      task_states[pSTATS_MAX_TASKS];
+// Dump task settings.
+static pRTOS_RAM pTask<pTRACE_TASK_STACK> dump_task_mem;
+static unsigned          dump_period = 0;
+static pIO*              dump_link   = NULL;
+
+/*
+ * Record an event; called by the kernel's trace hooks and the
+ * 'pTRACE_' macros. This runs on every context switch, so it
+ * is kept short, and in RAM.
+ */
+extern "C" pRAM_FUNC void trace_record(uint32_t event) {
+  if (!recording) { return; }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  pTrace_event* e = &events[event_count & pTRACE_MASK];
+  e->stamp = DWT->CYCCNT;
+  e->event = event;
+  ++event_count;
+  __set_PRIMASK(primask);
+}
+
+#ifdef TRACE_RECORDER
+/*
+ * Tick interrupt; see 'FreeRTOSConfig.h'. The kernel's handler
+ * is renamed, so that it can be traced like the others.
+ */
+extern "C" void traced_SysTick_handler(void);
+extern "C" void SysTick_handler(void) {
+  pTRACE_ISR_ENTER();
+  traced_SysTick_handler();
+  pTRACE_ISR_EXIT();
+}
+#endif
+
+/* Clear the buffer, and start recording. */
+void pTrace::start(void) {
+  CoreDebug->DEMCR |= (CoreDebug_DEMCR_TRCENA_Msk);
+  DWT->CTRL        |= (DWT_CTRL_CYCCNTENA_Msk);
+  event_count = 0;
+  recording   = true;
+}
+
+/* Pause recording. */
+void pTrace::stop(void) { recording = false; }
+
+uint32_t pTrace::get_count(void) { return event_count; }
+
+/*
+ * Send the task names and the buffered events, oldest first,
+ * then clear the buffer. Recording is paused during the dump,
+ * so the events which happen while it is being sent are not
+ * recorded.
+ */
+void pTrace::dump(pIO* link) {
+  if (!link) { return; }
+  bool was_recording = recording;
+  recording = false;
+  UBaseType_t n = uxTaskGetSystemState(task_states,
+                                       pSTATS_MAX_TASKS, NULL);
+  link->write('T');
+  link->write('R');
+  link->write('C');
+  link->write('E');
+  link->write(pTRACE_VERSION);
+  link->write_le(sys_clock_hz);
+  link->write(n);
+  for (UBaseType_t i = 0; i < n; ++i) {
+    link->write(task_states[i].xTaskNumber);
+    const char* name = task_states[i].pcTaskName;
+    // (Names are padded with zeros.)
+    bool ended = false;
+    for (unsigned c = 0; c < configMAX_TASK_NAME_LEN; ++c) {
+      if (!ended && !name[c]) { ended = true; }
+      link->write(ended ? 0 : name[c]);
+    }
+  }
+  uint32_t total = event_count;
+  uint32_t sent  = (total < pTRACE_BUFFER_EVENTS) ?
+                   total : pTRACE_BUFFER_EVENTS;
+  link->write_le(total);
+  link->write_le(sent);
+  for (uint32_t i = total - sent; i != total; ++i) {
+    link->write_le(events[i & pTRACE_MASK].stamp);
+    link->write_le(events[i & pTRACE_MASK].event);
+  }
+  link->flush();
+  if (was_recording) { start(); }
+}
+
+/* Dump task: send the buffer periodically. */
+void pTrace::dump_task(void* args) {
+  (void)args;
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(dump_period));
+    dump(dump_link);
+  }
+}
+
+/* Start the dump task. */
+bool pTrace::start_task(unsigned period_ms, pIO* link) {
+  if (!period_ms || !link) { return false; }
+  dump_period = period_ms;
+  dump_link   = link;
+  return (dump_task_mem.start_background(dump_task, "Trace_Dump") != NULL);
+}
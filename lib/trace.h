@@ -0,0 +1,90 @@
+#ifndef __STARm_TRACE_H
+#define __STARm_TRACE_H
+
+// Project includes.
+#include "core.h"
+#include "rtos.h"
+#include "log.h"
+
+// Project macro definitions.
+// ('pTRACE_EV_' event types are set in 'FreeRTOSConfig.h',
+//  since the kernel uses them.)
+// Trace buffer size, in events. (Must be a power of two.)
+#define pTRACE_BUFFER_EVENTS (256)
+// Dump task stack size, in words.
+#define pTRACE_TASK_STACK    (128)
+// Dump format version.
+#define pTRACE_VERSION       (1)
+
+/*
+ * Mark interrupt handlers and code regions in the trace:
+ *   extern "C" void DMA1_chan2_IRQ_handler(void) {
+ *     pTRACE_ISR_ENTER();
+ *     ...
+ *     pTRACE_ISR_EXIT();
+ *   }
+ *   pTRACE_BEGIN("frame");
+ *   oled.draw_framebuffer();
+ *   pTRACE_END("frame");
+ * Span labels are stored like 'pLOG' format strings, and paired
+ * up by name; the 'trace_decode' host tool reads them from the
+ * ELF file. Without 'TRACE_RECORDER', these do nothing.
+ */
+#ifdef TRACE_RECORDER
+  #define pTRACE_ISR_ENTER() \
+    pTRACE_EVENT(pTRACE_EV_ISR_ENTER, __get_IPSR())
+  #define pTRACE_ISR_EXIT() \
+    pTRACE_EVENT(pTRACE_EV_ISR_EXIT, __get_IPSR())
+  #define pTRACE_BEGIN(name) \
+    pTRACE_EVENT(pTRACE_EV_SPAN_BEGIN, pLOG_ID(name))
+  #define pTRACE_END(name) \
+    pTRACE_EVENT(pTRACE_EV_SPAN_END, pLOG_ID(name))
+#else
+  #define pTRACE_ISR_ENTER()
+  #define pTRACE_ISR_EXIT()
+  #define pTRACE_BEGIN(name)
+  #define pTRACE_END(name)
+#endif
+
+/*
+ * Task and interrupt trace recorder.
+ * With 'TRACE_RECORDER' defined ('make TRACE_RECORDER=1'), the
+ * kernel's trace hooks record context switches, tasks becoming
+ * ready, delays, task notifications and queue operations into
+ * a RAM ring buffer, along with interrupt handlers and spans
+ * which are marked with the macros above. Each event is two
+ * words: a DWT cycle-count timestamp, and the event type and
+ * argument. When the buffer is full, the oldest events are
+ * overwritten, so it always holds the most recent ones.
+ * Events are recorded with interrupts masked for a handful of
+ * cycles, so they are in timestamp order.
+ *
+ * 'dump' pauses recording, sends the buffer to a serial link and
+ * clears it, so each dump holds the events since the last one:
+ *   "TRCE", version (1 byte), core clock Hz (4 bytes),
+ *   number of tasks (1 byte), then for each task:
+ *     trace number (1 byte), name ('configMAX_TASK_NAME_LEN'),
+ *   total events recorded (4 bytes), events sent (4 bytes),
+ *   then each event's timestamp and word (4 bytes each),
+ * all little-endian. 'start_task' starts a low-priority task which
+ * dumps the buffer periodically. The cycle counter stops while
+ * the chip is in Stop mode, so sleeps look shorter than they are.
+ * This is a static class; there is only one scheduler.
+ */
+class pTrace {
+public:
+  // Start or pause recording.
+  static void     start(void);
+  static void     stop(void);
+  // Number of events recorded since the last 'start'.
+  static uint32_t get_count(void);
+  // Send the buffer to a serial link.
+  static void     dump(pIO* link);
+  // Start a low-priority task which dumps the buffer
+  // every 'period_ms'.
+  static bool     start_task(unsigned period_ms, pIO* link);
+protected:
+  static void     dump_task(void* args);
+};
+
+#endif
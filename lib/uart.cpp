@@ -0,0 +1,116 @@
+#include "uart.h"
+#include "clock.h"
+
+// Choose the U(S)ART peripheral; set the base registers.
+bool pUART::init(USART_TypeDef* uart_regs) {
+  uart = uart_regs;
+  if (uart_regs == USART1) {
+    enable_reg = pRCC_regs::APB2ENR::ptr();
+    enable_bit = RCC_APB2ENR_USART1EN;
+    reset_reg  = pRCC_regs::APB2RSTR::ptr();
+    reset_bit  = RCC_APB2RSTR_USART1RST;
+  }
+  else if (uart_regs == USART2) {
+    enable_reg = pRCC_regs::APB1ENR::ptr();
+    enable_bit = RCC_APB1ENR_USART2EN;
+    reset_reg  = pRCC_regs::APB1RSTR::ptr();
+    reset_bit  = RCC_APB1RSTR_USART2RST;
+  }
+  else {
+    status = pSTATUS_ERR;
+    return false;
+  }
+  status = pSTATUS_SET;
+  return true;
+}
+
+/*
+ * Core I/O 'Read' implementation:
+ * Wait for a byte of data to arrive, and return it.
+ */
+unsigned pUART::read(void) {
+  if (status != pSTATUS_RUN) { return 0; }
+  #if    defined(STARm_F3)
+    while (!(uart->ISR & USART_ISR_RXNE)) {};
+    return (uart->RDR & 0xFF);
+  #elif  STARm_F1
+    while (!(uart->SR & USART_SR_RXNE)) {};
+    return (uart->DR & 0xFF);
+  #endif
+}
+
+/*
+ * Core I/O 'Write' implementation:
+ * Wait for the transmit register to empty, then send a byte.
+ */
+void pUART::write(unsigned dat) {
+  if (status != pSTATUS_RUN) { return; }
+  #if    defined(STARm_F3)
+    while (!(uart->ISR & USART_ISR_TXE)) {};
+    uart->TDR = (uint8_t)dat;
+  #elif  STARm_F1
+    while (!(uart->SR & USART_SR_TXE)) {};
+    uart->DR  = (uint8_t)dat;
+  #endif
+}
+
+/*
+ * Send a buffer of bytes.
+ */
+void pUART::stream(volatile void* buf, int len) {
+  volatile uint8_t *uartbuf = (volatile uint8_t*) buf;
+  for (int i = 0; i < len; ++i) {
+    write(uartbuf[i]);
+  }
+}
+
+/*
+ * Wait for the last byte to finish shifting out. Call this
+ * before anything which could stop the peripheral clock, like
+ * blocking while the chip is allowed to enter STOP mode.
+ */
+void pUART::flush(void) {
+  if (status != pSTATUS_RUN) { return; }
+  #if    defined(STARm_F3)
+    while (!(uart->ISR & USART_ISR_TC)) {};
+  #elif  STARm_F1
+    while (!(uart->SR & USART_SR_TC)) {};
+  #endif
+}
+
+/*
+ * Initialize and enable the UART peripheral with a given
+ * baud rate, 8 data bits, no parity, and 1 stop bit.
+ * The peripheral clock must be enabled first.
+ */
+void pUART::uart_init(uint32_t baud) {
+  if (status == pSTATUS_ERR || !baud) { return; }
+  baud_rate = baud;
+  // Disable the peripheral, set the baud rate, and re-enable it.
+  uart->CR1 &= ~(USART_CR1_UE);
+  set_baud();
+  uart->CR1  =  (USART_CR1_TE | USART_CR1_RE | USART_CR1_UE);
+  status = pSTATUS_RUN;
+}
+
+/*
+ * Clock manager callback: re-calculate the baud rate
+ * divider after the bus clocks change.
+ */
+void pUART::clock_update(void) {
+  if (status != pSTATUS_RUN) { return; }
+  // Let any pending byte finish sending first.
+  flush();
+  uart->CR1 &= ~(USART_CR1_UE);
+  set_baud();
+  uart->CR1 |=  (USART_CR1_UE);
+}
+
+/*
+ * Set the baud rate divider from the peripheral's current clock.
+ * With 16x oversampling, BRR is simply clock / baud.
+ */
+void pUART::set_baud(void) {
+  uint32_t clk = pClock::get_usart_hz((uint32_t)uart);
+  uart->BRR = ((clk + (baud_rate / 2)) / baud_rate);
+}
@@ -0,0 +1,36 @@
+#ifndef __STARm_UART_H
+#define __STARm_UART_H
+
+// Project includes.
+#include "core.h"
+
+/*
+ * Class representing a U(S)ART interface.
+ * Only asynchronous 8N1 mode with polled transmit/receive
+ * is currently supported. The TX/RX pins must be set up
+ * separately, like the I2C pins.
+ */
+class pUART : public pIO {
+public:
+  // Constructor; call 'init' to choose a U(S)ART peripheral.
+  constexpr pUART() {}
+  bool     init(USART_TypeDef* uart_regs);
+  // Common r/w methods from the core I/O class.
+  unsigned read(void);
+  void     write(unsigned dat);
+  void     stream(volatile void* buf, int len);
+  void     flush(void);
+  // UART-specific methods.
+  void     uart_init(uint32_t baud);
+  // Clock manager callback.
+  void     clock_update(void);
+protected:
+  // USART struct from the device header files.
+  USART_TypeDef* uart = NULL;
+  // Current baud rate.
+  uint32_t       baud_rate = 0;
+  void     set_baud(void);
+private:
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef __STARm_UART_STATIC_H
+#define __STARm_UART_STATIC_H
+
+// Project includes.
+#include "io_static.h"
+#include "clock.h"
+
+/*
+ * Compile-time U(S)ART driver; see 'io_static.h'.
+ * Like the 'pUART' class, this supports asynchronous 8N1 mode
+ * with polled transmit/receive, and the TX/RX pins must be set
+ * up separately. The baud rate is a template parameter, so the
+ * only run-time state is in the peripheral's registers.
+ */
+template<uint32_t Base, uint32_t Baud>
+class pUARTPort : public pIOBase<pUARTPort<Base, Baud> > {
+  static_assert(Base == USART1_BASE || Base == USART2_BASE,
+                "Only USART1 and USART2 are currently supported.");
+  static_assert(Baud > 0, "The baud rate must not be 0.");
+public:
+  static constexpr uint32_t base        = Base;
+  static constexpr uint32_t baud        = Baud;
+  // (Only for the enable and reset bits; the baud rate clock
+  //  comes from 'pClock::get_usart_hz'.)
+  static constexpr bool     on_apb2     = (Base == USART1_BASE);
+  static constexpr uint32_t enable_addr = on_apb2 ?
+                                          pRCC_regs::APB2ENR::addr :
+                                          pRCC_regs::APB1ENR::addr;
+  static constexpr uint32_t enable_bit  = on_apb2 ?
+                                          pRCC_APB2ENR::USART1EN::mask :
+                                          pRCC_APB1ENR::USART2EN::mask;
+  static constexpr uint32_t reset_addr  = on_apb2 ?
+                                          pRCC_regs::APB2RSTR::addr :
+                                          pRCC_regs::APB1RSTR::addr;
+  static constexpr uint32_t reset_bit   = on_apb2 ?
+                                          pRCC_APB2RSTR::USART1RST::mask :
+                                          pRCC_APB1RSTR::USART2RST::mask;
+
+  static USART_TypeDef* regs(void) { return (USART_TypeDef*)Base; }
+
+  // Set the baud rate and enable the peripheral.
+  // The peripheral clock must be enabled first.
+  static void init(void) {
+    regs()->CR1 &= ~(USART_CR1_UE);
+    set_baud();
+    regs()->CR1  =  (USART_CR1_TE | USART_CR1_RE | USART_CR1_UE);
+  }
+
+  // Wait for the transmit register to empty, then send a byte.
+  static void write(unsigned dat) {
+    #if   defined(STARm_F3)
+      while (!(regs()->ISR & USART_ISR_TXE)) {};
+      regs()->TDR = (uint8_t)dat;
+    #elif STARm_F1
+      while (!(regs()->SR & USART_SR_TXE)) {};
+      regs()->DR  = (uint8_t)dat;
+    #endif
+  }
+
+  // Wait for a byte to arrive, and return it.
+  static unsigned read(void) {
+    #if   defined(STARm_F3)
+      while (!(regs()->ISR & USART_ISR_RXNE)) {};
+      return (regs()->RDR & 0xFF);
+    #elif STARm_F1
+      while (!(regs()->SR & USART_SR_RXNE)) {};
+      return (regs()->DR & 0xFF);
+    #endif
+  }
+
+  // Wait for the last byte to finish shifting out.
+  static void flush(void) {
+    #if   defined(STARm_F3)
+      while (!(regs()->ISR & USART_ISR_TC)) {};
+    #elif STARm_F1
+      while (!(regs()->SR & USART_SR_TC)) {};
+    #endif
+  }
+
+  // Re-calculate the baud rate divider after the bus clocks
+  // change, once any pending byte has been sent.
+  static void clock_update(void) {
+    flush();
+    regs()->CR1 &= ~(USART_CR1_UE);
+    set_baud();
+    regs()->CR1 |=  (USART_CR1_UE);
+  }
+
+  // With 16x oversampling, BRR is simply clock / baud.
+  static void set_baud(void) {
+    uint32_t clk = pClock::get_usart_hz(Base);
+    regs()->BRR = ((clk + (Baud / 2)) / Baud);
+  }
+};
+
+// Convenience definitions for the available ports.
+template<uint32_t Baud> using pUART1Port = pUARTPort<USART1_BASE, Baud>;
+template<uint32_t Baud> using pUART2Port = pUARTPort<USART2_BASE, Baud>;
+
+#endif
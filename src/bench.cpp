@@ -0,0 +1,435 @@
+#include "main.h"
+#include "dsp.h"
+#include "gpio_static.h"
+#include "semihost.h"
+
+// Number of timed runs per benchmark. (An odd number, so the
+// median is one of the samples.)
+#ifndef BENCH_RUNS
+  #define BENCH_RUNS (31)
+#endif
+// Output format version, for the host-side tools.
+#define BENCH_VERSION (1)
+
+// Static driver for the LED pin, for comparison with 'board_led'.
+#ifdef STARm_F1
+  typedef pPin<pPortB, LED_PIN> bench_led;
+#else
+  typedef pPin<pPortA, LED_PIN> bench_led;
+#endif
+
+#ifndef BENCH_SEMIHOSTING
+  // Serial port for the results; the same pins as the demo's
+  // stack sizing reports.
+  static pGPIO     report_gpio;
+  static pGPIO_pin report_tx;
+  static pUART     report_uart;
+#endif
+
+/*
+ * Simulated I2C device, as a compile-time bus driver: it accepts
+ * every byte immediately, so 'draw_framebuffer_on' can be timed
+ * without a display attached. This measures the CPU's share of
+ * a frame; the real bus adds the time on the wire.
+ */
+static volatile uint8_t  sim_last_byte  = 0;
+static volatile uint32_t sim_byte_count = 0;
+class pSimBus : public pIOBase<pSimBus> {
+public:
+  static constexpr uint32_t enable_addr = 0;
+  static constexpr uint32_t enable_bit  = 0;
+  static constexpr uint32_t reset_addr  = 0;
+  static constexpr uint32_t reset_bit   = 0;
+  static void     clock_en(void) {}
+  static void     disable(void)  {}
+  static void     reset(void)    {}
+  static void     start(uint8_t address) { sim_last_byte = address; }
+  static void     stop(void)     {}
+  static void     write(unsigned dat) {
+    sim_last_byte = (uint8_t)dat;
+    ++sim_byte_count;
+  }
+  static unsigned read(void)     { return 0; }
+  #if defined(STARm_F3)
+    static void   set_num_bytes(uint8_t nbytes) { (void)nbytes; }
+    static void   set_reload_flag(bool reload)  { (void)reload; }
+  #endif
+};
+// The same device behind the run-time 'pIO' interface, and a
+// frame's worth of data to send it.
+static pIOAdapter<pSimBus> sim_io;
+static uint8_t             sim_frame[OLED_MAX_FB_SIZE];
+
+// Input for the signal processing kernels: a block of samples,
+// and filters to pass them through. ('main' fills the arrays.)
+#define BENCH_DSP_BLOCK (64)
+static int16_t dsp_in[BENCH_DSP_BLOCK];
+static int16_t dsp_out[BENCH_DSP_BLOCK];
+static int16_t fir_taps[32];
+static int16_t fir8_state[2 * 8];
+static int16_t fir32_state[2 * 32];
+static int16_t avg_window[16];
+// A low-pass section with a gain of 1, in Q14.
+static const int16_t biquad_coeffs[5] = { 1024, 2048, 1024, -16384, 4096 };
+static pFIR       fir8(fir_taps, fir8_state, 8);
+static pFIR       fir32(fir_taps, fir32_state, 32);
+static pBiquad    biquad(biquad_coeffs);
+static pMovingAvg moving_avg(avg_window, 16);
+// (Results go here, so the calls are not optimized out.)
+static volatile int32_t dsp_sink = 0;
+static unsigned         dsp_pos  = 0;
+static int16_t next_sample(void) {
+  dsp_pos = (dsp_pos + 1) & (BENCH_DSP_BLOCK - 1);
+  return dsp_in[dsp_pos];
+}
+
+/* Benchmark cases. */
+// Colors alternate between runs, so every run changes pixels.
+static unsigned char bench_color = 0;
+static void next_color(void) { bench_color = !bench_color; }
+
+static __attribute__((noinline)) void bench_empty(void) {
+  __asm__ volatile("" ::: "memory");
+}
+static void bench_pixel(void) {
+  oled.draw_pixel(64, 32, bench_color);
+}
+static void bench_h_line(void) {
+  oled.draw_h_line(0, 20, 128, bench_color);
+}
+static void bench_v_line(void) {
+  oled.draw_v_line(10, 0, 64, bench_color);
+}
+static void bench_rect_fill(void) {
+  oled.draw_rect(0, 0, 128, 64, 0, bench_color);
+}
+static void bench_rect_outline(void) {
+  oled.draw_rect(0, 0, 128, 64, 4, bench_color);
+}
+static void bench_letter_s(void) {
+  oled.draw_letter(0, 0, OLED_CH_A0, OLED_CH_A1B1 >> 16,
+                   bench_color, 'S');
+}
+static void bench_letter_l(void) {
+  oled.draw_letter(0, 0, OLED_CH_A0, OLED_CH_A1B1 >> 16,
+                   bench_color, 'L');
+}
+// ('A' is the first character that 'draw_letter_c' checks,
+//  and '>' is the last.)
+static void bench_letter_c_first(void) {
+  oled.draw_letter_c(0, 0, 'A', bench_color, 'S');
+}
+static void bench_letter_c_last(void) {
+  oled.draw_letter_c(0, 0, '>', bench_color, 'S');
+}
+static void bench_text(void) {
+  oled.draw_text(0, 0, "Count: 1234", bench_color, 'S');
+}
+static void bench_int(void) {
+  oled.draw_letter_i(0, 40, 1234567890, bench_color, 'S');
+}
+static void bench_gpio_pin(void) {
+  board_led.toggle();
+}
+static void bench_gpio_bank(void) {
+  led_gpio.pin_toggle(LED_PIN);
+}
+static void bench_gpio_static(void) {
+  bench_led::toggle();
+}
+static void bench_frame_sim(void) {
+  oled.draw_framebuffer_on<pSimBus>();
+}
+// (One virtual call per byte, like the 'pI2C' class.)
+static void bench_stream_sim_io(void) {
+  pIO* io = &sim_io;
+  for (int i = 0; i < OLED_MAX_FB_SIZE; ++i) {
+    io->write(sim_frame[i]);
+  }
+}
+static void bench_fir8_step(void) {
+  dsp_sink = fir8.step(next_sample());
+}
+static void bench_fir32_step(void) {
+  dsp_sink = fir32.step(next_sample());
+}
+static void bench_fir32_block(void) {
+  fir32.process(dsp_in, dsp_out, BENCH_DSP_BLOCK);
+}
+static void bench_biquad_step(void) {
+  dsp_sink = biquad.step(next_sample());
+}
+static void bench_biquad_block(void) {
+  biquad.process(dsp_in, dsp_out, BENCH_DSP_BLOCK);
+}
+static void bench_avg_step(void) {
+  dsp_sink = moving_avg.step(next_sample());
+}
+static void bench_avg_block(void) {
+  moving_avg.process(dsp_in, dsp_out, BENCH_DSP_BLOCK);
+}
+static void bench_min_max(void) {
+  int16_t lo, hi;
+  pDSP::min_max(dsp_in, BENCH_DSP_BLOCK, &lo, &hi);
+  dsp_sink = lo + hi;
+}
+static void bench_add_sat(void) {
+  pDSP::add_sat(dsp_in, dsp_out, dsp_out, BENCH_DSP_BLOCK);
+}
+static void bench_dot(void) {
+  dsp_sink = pDSP::dot(dsp_in, dsp_out, BENCH_DSP_BLOCK);
+}
+#ifdef BENCH_I2C
+  static void bench_frame_i2c(void) {
+    oled.draw_framebuffer();
+  }
+  static void bench_frame_i2c_static(void) {
+    oled.draw_framebuffer_on<pI2C1Bus>();
+  }
+#endif
+
+// Benchmark table.
+struct bench_case {
+  const char* name;
+  void      (*fn)(void);
+  bool        recolor;
+};
+static const bench_case bench_cases[] = {
+  { "ssd1306_pixel",          bench_pixel,          true  },
+  { "ssd1306_h_line_128",     bench_h_line,         true  },
+  { "ssd1306_v_line_64",      bench_v_line,         true  },
+  { "ssd1306_rect_fill",      bench_rect_fill,      true  },
+  { "ssd1306_rect_outline_4", bench_rect_outline,   true  },
+  { "font_letter_s",          bench_letter_s,       true  },
+  { "font_letter_l",          bench_letter_l,       true  },
+  { "font_letter_c_first",    bench_letter_c_first, true  },
+  { "font_letter_c_last",     bench_letter_c_last,  true  },
+  { "font_text_11",           bench_text,           true  },
+  { "font_int_10",            bench_int,            true  },
+  { "gpio_pin_toggle",        bench_gpio_pin,       false },
+  { "gpio_bank_toggle",       bench_gpio_bank,      false },
+  { "gpio_static_toggle",     bench_gpio_static,    false },
+  { "i2c_frame_sim_static",   bench_frame_sim,      false },
+  { "i2c_stream_sim_pio",     bench_stream_sim_io,  false },
+  { "dsp_fir_step_8",         bench_fir8_step,      false },
+  { "dsp_fir_step_32",        bench_fir32_step,     false },
+  { "dsp_fir_block_32x64",    bench_fir32_block,    false },
+  { "dsp_biquad_step",        bench_biquad_step,    false },
+  { "dsp_biquad_block_64",    bench_biquad_block,   false },
+  { "dsp_moving_avg_step",    bench_avg_step,       false },
+  { "dsp_moving_avg_block_64", bench_avg_block,     false },
+  { "dsp_min_max_64",         bench_min_max,        false },
+  { "dsp_add_sat_64",         bench_add_sat,        false },
+  { "dsp_dot_64",             bench_dot,            false },
+  #ifdef BENCH_I2C
+    { "i2c_frame_pI2C",       bench_frame_i2c,        false },
+    { "i2c_frame_pI2C1Bus",   bench_frame_i2c_static, false },
+  #endif
+};
+
+/* Output. */
+/* Write a string to the debugger's console, or the serial port. */
+static void print(const char* str) {
+  #ifdef BENCH_SEMIHOSTING
+    pSemihost::call(pSEMIHOST_SYS_WRITE0, (void*)str);
+  #else
+    while (*str) { report_uart.write(*str++); }
+  #endif
+}
+
+/* Write an unsigned value, in decimal. */
+static void print_uint(unsigned val) {
+  char digits[11];
+  int n = 10;
+  digits[n] = '\0';
+  do {
+    digits[--n] = '0' + (val % 10);
+    val /= 10;
+  } while (val);
+  print(&digits[n]);
+}
+
+/* Measurement. */
+/*
+ * Time one call with the DWT cycle counter. Interrupts are
+ * masked, so nothing else is counted.
+ */
+static uint32_t time_once(void (*fn)(void)) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t start = DWT->CYCCNT;
+  fn();
+  uint32_t cycles = DWT->CYCCNT - start;
+  __set_PRIMASK(primask);
+  return cycles;
+}
+
+/* Sort a few samples, in place. */
+static void sort_samples(uint32_t* samples, int len) {
+  for (int i = 1; i < len; ++i) {
+    uint32_t val = samples[i];
+    int j = i;
+    while (j > 0 && samples[j - 1] > val) {
+      samples[j] = samples[j - 1];
+      --j;
+    }
+    samples[j] = val;
+  }
+}
+
+/*
+ * Run a benchmark 'BENCH_RUNS' times, after one untimed run to
+ * warm up; the samples come back sorted, without the overhead
+ * of an empty call.
+ */
+static void run_case(const bench_case* bc, uint32_t overhead,
+                     uint32_t* samples) {
+  if (bc->recolor) { next_color(); }
+  bc->fn();
+  for (int i = 0; i < BENCH_RUNS; ++i) {
+    if (bc->recolor) { next_color(); }
+    uint32_t cycles = time_once(bc->fn);
+    samples[i] = (cycles > overhead) ? (cycles - overhead) : 0;
+  }
+  sort_samples(samples, BENCH_RUNS);
+}
+
+/*
+ * Benchmark runner, which is linked instead of the demo's 'main'
+ * by 'make bench'. It sets up the same peripherals, then times
+ * each case and prints the results as CSV, after a few '#'
+ * comment lines which describe the build:
+ *   # starm_bench 1
+ *   # mcu STM32F103C8
+ *   ...
+ *   name,runs,min,median,max
+ *   ssd1306_pixel,31,40,40,42
+ * All values are core clock cycles. The scheduler is never
+ * started, so no other code runs in between. The results go to
+ * the board's serial port, or the debugger's console with
+ * 'BENCH_SEMIHOSTING'; 'bench_compare' compares two runs.
+ * Without 'BENCH_I2C', the display is not used; frames are only
+ * sent to a simulated device.
+ */
+int main(void) {
+  // Call C++ static initializers.
+  int cpp_count = 0;
+  int cpp_size = &(_epreinit_array[0]) - &(_spreinit_array[0]);
+  for (cpp_count = 0; cpp_count < cpp_size; ++cpp_count) {
+    _spreinit_array[cpp_count]();
+  }
+  cpp_size = &(_einit_array[0]) - &(_sinit_array[0]);
+  for (cpp_count = 0; cpp_count < cpp_size; ++cpp_count) {
+    _sinit_array[cpp_count]();
+  }
+
+  // Initial clock setup, and the cycle counter.
+  setup_clocks();
+  pLog::init();
+
+  // Initialize the LED pin.
+  led_gpio.init(LED_BANK);
+  led_gpio.clock_en();
+  board_led.init(&led_gpio, LED_PIN, pGPIO_OUT_PP);
+  // Set up the display object; it is only drawn to the screen
+  // with 'BENCH_I2C'.
+  i2c1.init(I2C1);
+  oled.init(&i2c1, 0x78, 128, 64);
+  #ifdef BENCH_I2C
+    // Initialize the I2C pins and peripheral, like the demo.
+    pGPIO* i2c_bank = &led_gpio;
+    if (I2C_BANK != LED_BANK) {
+      i2c_gpio.init(I2C_BANK);
+      i2c_gpio.clock_en();
+      i2c_bank = &i2c_gpio;
+    }
+    #if   defined(STARm_F3)
+      sda_gpio.init(i2c_bank, SDA_PIN, pGPIO_AF_OD_PULLUP);
+      scl_gpio.init(i2c_bank, SCL_PIN, pGPIO_AF_OD_PULLUP);
+      sda_gpio.set_alt_func(4);
+      scl_gpio.set_alt_func(4);
+    #elif STARm_F1
+      sda_gpio.init(i2c_bank, SDA_PIN, pGPIO_AF_OD);
+      scl_gpio.init(i2c_bank, SCL_PIN, pGPIO_AF_OD);
+    #endif
+    i2c1.reset();
+    i2c1.clock_en();
+    i2c1.i2c_init();
+    oled.init_display();
+    i2c1.set_auto_gate(true);
+  #endif
+  // Fill the signal processing kernels' input with noise between
+  // -512 and 511, and give the FIR filters equal taps which add
+  // up to just under 1.0.
+  uint32_t seed = 1;
+  for (int i = 0; i < BENCH_DSP_BLOCK; ++i) {
+    seed = (seed * 1664525) + 1013904223;
+    dsp_in[i]  = (int16_t)((int32_t)seed >> 22);
+    dsp_out[i] = 0;
+  }
+  for (int i = 0; i < 32; ++i) { fir_taps[i] = 1023; }
+  #ifndef BENCH_SEMIHOSTING
+    // Set up the 'TX' pin of USART1 (F1: PA9) or USART2 (F3: PA2).
+    report_gpio.init(GPIOA);
+    report_gpio.clock_en();
+    #if   defined(STARm_F3)
+      report_tx.init(&report_gpio, 2, pGPIO_AF_PP);
+      report_tx.set_alt_func(7);
+      report_uart.init(USART2);
+    #elif STARm_F1
+      report_tx.init(&report_gpio, 9, pGPIO_AF_PP);
+      report_uart.init(USART1);
+    #endif
+    report_uart.clock_en();
+    report_uart.uart_init(115200);
+  #endif
+
+  // Measure the cost of an empty call, which is taken out of
+  // every other sample.
+  static uint32_t samples[BENCH_RUNS];
+  bench_case empty = { "empty", bench_empty, false };
+  run_case(&empty, 0, samples);
+  uint32_t overhead = samples[0];
+
+  // Describe the build.
+  print("# starm_bench ");
+  print_uint(BENCH_VERSION);
+  #if   defined(STARm_STM32F103C8)
+    print("\r\n# mcu STM32F103C8");
+  #elif defined(STARm_STM32F303K8)
+    print("\r\n# mcu STM32F303K8");
+  #endif
+  print("\r\n# core_hz ");
+  print_uint(pClock::get_sysclk_hz());
+  #ifdef NO_RAMFUNC
+    print("\r\n# ramfunc 0");
+  #else
+    print("\r\n# ramfunc 1");
+  #endif
+  print("\r\n# overhead ");
+  print_uint(overhead);
+  print("\r\nname,runs,min,median,max\r\n");
+
+  // Run the benchmarks.
+  for (unsigned i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); ++i) {
+    run_case(&bench_cases[i], overhead, samples);
+    print(bench_cases[i].name);
+    print(",");
+    print_uint(BENCH_RUNS);
+    print(",");
+    print_uint(samples[0]);
+    print(",");
+    print_uint(samples[BENCH_RUNS / 2]);
+    print(",");
+    print_uint(samples[BENCH_RUNS - 1]);
+    print("\r\n");
+  }
+  print("# done\r\n");
+
+  #ifdef BENCH_SEMIHOSTING
+    // End the debug session.
+    pSemihost::call(pSEMIHOST_SYS_EXIT, (void*)(uintptr_t)pSEMIHOST_EXIT_OK);
+  #endif
+  while (1) {}
+  return 0;
+}
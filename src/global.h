@@ -22,9 +22,24 @@ extern "C" {
 
 // Project includes.
 #include "core.h"
+#include "clock.h"
+#include "clockgate.h"
 #include "gpio.h"
 #include "i2c.h"
 #include "ssd1306.h"
+#include "stats.h"
+#include "rtos.h"
+#include "ringbuf.h"
+#include "pool.h"
+#include "i2c_static.h"
+#include "uart_static.h"
+#include "stackmon.h"
+#include "lowpower.h"
+#include "log.h"
+#include "trace.h"
+#include "profiler.h"
+#include "uart.h"
+#include "stack_sizes.h"
 
 /* Global variables and defines. */
 
@@ -42,15 +57,18 @@ extern "C" {
   #define LED_PIN  (1)
 #endif
 
-// Core system clock speed; initial value depends on the chip.
-extern volatile uint32_t core_clock_hz;
 // Value to show on the display.
 extern volatile uint16_t count_val;
 // How long to delay between LED blinks (ms).
 extern const    int      led_delay;
-// OLED-related delay lengths in milliseconds.
+// OLED-related delay length in milliseconds.
 extern const    int      count_delay;
-extern const    int      display_delay;
+// Maximum display refresh rate, in frames per second.
+extern const    int      display_max_fps;
+// Render task notification bits: which parts of the
+// display need to be redrawn.
+#define RENDER_COUNT (0x01)
+#define RENDER_STATS (0x02)
 
 // Global peripheral structs.
 extern pGPIO     led_gpio;
@@ -1,5 +1,28 @@
 #include "main.h"
 
+// Task control blocks and stacks.
+// (Sizes are set in 'stack_sizes.h'. The busiest tasks use
+//  CCM RAM on chips which have it.)
+static pRTOS_RAM     pTask<STACK_WORDS_BLINK_LED>    led_task_mem;
+static pRTOS_RAM     pTask<STACK_WORDS_COUNT_UP>     count_task_mem;
+static pRTOS_CCM_RAM pTask<STACK_WORDS_RENDER>       render_task_mem;
+static pRTOS_CCM_RAM pTask<STACK_WORDS_OLED_DISPLAY> oled_display_task_mem;
+
+#if defined(STACK_REPORT) || defined(TRACE_RECORDER) || defined(PROFILER)
+  // Serial port for stack sizing reports, traces and profiles:
+  // USART1 (F1: PA9) or USART2 (F3: PA2, which is connected to
+  // the Nucleo-32 board's virtual COM port). It is a static
+  // driver, wrapped for the report code which takes a 'pIO*'.
+  #if   defined(STARm_F3)
+    typedef pUART2Port<115200> report_port;
+  #elif STARm_F1
+    typedef pUART1Port<115200> report_port;
+  #endif
+  static pGPIO                    report_gpio;
+  static pGPIO_pin                report_tx;
+  static pIOAdapter<report_port>  report_uart;
+#endif
+
 /**
  * 'Blink LED' task.
  */
@@ -14,31 +37,100 @@ static void led_task(void *args) {
 
 /**
  * 'Count value' task.
+ * This only produces data; it tells the render task what
+ * changed, and the render task draws it.
  */
 static void count_task(void *args) {
   int delay_ms = *(int*)args;
+  int stats_counts = 1000 / delay_ms;
+  int counts = 0;
 
   while (1) {
-    // Count up and draw to the display.
+    // Count up.
     ++count_val;
-    oled.draw_rect(68, 28, 34, 8, 0, 0);
-    oled.draw_letter_i(70, 29, count_val, 1, 'S');
-    // Delay for a second-ish.
+    uint32_t changed = RENDER_COUNT;
+    // Update the CPU load overlay about once per second.
+    if (++counts >= stats_counts) {
+      counts = 0;
+      changed |= RENDER_STATS;
+    }
+    xTaskNotify(render_task_mem.get_handle(), changed, eSetBits);
     vTaskDelay(pdMS_TO_TICKS(delay_ms));
   };
 }
 
+/**
+ * 'Render' task.
+ * Waits for producers to say what changed, redraws those parts
+ * of the framebuffer, and wakes the display task if any pixels
+ * actually changed.
+ */
+static void render_task(void *args) {
+  (void)args;
+  uint32_t changed;
+  uint16_t drawn_count = 0;
+  uint32_t rendered_version = oled.get_fb_version();
+
+  while (1) {
+    xTaskNotifyWait(0, 0xFFFFFFFF, &changed, portMAX_DELAY);
+    if ((changed & RENDER_COUNT) && count_val != drawn_count) {
+      drawn_count = count_val;
+      oled.draw_rect(68, 28, 34, 8, 0, 0);
+      oled.draw_letter_i(70, 29, drawn_count, 1, 'S');
+    }
+    if (changed & RENDER_STATS) {
+      // Measure and draw the CPU load since the last update.
+      pTRACE_BEGIN("stats");
+      pStats::sample();
+      pStats::draw_overlay(&oled, 7, 8);
+      pTRACE_END("stats");
+    }
+    if (oled.get_fb_version() != rendered_version) {
+      rendered_version = oled.get_fb_version();
+      xTaskNotifyGive(oled_display_task_mem.get_handle());
+    }
+  }
+}
+
 /**
  * 'Draw to OLED Display' task.
+ * Sends the framebuffer to the display when the render task
+ * changes it, at most 'max_fps' times per second.
  */
 static void oled_display_task(void *args) {
-  int delay_ms = *(int*)args;
+  int max_fps = *(int*)args;
+  TickType_t min_period = pdMS_TO_TICKS(1000 / max_fps);
+  // Send the initial frame.
+  TickType_t last_flush = xTaskGetTickCount();
+  uint32_t flushed_version = oled.get_fb_version();
+  oled.draw_framebuffer_on<pI2C1Bus>();
 
   while(1) {
-    // Stream the framebuffer to the display, then
-    // wait a bit before refreshing again.
-    oled.draw_framebuffer();
-    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    // Wait out the rest of the minimum frame period. Changes
+    // which are rendered in the meantime go out in this frame.
+    TickType_t elapsed = xTaskGetTickCount() - last_flush;
+    if (elapsed < min_period) {
+      vTaskDelay(min_period - elapsed);
+    }
+    uint32_t version = oled.get_fb_version();
+    if (version == flushed_version) { continue; }
+    // Stream the framebuffer to the display. Anything that
+    // is drawn during the transfer will notify this task
+    // again, so it is sent in the next frame.
+    last_flush = xTaskGetTickCount();
+    flushed_version = version;
+    #ifdef LOG_SEMIHOSTING
+      uint32_t start = DWT->CYCCNT;
+    #endif
+    pTRACE_BEGIN("frame");
+    oled.draw_framebuffer_on<pI2C1Bus>();
+    pTRACE_END("frame");
+    #ifdef LOG_SEMIHOSTING
+      // (Only log frames when a task drains the log; otherwise
+      //  the buffer fills up and every message is dropped.)
+      pLOG("frame %u sent in %u cycles", version, DWT->CYCCNT - start);
+    #endif
   };
 }
 
@@ -62,55 +154,108 @@ int main(void) {
 
   // Initial clock setup.
   setup_clocks();
+  // Set up the RTC for low-power idle. (If the LSI oscillator
+  // does not calibrate, only SLEEP mode is used.)
+  pLowPower::init();
 
   // Initialize the LED pin's GPIO bank.
-  led_gpio = pGPIO(LED_BANK);
+  // (The peripheral objects are set up in place; they are
+  //  constant-initialized, and can not be copied.)
+  led_gpio.init(LED_BANK);
   led_gpio.clock_en();
   // Initialize the LED pin.
-  board_led = pGPIO_pin(&led_gpio, LED_PIN, pGPIO_OUT_PP);
+  board_led.init(&led_gpio, LED_PIN, pGPIO_OUT_PP);
   // Initialize the I2C GPIO bank.
-  if (I2C_BANK == LED_BANK) {
-    // Use an already-initialized GPIO class if available.
-    i2c_gpio = led_gpio;
-  }
-  else {
-    // Otherwise, create a new one.
-    i2c_gpio = pGPIO(I2C_BANK);
+  pGPIO* i2c_bank = &led_gpio;
+  if (I2C_BANK != LED_BANK) {
+    // Use the LED's GPIO bank object if it is the same bank;
+    // otherwise, set up the second one.
+    i2c_gpio.init(I2C_BANK);
     i2c_gpio.clock_en();
+    i2c_bank = &i2c_gpio;
   }
   // Initialize the I2C GPIO pins.
   #if   defined(STARm_F3)
-    sda_gpio = pGPIO_pin(&i2c_gpio, SDA_PIN, pGPIO_AF_OD_PULLUP);
-    scl_gpio = pGPIO_pin(&i2c_gpio, SCL_PIN, pGPIO_AF_OD_PULLUP);
+    sda_gpio.init(i2c_bank, SDA_PIN, pGPIO_AF_OD_PULLUP);
+    scl_gpio.init(i2c_bank, SCL_PIN, pGPIO_AF_OD_PULLUP);
     sda_gpio.set_alt_func(4);
     scl_gpio.set_alt_func(4);
   #elif STARm_F1
-    sda_gpio = pGPIO_pin(&i2c_gpio, SDA_PIN, pGPIO_AF_OD);
-    scl_gpio = pGPIO_pin(&i2c_gpio, SCL_PIN, pGPIO_AF_OD);
+    sda_gpio.init(i2c_bank, SDA_PIN, pGPIO_AF_OD);
+    scl_gpio.init(i2c_bank, SCL_PIN, pGPIO_AF_OD);
   #endif
   // Initialize the I2C peripheral.
-  i2c1 = pI2C(I2C1);
+  i2c1.init(I2C1);
   i2c1.reset();
   i2c1.clock_en();
   i2c1.i2c_init();
+  // Re-calculate the I2C timing if the core clock changes.
+  pClock::add_listener(&i2c1);
   // Initialize the SSD1306 OLED display.
-  oled = pSSD1306(&i2c1, 0x78, 128, 64);
+  oled.init(&i2c1, 0x78, 128, 64);
   oled.init_display();
+  // Only clock the I2C peripheral while a frame is being sent.
+  i2c1.set_auto_gate(true);
   // Draw an initial display image to the framebuffer.
   oled.draw_rect(0, 0, 128, 64, 0, 0);
   oled.draw_rect(0, 0, 128, 64, 4, 1);
   oled.draw_text(28, 29, "Count:\0", 1, 'S');
+  // Start the DWT cycle counter, for log timestamps.
+  pLog::init();
 
   // Create a blinking LED task for the on-board LED.
-  xTaskCreate(led_task, "Blink_LED", 128, (void*)&led_delay,
-              configMAX_PRIORITIES-7, NULL);
+  led_task_mem.start(led_task, "Blink_LED", (void*)&led_delay,
+                     configMAX_PRIORITIES-7);
   // Create the OLED counting/display tasks.
-  xTaskCreate(count_task, "Count_Up",
-              128, (void*)&count_delay,
-              configMAX_PRIORITIES-6, NULL);
-  xTaskCreate(oled_display_task, "OLED_Display",
-              128, (void*)&display_delay,
-              configMAX_PRIORITIES-5, NULL);
+  count_task_mem.start(count_task, "Count_Up",
+                       (void*)&count_delay,
+                       configMAX_PRIORITIES-6);
+  render_task_mem.start(render_task, "Render", NULL,
+                        tskIDLE_PRIORITY+2);
+  oled_display_task_mem.start(oled_display_task, "OLED_Display",
+                              (void*)&display_max_fps,
+                              tskIDLE_PRIORITY+1);
+  // Track the tasks' stack use.
+  pStackMon::watch(led_task_mem);
+  pStackMon::watch(count_task_mem);
+  pStackMon::watch(render_task_mem);
+  pStackMon::watch(oled_display_task_mem);
+  #if defined(STACK_REPORT) || defined(TRACE_RECORDER) || defined(PROFILER)
+    // Set up the report port's 'TX' pin, and the port.
+    report_gpio.init(GPIOA);
+    report_gpio.clock_en();
+    #if   defined(STARm_F3)
+      report_tx.init(&report_gpio, 2, pGPIO_AF_PP);
+      report_tx.set_alt_func(7);
+    #elif STARm_F1
+      report_tx.init(&report_gpio, 9, pGPIO_AF_PP);
+    #endif
+    report_port::clock_en();
+    report_port::init();
+    pClock::add_listener(&report_uart);
+  #endif
+  #ifdef STACK_REPORT
+    // Print a stack sizing report every 10 seconds.
+    pClockGate::report(&report_uart);
+    pStackMon::start_task(10000, &report_uart);
+  #endif
+  #ifdef TRACE_RECORDER
+    // Record the kernel's events, and send them every 2 seconds.
+    pTrace::start();
+    pTrace::start_task(2000, &report_uart);
+  #endif
+  #ifdef PROFILER
+    // Sample the program counter and the caller's address 997
+    // times per second, and send the profile every 10 seconds.
+    pProfiler::start(997, true);
+    pProfiler::start_task(10000, &report_uart);
+  #endif
+  #ifdef LOG_SEMIHOSTING
+    // Send log messages to the debugger every 100ms. (The demo
+    // only logs in this build, since the report UART carries the
+    // binary trace and profile streams.)
+    pLog::start_task(100, NULL);
+  #endif
   // Start the scheduler.
   vTaskStartScheduler();
 
@@ -0,0 +1,15 @@
+#ifndef _STARm_STACK_SIZES_H
+#define _STARm_STACK_SIZES_H
+
+/*
+ * Task stack sizes, in words.
+ * To re-calculate these, build with 'make STACK_REPORT=1', run
+ * the program through its usual workload, and paste the
+ * '#define' lines from the serial port's sizing report here.
+ */
+#define STACK_WORDS_BLINK_LED    (128)
+#define STACK_WORDS_COUNT_UP     (128)
+#define STACK_WORDS_RENDER       (128)
+#define STACK_WORDS_OLED_DISPLAY (128)
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * Host-side comparison of two on-target benchmark runs, which
+ * were printed by the runner that 'make bench' builds (see
+ * 'src/bench.cpp'). Build it with 'make tools', then save the
+ * output of each run with something like
+ * 'cat /dev/ttyUSB0 > new.csv' and run:
+ *
+ *   bench_compare [-t <percent>] <baseline.csv> <new.csv>
+ *
+ * For each benchmark, it prints the median cycle counts of both
+ * runs and the change between them. Benchmarks whose median
+ * grew by more than the threshold (5% by default) are marked as
+ * regressions, and the exit status is 2 if there were any, so
+ * it can fail a scripted check. '#' comment lines which differ
+ * between the runs (like the MCU or core clock speed) are
+ * printed as a warning, since the numbers may not be comparable.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Output format; this matches 'src/bench.cpp'.
+#define BENCH_VERSION (1)
+
+// One benchmark's results, in core clock cycles.
+struct result {
+  std::string name;
+  unsigned    runs;
+  unsigned    min;
+  unsigned    median;
+  unsigned    max;
+};
+
+// One run: its settings, and results in the order they ran.
+struct run {
+  std::map<std::string, std::string> settings;
+  std::vector<result>                results;
+};
+
+/*
+ * Read a run's output. Comment lines hold 'key value' settings,
+ * and everything after the CSV header is a result; anything
+ * else (like a partial line from before the board reset) is
+ * skipped. If the file holds several runs, the last one is used.
+ */
+static bool load_run(const char* path, run& r) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Could not open '%s'.\n", path);
+    return false;
+  }
+  char line[256];
+  bool in_table = false;
+  while (fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (!strncmp(line, "# ", 2)) {
+      char key[64];
+      char val[128];
+      if (sscanf(line + 2, "%63s %127s", key, val) != 2) { continue; }
+      if (!strcmp(key, "starm_bench")) {
+        // A new run starts.
+        r.settings.clear();
+        r.results.clear();
+        in_table = false;
+        if (atoi(val) != BENCH_VERSION) {
+          fprintf(stderr, "'%s': unknown format version %s.\n",
+                  path, val);
+          fclose(f);
+          return false;
+        }
+      }
+      r.settings[key] = val;
+      continue;
+    }
+    if (!strcmp(line, "name,runs,min,median,max")) {
+      in_table = true;
+      continue;
+    }
+    if (!in_table) { continue; }
+    char name[64];
+    result res;
+    if (sscanf(line, "%63[^,],%u,%u,%u,%u", name, &res.runs,
+               &res.min, &res.median, &res.max) != 5) {
+      continue;
+    }
+    res.name = name;
+    r.results.push_back(res);
+  }
+  fclose(f);
+  if (r.results.empty()) {
+    fprintf(stderr, "'%s': no benchmark results found.\n", path);
+    return false;
+  }
+  return true;
+}
+
+/* Warn about settings which differ between the runs. */
+static void compare_settings(const run& base, const run& cur) {
+  std::map<std::string, std::string> keys;
+  for (const auto& s : base.settings) { keys[s.first] = s.second; }
+  for (const auto& s : cur.settings)  { keys[s.first] = s.second; }
+  for (const auto& k : keys) {
+    // (The call overhead is measured, not configured.)
+    if (k.first == "overhead") { continue; }
+    auto b = base.settings.find(k.first);
+    auto c = cur.settings.find(k.first);
+    std::string bv = (b != base.settings.end()) ? b->second : "-";
+    std::string cv = (c != cur.settings.end())  ? c->second : "-";
+    if (bv != cv) {
+      printf("# warning: '%s' differs: %s -> %s\n",
+             k.first.c_str(), bv.c_str(), cv.c_str());
+    }
+  }
+}
+
+/*
+ * Print the median of each benchmark in both runs; returns the
+ * number of regressions.
+ */
+static int compare_results(const run& base, const run& cur,
+                           double threshold) {
+  std::map<std::string, const result*> base_by_name;
+  for (const auto& r : base.results) { base_by_name[r.name] = &r; }
+  int regressions = 0;
+  printf("%-26s %10s %10s %9s\n", "name", "base", "new", "change");
+  for (const auto& r : cur.results) {
+    auto b = base_by_name.find(r.name);
+    if (b == base_by_name.end()) {
+      printf("%-26s %10s %10u %9s  new\n", r.name.c_str(), "-",
+             r.median, "-");
+      continue;
+    }
+    unsigned bm = b->second->median;
+    double change = bm ? (100.0 * ((double)r.median - bm) / bm) :
+                         (r.median ? 100.0 : 0.0);
+    const char* mark = "";
+    if (change > threshold) {
+      mark = "  REGRESSION";
+      ++regressions;
+    }
+    else if (change < -threshold) {
+      mark = "  faster";
+    }
+    printf("%-26s %10u %10u %+8.1f%%%s\n", r.name.c_str(), bm,
+           r.median, change, mark);
+    base_by_name.erase(b);
+  }
+  for (const auto& b : base_by_name) {
+    printf("%-26s %10u %10s %9s  missing\n", b.first.c_str(),
+           b.second->median, "-", "-");
+  }
+  return regressions;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+    "Usage: bench_compare [-t <percent>] <baseline.csv> <new.csv>\n");
+}
+
+int main(int argc, char** argv) {
+  double threshold = 5.0;
+  int arg = 1;
+  if (argc > 2 && !strcmp(argv[1], "-t")) {
+    threshold = atof(argv[2]);
+    arg = 3;
+  }
+  if (argc - arg != 2 || threshold < 0) {
+    usage();
+    return 1;
+  }
+  run base;
+  run cur;
+  if (!load_run(argv[arg], base))     { return 1; }
+  if (!load_run(argv[arg + 1], cur))  { return 1; }
+  compare_settings(base, cur);
+  int regressions = compare_results(base, cur, threshold);
+  if (regressions) {
+    printf("# %d regression(s) over %.1f%%\n", regressions, threshold);
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,289 @@
+/*
+ * Host-side decoder for logic analyzer captures which were
+ * exported by the 'pCapture' class over a serial link.
+ * Build it with 'make tools', then record a capture with
+ * something like 'cat /dev/ttyUSB0 > capture.bin' and run:
+ *
+ *   la_decode capture.bin dump
+ *   la_decode capture.bin i2c  <scl_pin> <sda_pin>
+ *   la_decode capture.bin spi  <sck_pin> <mosi_pin> [miso_pin]
+ *                              [cs_pin] [mode]
+ *   la_decode capture.bin uart <rx_pin> <baud>
+ *
+ * Pin numbers are 0-15, within the captured GPIO bank. Pass '-'
+ * for an unused optional SPI pin. Times are printed in
+ * microseconds, relative to the trigger sample.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+// Decoded capture file.
+struct capture {
+  uint32_t rate;
+  uint32_t trigger;
+  uint16_t mask;
+  std::vector<uint16_t> samples;
+};
+
+static uint32_t get_le(const uint8_t* p, unsigned nbytes) {
+  uint32_t v = 0;
+  for (unsigned i = 0; i < nbytes; ++i) {
+    v |= ((uint32_t)p[i]) << (i * 8);
+  }
+  return v;
+}
+
+/*
+ * Read a capture file. The 'LACP' header is searched for, since
+ * a serial recording may have other data in front of it.
+ */
+static bool load_capture(const char* path, capture& cap) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Could not open '%s'.\n", path);
+    return false;
+  }
+  std::vector<uint8_t> raw;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    raw.insert(raw.end(), chunk, chunk + n);
+  }
+  fclose(f);
+  const size_t header_len = 20;
+  for (size_t pos = 0; pos + header_len <= raw.size(); ++pos) {
+    const uint8_t* p = &raw[pos];
+    if (memcmp(p, "LACP", 4) != 0) { continue; }
+    if (p[4] != 1 || p[5] != 2) {
+      fprintf(stderr, "Unsupported capture format version.\n");
+      return false;
+    }
+    cap.rate    = get_le(p + 6, 4);
+    uint32_t count = get_le(p + 10, 4);
+    cap.trigger = get_le(p + 14, 4);
+    cap.mask    = get_le(p + 18, 2);
+    const uint8_t* s = p + header_len;
+    if (pos + header_len + ((size_t)count * 2) > raw.size()) {
+      fprintf(stderr, "Capture is truncated.\n");
+      return false;
+    }
+    cap.samples.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      cap.samples[i] = get_le(s + (i * 2), 2);
+    }
+    if (!cap.rate) {
+      fprintf(stderr, "Capture has a sample rate of 0.\n");
+      return false;
+    }
+    return true;
+  }
+  fprintf(stderr, "No capture header found in '%s'.\n", path);
+  return false;
+}
+
+// Time of a sample in microseconds, relative to the trigger.
+static double t_us(const capture& cap, size_t i) {
+  return ((double)i - (double)cap.trigger) * 1e6 / cap.rate;
+}
+
+static int bit(const capture& cap, size_t i, int pin) {
+  return (cap.samples[i] >> pin) & 1;
+}
+
+/*
+ * Print every sample where the bank's value changes.
+ */
+static void decode_dump(const capture& cap) {
+  printf("# %u samples at %u Hz, trigger at %u, mask 0x%04X\n",
+         (unsigned)cap.samples.size(), cap.rate, cap.trigger, cap.mask);
+  for (size_t i = 0; i < cap.samples.size(); ++i) {
+    if (i == 0 || cap.samples[i] != cap.samples[i - 1] || i == cap.trigger) {
+      printf("%12.3f  0x%04X%s\n", t_us(cap, i), cap.samples[i],
+             (i == cap.trigger) ? "  <- trigger" : "");
+    }
+  }
+}
+
+/*
+ * I2C: START/STOP are SDA edges while SCL is high, and data
+ * bits are sampled on SCL rising edges, MSB-first, with a
+ * 9th ACK/NACK bit after each byte.
+ */
+static void decode_i2c(const capture& cap, int scl, int sda) {
+  bool in_frame = false;
+  bool first = false;
+  unsigned nbits = 0;
+  unsigned byte = 0;
+  size_t byte_start = 0;
+  for (size_t i = 1; i < cap.samples.size(); ++i) {
+    int scl0 = bit(cap, i - 1, scl), scl1 = bit(cap, i, scl);
+    int sda0 = bit(cap, i - 1, sda), sda1 = bit(cap, i, sda);
+    if (scl0 && scl1 && sda0 && !sda1) {
+      printf("%12.3f  I2C %s\n", t_us(cap, i), in_frame ? "RESTART" : "START");
+      in_frame = true;
+      first = true;
+      nbits = 0;
+      byte = 0;
+    }
+    else if (scl0 && scl1 && !sda0 && sda1) {
+      printf("%12.3f  I2C STOP\n", t_us(cap, i));
+      in_frame = false;
+    }
+    else if (in_frame && !scl0 && scl1) {
+      if (nbits == 0) { byte_start = i; }
+      if (nbits < 8) {
+        byte = (byte << 1) | sda1;
+        ++nbits;
+      }
+      else {
+        const char* ack = sda1 ? "NACK" : "ACK";
+        if (first) {
+          printf("%12.3f  I2C ADDR 0x%02X (%s) %s\n", t_us(cap, byte_start),
+                 byte >> 1, (byte & 1) ? "R" : "W", ack);
+        }
+        else {
+          printf("%12.3f  I2C DATA 0x%02X %s\n", t_us(cap, byte_start),
+                 byte, ack);
+        }
+        first = false;
+        nbits = 0;
+        byte = 0;
+      }
+    }
+  }
+}
+
+/*
+ * SPI: data is sampled MSB-first on the rising clock edge in
+ * modes 0 and 3, and on the falling edge in modes 1 and 2.
+ * If a CS pin is given, it is active-low and resets the byte.
+ */
+static void decode_spi(const capture& cap, int sck, int mosi,
+                       int miso, int cs, int mode) {
+  bool rising = (mode == 0 || mode == 3);
+  unsigned nbits = 0;
+  unsigned mo = 0, mi = 0;
+  size_t byte_start = 0;
+  for (size_t i = 1; i < cap.samples.size(); ++i) {
+    if (cs >= 0) {
+      int cs0 = bit(cap, i - 1, cs), cs1 = bit(cap, i, cs);
+      if (cs0 && !cs1) {
+        printf("%12.3f  SPI CS low\n", t_us(cap, i));
+        nbits = 0;
+        mo = mi = 0;
+      }
+      else if (!cs0 && cs1) {
+        printf("%12.3f  SPI CS high\n", t_us(cap, i));
+        nbits = 0;
+      }
+      if (cs1) { continue; }
+    }
+    int sck0 = bit(cap, i - 1, sck), sck1 = bit(cap, i, sck);
+    bool edge = rising ? (!sck0 && sck1) : (sck0 && !sck1);
+    if (!edge) { continue; }
+    if (nbits == 0) { byte_start = i; }
+    mo = (mo << 1) | (unsigned)bit(cap, i, mosi);
+    if (miso >= 0) { mi = (mi << 1) | (unsigned)bit(cap, i, miso); }
+    if (++nbits == 8) {
+      if (miso >= 0) {
+        printf("%12.3f  SPI MOSI 0x%02X MISO 0x%02X\n",
+               t_us(cap, byte_start), mo, mi);
+      }
+      else {
+        printf("%12.3f  SPI MOSI 0x%02X\n", t_us(cap, byte_start), mo);
+      }
+      nbits = 0;
+      mo = mi = 0;
+    }
+  }
+}
+
+/*
+ * UART (8N1): a falling edge on an idle line starts a frame,
+ * and each bit is sampled in the middle of its bit period.
+ */
+static void decode_uart(const capture& cap, int rx, uint32_t baud) {
+  double period = (double)cap.rate / baud;
+  if (period < 3.0) {
+    fprintf(stderr, "Warning: only %.1f samples per bit.\n", period);
+  }
+  size_t i = 1;
+  while (i < cap.samples.size()) {
+    if (!(bit(cap, i - 1, rx) && !bit(cap, i, rx))) {
+      ++i;
+      continue;
+    }
+    size_t start = i;
+    size_t stop_pos = start + (size_t)(9.5 * period);
+    if (stop_pos >= cap.samples.size()) { break; }
+    unsigned byte = 0;
+    for (int b = 0; b < 8; ++b) {
+      size_t pos = start + (size_t)((1.5 + b) * period);
+      byte |= (unsigned)bit(cap, pos, rx) << b;
+    }
+    bool framing_ok = bit(cap, stop_pos, rx);
+    printf("%12.3f  UART 0x%02X", t_us(cap, start), byte);
+    if (byte >= 0x20 && byte < 0x7F) { printf(" '%c'", byte); }
+    printf("%s\n", framing_ok ? "" : " (framing error)");
+    // Resume looking for a start bit after the stop bit.
+    i = stop_pos + 1;
+  }
+}
+
+static int pin_arg(const char* s) {
+  if (!strcmp(s, "-")) { return -1; }
+  int p = atoi(s);
+  if (p < 0 || p > 15) {
+    fprintf(stderr, "Invalid pin number '%s'.\n", s);
+    exit(1);
+  }
+  return p;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+    "Usage: la_decode <capture.bin> dump\n"
+    "       la_decode <capture.bin> i2c  <scl> <sda>\n"
+    "       la_decode <capture.bin> spi  <sck> <mosi> [miso] [cs] [mode]\n"
+    "       la_decode <capture.bin> uart <rx> <baud>\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+  capture cap;
+  if (!load_capture(argv[1], cap)) { return 1; }
+  const char* proto = argv[2];
+  if (!strcmp(proto, "dump")) {
+    decode_dump(cap);
+  }
+  else if (!strcmp(proto, "i2c") && argc == 5) {
+    decode_i2c(cap, pin_arg(argv[3]), pin_arg(argv[4]));
+  }
+  else if (!strcmp(proto, "spi") && argc >= 5 && argc <= 8) {
+    int miso = (argc > 5) ? pin_arg(argv[5]) : -1;
+    int cs   = (argc > 6) ? pin_arg(argv[6]) : -1;
+    int mode = (argc > 7) ? atoi(argv[7]) : 0;
+    decode_spi(cap, pin_arg(argv[3]), pin_arg(argv[4]), miso, cs, mode);
+  }
+  else if (!strcmp(proto, "uart") && argc == 5) {
+    // (A baud rate which isn't a number comes back as 0.)
+    uint32_t baud = strtoul(argv[4], NULL, 10);
+    if (!baud) {
+      usage();
+      return 1;
+    }
+    decode_uart(cap, pin_arg(argv[3]), baud);
+  }
+  else {
+    usage();
+    return 1;
+  }
+  return 0;
+}
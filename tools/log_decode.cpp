@@ -0,0 +1,369 @@
+/*
+ * Host-side decoder for binary log messages which were recorded
+ * by the 'pLog' class and sent over a serial link, or written to
+ * a file with semihosting. Build it with 'make tools', then run:
+ *
+ *   log_decode [-c <core_hz>] <firmware.elf> <log.bin>
+ *
+ * The format strings are read from the ELF file's '.log_fmt'
+ * section, and '%s' arguments from its loaded sections, so it
+ * must be the same ELF file that is running on the chip.
+ * Timestamps are printed in core clock cycles since the first
+ * message, or in seconds if the core clock speed is given.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+// Record framing; these match 'log.h'.
+#define LOG_SYNC       (0xA5)
+#define LOG_ID_DROPPED (0)
+
+// ELF section header values.
+#define SHT_NOBITS     (8)
+#define SHF_ALLOC      (0x2)
+
+// Section of the ELF file which is loaded onto the chip.
+struct elf_section {
+  uint32_t addr;
+  uint32_t size;
+  uint32_t offset;
+};
+
+// Format strings and constant data from the ELF file.
+struct elf_info {
+  std::vector<uint8_t> raw;
+  uint32_t fmt_offset;
+  uint32_t fmt_size;
+  std::vector<elf_section> loaded;
+};
+
+static uint32_t get_le(const uint8_t* p, unsigned nbytes) {
+  uint32_t v = 0;
+  for (unsigned i = 0; i < nbytes; ++i) {
+    v |= ((uint32_t)p[i]) << (i * 8);
+  }
+  return v;
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>& raw) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Could not open '%s'.\n", path);
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    raw.insert(raw.end(), chunk, chunk + n);
+  }
+  fclose(f);
+  return true;
+}
+
+/*
+ * Read the section headers of a 32-bit little-endian ELF file,
+ * and find the '.log_fmt' section and the loaded sections.
+ */
+static bool load_elf(const char* path, elf_info& elf) {
+  if (!read_file(path, elf.raw)) { return false; }
+  const std::vector<uint8_t>& raw = elf.raw;
+  if (raw.size() < 52 || memcmp(&raw[0], "\x7F" "ELF", 4) != 0 ||
+      raw[4] != 1 || raw[5] != 1) {
+    fprintf(stderr, "'%s' is not a 32-bit little-endian ELF file.\n",
+            path);
+    return false;
+  }
+  uint32_t shoff     = get_le(&raw[0x20], 4);
+  uint32_t shentsize = get_le(&raw[0x2E], 2);
+  uint32_t shnum     = get_le(&raw[0x30], 2);
+  uint32_t shstrndx  = get_le(&raw[0x32], 2);
+  if (shentsize < 40 || shstrndx >= shnum ||
+      shoff + ((uint64_t)shnum * shentsize) > raw.size()) {
+    fprintf(stderr, "'%s' has no valid section headers.\n", path);
+    return false;
+  }
+  const uint8_t* strtab_hdr = &raw[shoff + (shstrndx * shentsize)];
+  uint32_t strtab = get_le(strtab_hdr + 16, 4);
+  bool found = false;
+  for (uint32_t i = 0; i < shnum; ++i) {
+    const uint8_t* sh = &raw[shoff + (i * shentsize)];
+    uint32_t name   = get_le(sh, 4);
+    uint32_t type   = get_le(sh + 4, 4);
+    uint32_t flags  = get_le(sh + 8, 4);
+    elf_section s;
+    s.addr   = get_le(sh + 12, 4);
+    s.offset = get_le(sh + 16, 4);
+    s.size   = get_le(sh + 20, 4);
+    if (type == SHT_NOBITS || (uint64_t)s.offset + s.size > raw.size()) {
+      continue;
+    }
+    if (strtab + name < raw.size() &&
+        !strcmp((const char*)&raw[strtab + name], ".log_fmt")) {
+      elf.fmt_offset = s.offset;
+      elf.fmt_size   = s.size;
+      found = true;
+    }
+    else if (flags & SHF_ALLOC) {
+      elf.loaded.push_back(s);
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "'%s' has no '.log_fmt' section.\n", path);
+    return false;
+  }
+  return true;
+}
+
+/* Format string for a message ID, or NULL if it is not valid. */
+static const char* get_format(const elf_info& elf, uint32_t id) {
+  // (IDs point to the start of a string, after the previous
+  //  string's terminator.)
+  if (id == LOG_ID_DROPPED || id >= elf.fmt_size) { return NULL; }
+  const uint8_t* fmt = &elf.raw[elf.fmt_offset];
+  if (fmt[id - 1] != 0) { return NULL; }
+  if (!memchr(fmt + id, 0, elf.fmt_size - id)) { return NULL; }
+  return (const char*)(fmt + id);
+}
+
+/* Constant string at a chip address, if it is in the ELF file. */
+static bool get_string(const elf_info& elf, uint32_t addr,
+                       std::string& out) {
+  for (size_t i = 0; i < elf.loaded.size(); ++i) {
+    const elf_section& s = elf.loaded[i];
+    if (addr < s.addr || addr >= s.addr + s.size) { continue; }
+    const char* p = (const char*)&elf.raw[s.offset + (addr - s.addr)];
+    size_t max = s.size - (addr - s.addr);
+    out.assign(p, strnlen(p, max));
+    return true;
+  }
+  return false;
+}
+
+// One conversion in a format string, like '%-08.3lx'.
+struct conversion {
+  std::string spec;
+  char        type;
+  bool        star_width;
+  bool        star_precision;
+};
+
+/*
+ * Parse the conversion which starts at 'fmt' (after the '%').
+ * Length modifiers are dropped, since every argument was sent
+ * as a 32-bit word. Returns the number of characters used.
+ */
+static size_t parse_conversion(const char* fmt, conversion& c) {
+  size_t i = 0;
+  c.spec = "%";
+  c.star_width = false;
+  c.star_precision = false;
+  while (fmt[i] && strchr("-+ #0", fmt[i])) { c.spec += fmt[i++]; }
+  if (fmt[i] == '*') { c.star_width = true; c.spec += fmt[i++]; }
+  while (fmt[i] >= '0' && fmt[i] <= '9') { c.spec += fmt[i++]; }
+  if (fmt[i] == '.') {
+    c.spec += fmt[i++];
+    if (fmt[i] == '*') { c.star_precision = true; c.spec += fmt[i++]; }
+    while (fmt[i] >= '0' && fmt[i] <= '9') { c.spec += fmt[i++]; }
+  }
+  while (fmt[i] && strchr("hljztL", fmt[i])) { ++i; }
+  c.type = fmt[i];
+  if (fmt[i]) { ++i; }
+  return i;
+}
+
+/* Number of argument words which a format string uses. */
+static unsigned count_args(const char* fmt) {
+  unsigned n = 0;
+  for (const char* p = fmt; *p; ++p) {
+    if (*p != '%') { continue; }
+    conversion c;
+    p += parse_conversion(p + 1, c);
+    if (c.type == '%') { continue; }
+    n += 1 + c.star_width + c.star_precision;
+    if (!c.type) { break; }
+  }
+  return n;
+}
+
+/* Format a message with its argument words. */
+static std::string format_message(const elf_info& elf, const char* fmt,
+                                  const uint32_t* args, unsigned nargs) {
+  std::string out;
+  unsigned a = 0;
+  char buf[512];
+  for (const char* p = fmt; *p; ++p) {
+    if (*p != '%') {
+      out += *p;
+      continue;
+    }
+    conversion c;
+    p += parse_conversion(p + 1, c);
+    if (c.type == '%') {
+      out += '%';
+      continue;
+    }
+    if (!c.type) { break; }
+    int width = 0, precision = 0;
+    if (c.star_width && a < nargs)     { width     = (int32_t)args[a++]; }
+    if (c.star_precision && a < nargs) { precision = (int32_t)args[a++]; }
+    if (a >= nargs) {
+      out += "<missing>";
+      continue;
+    }
+    uint32_t v = args[a++];
+    std::string spec = c.spec;
+    int n = -1;
+    // (Star widths are filled in, so 'snprintf' gets a plain value.)
+    if (c.star_width || c.star_precision) {
+      std::string filled;
+      bool first = true;
+      for (size_t i = 0; i < spec.size(); ++i) {
+        if (spec[i] != '*') {
+          filled += spec[i];
+          continue;
+        }
+        bool is_width = first && c.star_width;
+        first = false;
+        snprintf(buf, sizeof(buf), "%d", is_width ? width : precision);
+        filled += buf;
+      }
+      spec = filled;
+    }
+    switch (c.type) {
+      case 'd': case 'i':
+        spec += 'd';
+        n = snprintf(buf, sizeof(buf), spec.c_str(), (int32_t)v);
+        break;
+      case 'u': case 'x': case 'X': case 'o':
+        spec += c.type;
+        n = snprintf(buf, sizeof(buf), spec.c_str(), (unsigned)v);
+        break;
+      case 'c':
+        spec += 'c';
+        n = snprintf(buf, sizeof(buf), spec.c_str(), (int)(v & 0xFF));
+        break;
+      case 'f': case 'F': case 'e': case 'E':
+      case 'g': case 'G': case 'a': case 'A': {
+        float f;
+        memcpy(&f, &v, sizeof(f));
+        spec += c.type;
+        n = snprintf(buf, sizeof(buf), spec.c_str(), (double)f);
+        break;
+      }
+      case 'p':
+        n = snprintf(buf, sizeof(buf), "0x%08x", (unsigned)v);
+        break;
+      case 's': {
+        std::string str;
+        if (!get_string(elf, v, str)) {
+          snprintf(buf, sizeof(buf), "<0x%08x>", (unsigned)v);
+          str = buf;
+        }
+        spec += 's';
+        n = snprintf(buf, sizeof(buf), spec.c_str(), str.c_str());
+        break;
+      }
+      default:
+        n = snprintf(buf, sizeof(buf), "<%%%c?>", c.type);
+        break;
+    }
+    if (n > 0) { out += buf; }
+  }
+  return out;
+}
+
+/*
+ * Find and print every record in the log. A 'LOG_SYNC' byte is
+ * only taken as the start of a record if its header has a valid
+ * message ID and the right number of arguments for its format
+ * string; otherwise the byte is skipped, so that noise or other
+ * serial output between the records is ignored.
+ */
+static void decode_log(const elf_info& elf, const std::vector<uint8_t>& log,
+                       double core_hz) {
+  bool started = false;
+  uint64_t first = 0, last = 0;
+  unsigned records = 0, skipped = 0;
+  size_t pos = 0;
+  while (pos + 9 <= log.size()) {
+    if (log[pos] != LOG_SYNC) {
+      ++pos;
+      ++skipped;
+      continue;
+    }
+    uint32_t header = get_le(&log[pos + 1], 4);
+    uint32_t id     = header >> 4;
+    unsigned nargs  = header & 0xF;
+    size_t   len    = 1 + ((nargs + 2) * 4);
+    const char* fmt = NULL;
+    bool valid;
+    if (id == LOG_ID_DROPPED) { valid = (nargs == 1); }
+    else {
+      fmt = get_format(elf, id);
+      valid = fmt && (count_args(fmt) == nargs);
+    }
+    if (!valid || pos + len > log.size()) {
+      ++pos;
+      ++skipped;
+      continue;
+    }
+    uint32_t stamp = get_le(&log[pos + 5], 4);
+    uint32_t args[15];
+    for (unsigned i = 0; i < nargs; ++i) {
+      args[i] = get_le(&log[pos + 9 + (i * 4)], 4);
+    }
+    pos += len;
+    // Extend the 32-bit cycle counter; it wraps every
+    // 2^32 cycles, so longer gaps can not be measured.
+    uint64_t t;
+    if (!started) {
+      t = first = stamp;
+      started = true;
+    }
+    else {
+      t = (last & ~0xFFFFFFFFULL) | stamp;
+      if (t < last) { t += 0x100000000ULL; }
+    }
+    last = t;
+    if (core_hz > 0) { printf("[%12.6f] ", (double)(t - first) / core_hz); }
+    else             { printf("[%12llu] ", (unsigned long long)(t - first)); }
+    if (id == LOG_ID_DROPPED) {
+      printf("(%u messages dropped)\n", args[0]);
+    }
+    else {
+      printf("%s\n", format_message(elf, fmt, args, nargs).c_str());
+    }
+    ++records;
+  }
+  fprintf(stderr, "%u records decoded, %u bytes skipped.\n",
+          records, skipped);
+}
+
+static void usage(void) {
+  fprintf(stderr,
+    "Usage: log_decode [-c <core_hz>] <firmware.elf> <log.bin>\n");
+}
+
+int main(int argc, char** argv) {
+  double core_hz = 0;
+  int arg = 1;
+  if (argc > 2 && !strcmp(argv[1], "-c")) {
+    core_hz = strtod(argv[2], NULL);
+    arg = 3;
+  }
+  if (argc - arg != 2) {
+    usage();
+    return 1;
+  }
+  elf_info elf;
+  if (!load_elf(argv[arg], elf)) { return 1; }
+  std::vector<uint8_t> log;
+  if (!read_file(argv[arg + 1], log)) { return 1; }
+  decode_log(elf, log, core_hz);
+  return 0;
+}
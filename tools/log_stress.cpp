@@ -0,0 +1,136 @@
+/*
+ * Host-side stress test for the 'pLogRing' record buffer in
+ * 'lib/logring.h', which holds the 'pLOG' messages.
+ * Build it with 'make tools', and run:
+ *
+ *   log_stress [records]
+ *
+ * Several writer threads log records with a mix of argument
+ * counts (so records of different lengths wrap around the end of
+ * the buffer at different offsets) while one reader thread
+ * drains them, like the 'pLog' drain task. When the buffer is
+ * full, a writer waits and tries again. Each record carries its
+ * writer and sequence number, and its length and arguments
+ * follow from them, so the reader checks that every record
+ * arrives once, in order for its writer, and intact. A reader
+ * which reads past the write index, or a stale header which is
+ * taken for a finished record, shows up as errors here, or as
+ * a stall if the buffer's indices are left unusable.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../lib/logring.h"
+
+// A small buffer, the size of the firmware's, so that the
+// indices wrap around often.
+static pLogRing<256> ring;
+
+// Writer threads.
+#define WRITERS  (3)
+// Seconds without a record before the test gives up.
+#define STALL_SECS (2)
+static std::atomic<bool> stalled(false);
+// Argument counts, by sequence number. (Records of 2, 3, 4, 5,
+// 9 and 17 words.)
+static const unsigned arg_counts[] = { 0, 1, 2, 0, 3, 1, 7, 2, 15 };
+#define ARG_COUNTS (sizeof(arg_counts) / sizeof(arg_counts[0]))
+
+static unsigned nargs_for(uint32_t seq) {
+  return arg_counts[seq % ARG_COUNTS];
+}
+static uint32_t arg_for(unsigned writer, uint32_t seq, unsigned i) {
+  return ((seq * 2654435761u) ^ (writer << 24)) + i;
+}
+
+static void writer(unsigned id, uint32_t records) {
+  uint32_t args[15];
+  for (uint32_t seq = 0; seq < records; ++seq) {
+    unsigned nargs = nargs_for(seq);
+    for (unsigned i = 0; i < nargs; ++i) {
+      args[i] = arg_for(id, seq, i);
+    }
+    // (The message ID is never 0, so neither is the header.)
+    while (!ring.write(id + 1, seq, nargs, args)) {
+      if (stalled) { return; }
+      std::this_thread::yield();
+    }
+  }
+}
+
+/*
+ * Returns the number of errors.
+ */
+static uint32_t reader(uint32_t records) {
+  uint32_t expect[WRITERS] = {};
+  uint32_t errors = 0;
+  uint32_t done   = 0;
+  uint32_t rec[17];
+  auto last = std::chrono::steady_clock::now();
+  while (done < (records * WRITERS)) {
+    if (ring.size() > ring.length) { ++errors; }
+    unsigned len = ring.read(rec);
+    if (!len) {
+      // (If the buffer is stuck full, the writers wait forever.)
+      auto now = std::chrono::steady_clock::now();
+      if (now - last > std::chrono::seconds(STALL_SECS)) {
+        stalled = true;
+        return errors + 1;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    last = std::chrono::steady_clock::now();
+    ++done;
+    unsigned id    = (rec[0] >> 4) - 1;
+    unsigned nargs = rec[0] & 0xF;
+    uint32_t seq   = rec[1];
+    if (id >= WRITERS) { ++errors; continue; }
+    if (seq != expect[id] || nargs != nargs_for(seq) ||
+        len != nargs + 2) {
+      ++errors;
+      expect[id] = seq + 1;
+      continue;
+    }
+    for (unsigned i = 0; i < nargs; ++i) {
+      if (rec[2 + i] != arg_for(id, seq, i)) { ++errors; break; }
+    }
+    ++expect[id];
+  }
+  return errors;
+}
+
+int main(int argc, char** argv) {
+  uint32_t records = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000000;
+  if (!records) {
+    fprintf(stderr, "usage: log_stress [records]\n");
+    return 1;
+  }
+  uint32_t errors = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> writers;
+  for (unsigned w = 0; w < WRITERS; ++w) {
+    writers.push_back(std::thread(writer, w, records));
+  }
+  std::thread rd([&]() { errors = reader(records); });
+  for (auto& t : writers) { t.join(); }
+  rd.join();
+  auto end = std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(end - start).count();
+  if (stalled) { printf("Stalled after %u seconds.\n", STALL_SECS); }
+  else if (!ring.empty()) { ++errors; }
+  printf("%u writers, %u records each: %.1f Mrecords/s, %u errors\n",
+         WRITERS, records, ((records * WRITERS) / secs) / 1e6, errors);
+  if (errors) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,402 @@
+/*
+ * Host-side decoder for program counter profiles which were
+ * recorded by the 'pProfiler' class and dumped over a serial
+ * link. Build it with 'make tools', then record the dumps with
+ * something like 'cat /dev/ttyUSB0 > profile.bin' and run:
+ *
+ *   prof_decode [-a <addr2line>] <firmware.elf> <profile.bin> flat
+ *   prof_decode [-a <addr2line>] <firmware.elf> <profile.bin> lines
+ *   prof_decode [-a <addr2line>] <firmware.elf> <profile.bin> callers
+ *
+ * 'flat' prints the share of samples in each function, 'lines'
+ * in each source line, and 'callers' lists the return addresses
+ * which were seen for each function (if the profile recorded
+ * them). Functions come from the ELF file's symbol table; source
+ * lines are looked up with 'arm-none-eabi-addr2line', or the
+ * program given with '-a'. The counts add up between dumps, so
+ * only the last dump in the recording is used.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// Dump format; this matches 'profiler.h'.
+#define PROF_VERSION (1)
+
+// ELF section and symbol values.
+#define SHT_SYMTAB   (2)
+#define STT_FUNC     (2)
+
+// One function from the symbol table.
+struct function {
+  uint32_t    addr;
+  uint32_t    size;
+  std::string name;
+  bool operator<(const function& o) const { return addr < o.addr; }
+};
+
+// One table entry from the dump.
+struct sample {
+  uint32_t pc;
+  uint32_t lr;
+  uint32_t count;
+};
+
+// The last dump in a recording.
+struct profile {
+  uint32_t rate;
+  uint32_t total;
+  uint32_t dropped;
+  std::vector<sample> samples;
+};
+
+static uint32_t get_le(const uint8_t* p, unsigned nbytes) {
+  uint32_t v = 0;
+  for (unsigned i = 0; i < nbytes; ++i) {
+    v |= ((uint32_t)p[i]) << (i * 8);
+  }
+  return v;
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>& raw) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Could not open '%s'.\n", path);
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    raw.insert(raw.end(), chunk, chunk + n);
+  }
+  fclose(f);
+  return true;
+}
+
+static std::string demangle(const char* name) {
+  int status = 0;
+  char* d = abi::__cxa_demangle(name, NULL, NULL, &status);
+  if (!d) { return name; }
+  std::string out(d);
+  free(d);
+  return out;
+}
+
+/*
+ * Read the function symbols of a 32-bit little-endian ELF file.
+ * (Thumb function addresses have their low bit set.)
+ */
+static bool load_functions(const char* path, std::vector<function>& funcs) {
+  std::vector<uint8_t> raw;
+  if (!read_file(path, raw)) { return false; }
+  if (raw.size() < 52 || memcmp(&raw[0], "\x7F" "ELF", 4) != 0 ||
+      raw[4] != 1 || raw[5] != 1) {
+    fprintf(stderr, "'%s' is not a 32-bit little-endian ELF file.\n",
+            path);
+    return false;
+  }
+  uint32_t shoff     = get_le(&raw[0x20], 4);
+  uint32_t shentsize = get_le(&raw[0x2E], 2);
+  uint32_t shnum     = get_le(&raw[0x30], 2);
+  if (shentsize < 40 ||
+      shoff + ((uint64_t)shnum * shentsize) > raw.size()) {
+    fprintf(stderr, "'%s' has no valid section headers.\n", path);
+    return false;
+  }
+  for (uint32_t i = 0; i < shnum; ++i) {
+    const uint8_t* sh = &raw[shoff + (i * shentsize)];
+    if (get_le(sh + 4, 4) != SHT_SYMTAB) { continue; }
+    uint32_t offset = get_le(sh + 16, 4);
+    uint32_t size   = get_le(sh + 20, 4);
+    uint32_t link   = get_le(sh + 24, 4);
+    if (link >= shnum || (uint64_t)offset + size > raw.size()) { continue; }
+    const uint8_t* strsh = &raw[shoff + (link * shentsize)];
+    uint32_t stroff  = get_le(strsh + 16, 4);
+    uint32_t strsize = get_le(strsh + 20, 4);
+    if ((uint64_t)stroff + strsize > raw.size()) { continue; }
+    for (uint32_t s = 0; s + 16 <= size; s += 16) {
+      const uint8_t* sym = &raw[offset + s];
+      uint32_t name  = get_le(sym, 4);
+      uint32_t value = get_le(sym + 4, 4);
+      uint32_t ssize = get_le(sym + 8, 4);
+      if ((sym[12] & 0xF) != STT_FUNC || !ssize || name >= strsize) {
+        continue;
+      }
+      function f;
+      f.addr = value & ~1UL;
+      f.size = ssize;
+      f.name = demangle((const char*)&raw[stroff + name]);
+      funcs.push_back(f);
+    }
+  }
+  if (funcs.empty()) {
+    fprintf(stderr, "'%s' has no function symbols.\n", path);
+    return false;
+  }
+  std::sort(funcs.begin(), funcs.end());
+  return true;
+}
+
+/* Name of the function which contains an address. */
+static std::string function_at(const std::vector<function>& funcs,
+                               uint32_t addr) {
+  function key;
+  key.addr = addr;
+  std::vector<function>::const_iterator it =
+    std::upper_bound(funcs.begin(), funcs.end(), key);
+  if (it != funcs.begin()) {
+    --it;
+    if (addr < it->addr + it->size) { return it->name; }
+  }
+  char buf[16];
+  snprintf(buf, sizeof(buf), "[0x%08x]", addr);
+  return buf;
+}
+
+/*
+ * Read the last dump in a recording. The 'PROF' header is
+ * searched for, since a serial recording may have other data
+ * around it.
+ */
+static bool load_profile(const char* path, profile& prof) {
+  std::vector<uint8_t> raw;
+  if (!read_file(path, raw)) { return false; }
+  bool found = false;
+  unsigned dumps = 0;
+  size_t pos = 0;
+  while (pos + 19 <= raw.size()) {
+    const uint8_t* p = &raw[pos];
+    if (memcmp(p, "PROF", 4) != 0 || p[4] != PROF_VERSION) {
+      ++pos;
+      continue;
+    }
+    profile d;
+    d.rate    = get_le(p + 5, 4);
+    d.total   = get_le(p + 9, 4);
+    d.dropped = get_le(p + 13, 4);
+    unsigned entries = get_le(p + 17, 2);
+    if (pos + 19 + (entries * 12) > raw.size() || d.dropped > d.total) {
+      ++pos;
+      continue;
+    }
+    for (unsigned i = 0; i < entries; ++i) {
+      const uint8_t* e = p + 19 + (i * 12);
+      sample s;
+      s.pc    = get_le(e, 4);
+      s.lr    = get_le(e + 4, 4);
+      s.count = get_le(e + 8, 4);
+      d.samples.push_back(s);
+    }
+    prof = d;
+    found = true;
+    ++dumps;
+    pos += 19 + (entries * 12);
+  }
+  if (!found) {
+    fprintf(stderr, "No profile dumps found in '%s'.\n", path);
+    return false;
+  }
+  printf("Profile: %u samples", prof.total);
+  if (prof.rate) {
+    printf(" at %u Hz (%.1f s)", prof.rate, (double)prof.total / prof.rate);
+  }
+  printf(", %u dropped; last of %u dumps.\n\n", prof.dropped, dumps);
+  return true;
+}
+
+/*
+ * Look up source lines with addr2line, a batch of addresses at
+ * a time. Addresses which can not be found are left out.
+ */
+static void lookup_lines(const char* addr2line, const char* elf,
+                         const std::vector<uint32_t>& addrs,
+                         std::map<uint32_t, std::string>& lines) {
+  const size_t batch = 64;
+  for (size_t i = 0; i < addrs.size(); i += batch) {
+    std::string cmd = std::string(addr2line) + " -e '" + elf + "'";
+    size_t end = std::min(addrs.size(), i + batch);
+    for (size_t j = i; j < end; ++j) {
+      char a[16];
+      snprintf(a, sizeof(a), " 0x%x", addrs[j]);
+      cmd += a;
+    }
+    cmd += " 2>/dev/null";
+    FILE* p = popen(cmd.c_str(), "r");
+    if (!p) { return; }
+    char buf[1024];
+    size_t j = i;
+    while (j < end && fgets(buf, sizeof(buf), p)) {
+      buf[strcspn(buf, "\r\n")] = 0;
+      // (Unknown addresses come back as '??:0' or '??:?'.)
+      if (strncmp(buf, "??", 2) != 0) {
+        // Shorten the path to the file's name.
+        const char* name = strrchr(buf, '/');
+        lines[addrs[j]] = name ? (name + 1) : buf;
+      }
+      ++j;
+    }
+    if (pclose(p) != 0 && j == i) {
+      fprintf(stderr, "Could not run '%s'; use '-a' to set its path.\n",
+              addr2line);
+      return;
+    }
+  }
+}
+
+// A row of the output, and its sample count.
+typedef std::pair<uint32_t, std::string> row;
+static bool by_count(const row& a, const row& b) {
+  if (a.first != b.first) { return a.first > b.first; }
+  return a.second < b.second;
+}
+
+static void print_rows(std::vector<row>& rows, uint32_t total,
+                       const char* heading) {
+  std::sort(rows.begin(), rows.end(), by_count);
+  printf("  %%time  cumul%%  samples  %s\n", heading);
+  uint32_t cumul = 0;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    cumul += rows[i].first;
+    printf(" %6.2f  %6.2f  %7u  %s\n",
+           total ? (100.0 * rows[i].first / total) : 0,
+           total ? (100.0 * cumul / total) : 0,
+           rows[i].first, rows[i].second.c_str());
+  }
+}
+
+static void decode_flat(const profile& prof,
+                        const std::vector<function>& funcs) {
+  std::map<std::string, uint32_t> counts;
+  for (size_t i = 0; i < prof.samples.size(); ++i) {
+    counts[function_at(funcs, prof.samples[i].pc)] += prof.samples[i].count;
+  }
+  std::vector<row> rows;
+  for (std::map<std::string, uint32_t>::iterator it = counts.begin();
+       it != counts.end(); ++it) {
+    rows.push_back(row(it->second, it->first));
+  }
+  print_rows(rows, prof.total, "function");
+}
+
+static void decode_lines(const profile& prof,
+                         const std::vector<function>& funcs,
+                         const char* addr2line, const char* elf) {
+  std::map<uint32_t, uint32_t> by_pc;
+  for (size_t i = 0; i < prof.samples.size(); ++i) {
+    by_pc[prof.samples[i].pc] += prof.samples[i].count;
+  }
+  std::vector<uint32_t> addrs;
+  for (std::map<uint32_t, uint32_t>::iterator it = by_pc.begin();
+       it != by_pc.end(); ++it) {
+    addrs.push_back(it->first);
+  }
+  std::map<uint32_t, std::string> lines;
+  lookup_lines(addr2line, elf, addrs, lines);
+  // (Several addresses can be on one line.)
+  std::map<std::string, uint32_t> counts;
+  for (std::map<uint32_t, uint32_t>::iterator it = by_pc.begin();
+       it != by_pc.end(); ++it) {
+    std::string where = lines.count(it->first) ? lines[it->first] : "?";
+    counts[where + "  " + function_at(funcs, it->first)] += it->second;
+  }
+  std::vector<row> rows;
+  for (std::map<std::string, uint32_t>::iterator it = counts.begin();
+       it != counts.end(); ++it) {
+    rows.push_back(row(it->second, it->first));
+  }
+  print_rows(rows, prof.total, "line  function");
+}
+
+/*
+ * List each function's callers, from the stacked link register.
+ * The link register only holds the return address until a
+ * function calls something else, so this is most accurate for
+ * small leaf functions, like pixel and register helpers.
+ */
+static void decode_callers(const profile& prof,
+                           const std::vector<function>& funcs) {
+  std::map<std::string, std::map<std::string, uint32_t> > callers;
+  std::map<std::string, uint32_t> totals;
+  bool any_lr = false;
+  for (size_t i = 0; i < prof.samples.size(); ++i) {
+    const sample& s = prof.samples[i];
+    std::string f = function_at(funcs, s.pc);
+    totals[f] += s.count;
+    if (!s.lr) { continue; }
+    any_lr = true;
+    // (Return addresses in exception frames are EXC_RETURN values.)
+    std::string c = ((s.lr & 0xFFFFFFF0) == 0xFFFFFFF0) ?
+                    "<exception return>" :
+                    function_at(funcs, (s.lr & ~1UL) - 2);
+    if (c == f) { c = "<itself>"; }
+    callers[f][c] += s.count;
+  }
+  if (!any_lr) {
+    printf("The profile has no return addresses; "
+           "record it with 'with_lr' set.\n");
+    return;
+  }
+  std::vector<row> rows;
+  for (std::map<std::string, uint32_t>::iterator it = totals.begin();
+       it != totals.end(); ++it) {
+    rows.push_back(row(it->second, it->first));
+  }
+  std::sort(rows.begin(), rows.end(), by_count);
+  for (size_t i = 0; i < rows.size(); ++i) {
+    printf("%6.2f%%  %s\n",
+           prof.total ? (100.0 * rows[i].first / prof.total) : 0,
+           rows[i].second.c_str());
+    std::vector<row> c;
+    std::map<std::string, uint32_t>& m = callers[rows[i].second];
+    for (std::map<std::string, uint32_t>::iterator it = m.begin();
+         it != m.end(); ++it) {
+      c.push_back(row(it->second, it->first));
+    }
+    std::sort(c.begin(), c.end(), by_count);
+    for (size_t j = 0; j < c.size(); ++j) {
+      printf("          %7u  from %s\n", c[j].first, c[j].second.c_str());
+    }
+  }
+}
+
+static void usage(void) {
+  fprintf(stderr,
+    "Usage: prof_decode [-a <addr2line>] <firmware.elf> <profile.bin> "
+    "flat|lines|callers\n");
+}
+
+int main(int argc, char** argv) {
+  const char* addr2line = "arm-none-eabi-addr2line";
+  int arg = 1;
+  if (argc > 2 && !strcmp(argv[1], "-a")) {
+    addr2line = argv[2];
+    arg = 3;
+  }
+  if (argc - arg != 3) {
+    usage();
+    return 1;
+  }
+  const char* elf  = argv[arg];
+  const char* mode = argv[arg + 2];
+  if (strcmp(mode, "flat") && strcmp(mode, "lines") &&
+      strcmp(mode, "callers")) {
+    usage();
+    return 1;
+  }
+  std::vector<function> funcs;
+  if (!load_functions(elf, funcs)) { return 1; }
+  profile prof;
+  if (!load_profile(argv[arg + 1], prof)) { return 1; }
+  if (!strcmp(mode, "flat"))       { decode_flat(prof, funcs); }
+  else if (!strcmp(mode, "lines")) { decode_lines(prof, funcs, addr2line, elf); }
+  else                             { decode_callers(prof, funcs); }
+  return 0;
+}
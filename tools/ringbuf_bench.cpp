@@ -0,0 +1,131 @@
+/*
+ * Host-side stress test and throughput benchmark for the
+ * 'pRingBuffer' template in 'lib/ringbuf.h'.
+ * Build it with 'make tools', and run:
+ *
+ *   ringbuf_bench [items]
+ *
+ * A producer thread and a consumer thread move a counting
+ * sequence through a small buffer, using each combination of
+ * single-item, bulk copy, and zero-copy span access. The consumer
+ * checks that every value arrives once and in order, so a missing
+ * barrier or an off-by-one in the wrap-around logic shows up as a
+ * sequence error. Throughput is printed in millions of items per
+ * second; it is only a rough guide to the relative costs, since
+ * the Cortex-M cores run the same code on one CPU.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <thread>
+
+#include "../lib/ringbuf.h"
+
+// A small buffer, so that the indices wrap around often.
+static pRingBuffer<uint32_t, 256> ring;
+
+// Access modes.
+enum mode { MODE_SINGLE, MODE_BULK, MODE_SPAN };
+static const char* mode_names[] = { "single", "bulk", "span" };
+// Items per bulk / span transfer. (Not a power of two, so that
+// transfers are split across the end of the buffer.)
+#define BULK_LEN (37)
+
+static void producer(mode m, uint32_t items) {
+  uint32_t next = 0;
+  uint32_t chunk[BULK_LEN];
+  while (next < items) {
+    // (Let the consumer run if the buffer is full, in case
+    // both threads share one CPU.)
+    if (ring.full()) { std::this_thread::yield(); continue; }
+    if (m == MODE_SINGLE) {
+      if (ring.push(next)) { ++next; }
+    }
+    else if (m == MODE_BULK) {
+      unsigned n = BULK_LEN;
+      if (n > items - next) { n = items - next; }
+      for (unsigned i = 0; i < n; ++i) { chunk[i] = next + i; }
+      next += ring.write(chunk, n);
+    }
+    else {
+      unsigned n;
+      uint32_t* span = ring.write_span(n);
+      if (n > items - next) { n = items - next; }
+      if (n > BULK_LEN)     { n = BULK_LEN; }
+      for (unsigned i = 0; i < n; ++i) { span[i] = next + i; }
+      ring.write_commit(n);
+      next += n;
+    }
+  }
+}
+
+/*
+ * Returns the number of sequence errors.
+ */
+static uint32_t consumer(mode m, uint32_t items) {
+  uint32_t expect = 0;
+  uint32_t errors = 0;
+  uint32_t chunk[BULK_LEN];
+  while (expect < items) {
+    if (ring.empty()) { std::this_thread::yield(); continue; }
+    if (m == MODE_SINGLE) {
+      uint32_t v;
+      if (ring.pop(v)) {
+        if (v != expect) { ++errors; expect = v; }
+        ++expect;
+      }
+    }
+    else if (m == MODE_BULK) {
+      unsigned n = ring.read(chunk, BULK_LEN);
+      for (unsigned i = 0; i < n; ++i) {
+        if (chunk[i] != expect) { ++errors; expect = chunk[i]; }
+        ++expect;
+      }
+    }
+    else {
+      unsigned n;
+      const uint32_t* span = ring.read_span(n);
+      for (unsigned i = 0; i < n; ++i) {
+        if (span[i] != expect) { ++errors; expect = span[i]; }
+        ++expect;
+      }
+      ring.read_commit(n);
+    }
+  }
+  return errors;
+}
+
+int main(int argc, char** argv) {
+  uint32_t items = (argc > 1) ? strtoul(argv[1], NULL, 10) : 20000000;
+  if (!items) {
+    fprintf(stderr, "usage: ringbuf_bench [items]\n");
+    return 1;
+  }
+  uint32_t total_errors = 0;
+  printf("%-8s %-8s %10s %8s\n", "write", "read", "Mitems/s", "errors");
+  for (int w = MODE_SINGLE; w <= MODE_SPAN; ++w) {
+    for (int r = MODE_SINGLE; r <= MODE_SPAN; ++r) {
+      ring.flush();
+      uint32_t errors = 0;
+      auto start = std::chrono::steady_clock::now();
+      std::thread prod(producer, (mode)w, items);
+      std::thread cons([&]() { errors = consumer((mode)r, items); });
+      prod.join();
+      cons.join();
+      auto end = std::chrono::steady_clock::now();
+      double secs = std::chrono::duration<double>(end - start).count();
+      if (!ring.empty()) { ++errors; }
+      printf("%-8s %-8s %10.1f %8u\n", mode_names[w], mode_names[r],
+             (items / secs) / 1e6, errors);
+      total_errors += errors;
+    }
+  }
+  if (total_errors) {
+    printf("FAILED: %u sequence errors.\n", total_errors);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
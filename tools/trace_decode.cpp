@@ -0,0 +1,604 @@
+/*
+ * Host-side analyzer for task and interrupt traces which were
+ * recorded by the 'pTrace' class and dumped over a serial link.
+ * Build it with 'make tools', then record the dumps with
+ * something like 'cat /dev/ttyUSB0 > trace.bin' and run:
+ *
+ *   trace_decode <firmware.elf> <trace.bin> summary
+ *   trace_decode <firmware.elf> <trace.bin> timeline
+ *   trace_decode <firmware.elf> <trace.bin> gantt [columns]
+ *
+ * 'summary' prints each task's CPU time, run slices and the
+ * latency from becoming ready to running, each interrupt's and
+ * span's duration, with histograms. 'timeline' lists every
+ * event, and 'gantt' draws a chart of what was running. Span
+ * labels are read from the ELF file's '.log_fmt' section, so it
+ * must be the same ELF file that is running on the chip. Times
+ * are printed in microseconds.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// Event types; these match 'FreeRTOSConfig.h'.
+enum {
+  EV_TASK_IN = 1,
+  EV_TASK_OUT,
+  EV_TASK_READY,
+  EV_TASK_DELAY,
+  EV_TASK_NOTIFY,
+  EV_TASK_NOTIFY_WAIT,
+  EV_QUEUE_SEND,
+  EV_QUEUE_RECEIVE,
+  EV_QUEUE_BLOCK,
+  EV_ISR_ENTER,
+  EV_ISR_EXIT,
+  EV_SPAN_BEGIN,
+  EV_SPAN_END
+};
+// Dump format; this matches 'trace.h'.
+#define TRACE_VERSION (1)
+#define TASK_NAME_LEN (16)
+
+// ELF section header values.
+#define SHT_NOBITS    (8)
+
+// One event, with its time extended to 64 bits.
+struct event {
+  uint64_t time;
+  unsigned type;
+  uint32_t arg;
+};
+
+// One dump of the trace buffer.
+struct dump {
+  uint32_t core_hz;
+  uint32_t total;
+  std::map<uint32_t, std::string> tasks;
+  std::vector<event> events;
+};
+
+// Span labels from the ELF file.
+struct label_table {
+  std::vector<uint8_t> data;
+};
+
+static uint32_t get_le(const uint8_t* p, unsigned nbytes) {
+  uint32_t v = 0;
+  for (unsigned i = 0; i < nbytes; ++i) {
+    v |= ((uint32_t)p[i]) << (i * 8);
+  }
+  return v;
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>& raw) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Could not open '%s'.\n", path);
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    raw.insert(raw.end(), chunk, chunk + n);
+  }
+  fclose(f);
+  return true;
+}
+
+/*
+ * Read the '.log_fmt' section of a 32-bit little-endian ELF file.
+ */
+static bool load_labels(const char* path, label_table& labels) {
+  std::vector<uint8_t> raw;
+  if (!read_file(path, raw)) { return false; }
+  if (raw.size() < 52 || memcmp(&raw[0], "\x7F" "ELF", 4) != 0 ||
+      raw[4] != 1 || raw[5] != 1) {
+    fprintf(stderr, "'%s' is not a 32-bit little-endian ELF file.\n",
+            path);
+    return false;
+  }
+  uint32_t shoff     = get_le(&raw[0x20], 4);
+  uint32_t shentsize = get_le(&raw[0x2E], 2);
+  uint32_t shnum     = get_le(&raw[0x30], 2);
+  uint32_t shstrndx  = get_le(&raw[0x32], 2);
+  if (shentsize < 40 || shstrndx >= shnum ||
+      shoff + ((uint64_t)shnum * shentsize) > raw.size()) {
+    fprintf(stderr, "'%s' has no valid section headers.\n", path);
+    return false;
+  }
+  uint32_t strtab = get_le(&raw[shoff + (shstrndx * shentsize) + 16], 4);
+  for (uint32_t i = 0; i < shnum; ++i) {
+    const uint8_t* sh = &raw[shoff + (i * shentsize)];
+    uint32_t name   = get_le(sh, 4);
+    uint32_t type   = get_le(sh + 4, 4);
+    uint32_t offset = get_le(sh + 16, 4);
+    uint32_t size   = get_le(sh + 20, 4);
+    if (type == SHT_NOBITS || (uint64_t)offset + size > raw.size() ||
+        strtab + name >= raw.size()) {
+      continue;
+    }
+    if (!strcmp((const char*)&raw[strtab + name], ".log_fmt")) {
+      labels.data.assign(raw.begin() + offset,
+                         raw.begin() + offset + size);
+      return true;
+    }
+  }
+  // (Traces without spans can still be read.)
+  fprintf(stderr, "'%s' has no '.log_fmt' section.\n", path);
+  return true;
+}
+
+static std::string label_name(const label_table& labels, uint32_t id) {
+  const std::vector<uint8_t>& d = labels.data;
+  if (id > 0 && id < d.size() && d[id - 1] == 0 &&
+      memchr(&d[id], 0, d.size() - id)) {
+    return std::string((const char*)&d[id]);
+  }
+  char buf[16];
+  snprintf(buf, sizeof(buf), "span 0x%x", id);
+  return buf;
+}
+
+/*
+ * Read every dump in a recording. The 'TRCE' header is searched
+ * for, since a serial recording may have other data around it.
+ */
+static bool load_dumps(const char* path, std::vector<dump>& dumps) {
+  std::vector<uint8_t> raw;
+  if (!read_file(path, raw)) { return false; }
+  size_t pos = 0;
+  while (pos + 10 <= raw.size()) {
+    const uint8_t* p = &raw[pos];
+    if (memcmp(p, "TRCE", 4) != 0 || p[4] != TRACE_VERSION) {
+      ++pos;
+      continue;
+    }
+    dump d;
+    d.core_hz = get_le(p + 5, 4);
+    unsigned ntasks = p[9];
+    size_t at = pos + 10;
+    if (at + (ntasks * (1 + TASK_NAME_LEN)) + 8 > raw.size()) { break; }
+    for (unsigned i = 0; i < ntasks; ++i) {
+      const char* name = (const char*)&raw[at + 1];
+      d.tasks[raw[at]] = std::string(name, strnlen(name, TASK_NAME_LEN));
+      at += 1 + TASK_NAME_LEN;
+    }
+    d.total = get_le(&raw[at], 4);
+    uint32_t count = get_le(&raw[at + 4], 4);
+    at += 8;
+    if (!d.core_hz || count > d.total ||
+        at + ((size_t)count * 8) > raw.size()) {
+      ++pos;
+      continue;
+    }
+    // Extend the 32-bit cycle counter; events are in order, and
+    // gaps of 2^32 cycles or more can not be measured.
+    uint64_t last = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t stamp = get_le(&raw[at + (i * 8)], 4);
+      uint32_t word  = get_le(&raw[at + (i * 8) + 4], 4);
+      uint64_t t = (last & ~0xFFFFFFFFULL) | stamp;
+      if (i == 0)        { t = stamp; }
+      else if (t < last) { t += 0x100000000ULL; }
+      last = t;
+      event e;
+      e.time = t;
+      e.type = word >> 28;
+      e.arg  = word & 0x0FFFFFFF;
+      d.events.push_back(e);
+    }
+    dumps.push_back(d);
+    pos = at + ((size_t)count * 8);
+  }
+  if (dumps.empty()) {
+    fprintf(stderr, "No trace dumps found in '%s'.\n", path);
+    return false;
+  }
+  return true;
+}
+
+static std::string task_name(const dump& d, uint32_t num) {
+  std::map<uint32_t, std::string>::const_iterator it = d.tasks.find(num);
+  if (it != d.tasks.end()) { return it->second; }
+  char buf[16];
+  snprintf(buf, sizeof(buf), "task %u", num);
+  return buf;
+}
+
+/* Name of an exception number, for the interrupts this project uses. */
+static std::string isr_name(uint32_t num) {
+  switch (num) {
+    case 11: return "SVCall";
+    case 14: return "PendSV";
+    case 15: return "SysTick";
+    case 16 + 3:  return "RTC_WKUP";
+    case 16 + 6:  return "EXTI0";
+    case 16 + 7:  return "EXTI1";
+    case 16 + 8:  return "EXTI2";
+    case 16 + 9:  return "EXTI3";
+    case 16 + 10: return "EXTI4";
+    case 16 + 12: return "DMA1_CH2";
+    case 16 + 13: return "DMA1_CH3";
+    case 16 + 23: return "EXTI9_5";
+    case 16 + 31: return "I2C1_EV";
+    case 16 + 37: return "USART1";
+    case 16 + 38: return "USART2";
+    case 16 + 40: return "EXTI15_10";
+    case 16 + 41: return "RTC_ALARM";
+  }
+  char buf[16];
+  if (num >= 16) { snprintf(buf, sizeof(buf), "IRQ %u", num - 16); }
+  else           { snprintf(buf, sizeof(buf), "exception %u", num); }
+  return buf;
+}
+
+/*
+ * Durations, in microseconds, with a power-of-two histogram.
+ */
+struct histogram {
+  std::vector<double> us;
+  void add(double v) { us.push_back(v); }
+  void print(const char* indent) const {
+    if (us.empty()) { return; }
+    std::vector<double> s = us;
+    std::sort(s.begin(), s.end());
+    double sum = 0;
+    for (size_t i = 0; i < s.size(); ++i) { sum += s[i]; }
+    printf("%scount %zu, min %.1f, median %.1f, mean %.1f, max %.1f us\n",
+           indent, s.size(), s[0], s[s.size() / 2], sum / s.size(),
+           s[s.size() - 1]);
+    // Bucket 'b' holds [2^(b-1), 2^b) microseconds; bucket 0 is < 1us.
+    std::vector<size_t> buckets;
+    for (size_t i = 0; i < s.size(); ++i) {
+      size_t b = 0;
+      while (b < 40 && s[i] >= (double)(1ULL << b)) { ++b; }
+      if (b >= buckets.size()) { buckets.resize(b + 1, 0); }
+      ++buckets[b];
+    }
+    size_t peak = *std::max_element(buckets.begin(), buckets.end());
+    size_t first = 0;
+    while (!buckets[first]) { ++first; }
+    for (size_t b = first; b < buckets.size(); ++b) {
+      char range[48];
+      if (b == 0) { snprintf(range, sizeof(range), "< 1"); }
+      else {
+        snprintf(range, sizeof(range), "%llu-%llu",
+                 (unsigned long long)(1ULL << (b - 1)),
+                 (unsigned long long)(1ULL << b));
+      }
+      int bar = (int)((buckets[b] * 40 + peak - 1) / peak);
+      printf("%s%12s us |%-40s %zu\n", indent, range,
+             std::string(bar, '#').c_str(), buckets[b]);
+    }
+  }
+};
+
+// Statistics for one task.
+struct task_stats {
+  double    run_us;
+  unsigned  switches;
+  unsigned  notified;
+  unsigned  delays;
+  histogram slices;
+  histogram latency;
+  task_stats() : run_us(0), switches(0), notified(0), delays(0) {}
+};
+
+/*
+ * Walks through a dump's events, keeping track of what is running.
+ * Run slices do not include the interrupts which preempted them.
+ */
+struct tracker {
+  const dump&        d;
+  const label_table& labels;
+  // Currently running task, and when it was switched in.
+  uint32_t running;
+  bool     in_slice;
+  uint64_t slice_start;
+  double   slice_isr_us;
+  // Start of the slice, interrupt or span which the last
+  // event ended.
+  uint64_t ended_from;
+  // Active interrupts: exception number and start time.
+  std::vector<std::pair<uint32_t, uint64_t> > isrs;
+  // When each task became ready.
+  std::map<uint32_t, uint64_t> ready_at;
+  // Open spans, by name.
+  std::map<std::string, std::vector<uint64_t> > spans;
+
+  tracker(const dump& dd, const label_table& l)
+    : d(dd), labels(l), running(0), in_slice(false), slice_start(0),
+      slice_isr_us(0), ended_from(0) {}
+
+  double us(uint64_t cycles) const {
+    return (cycles * 1e6) / d.core_hz;
+  }
+
+  // What is executing: the innermost interrupt, or the task.
+  std::string context(void) const {
+    if (!isrs.empty()) { return isr_name(isrs.back().first); }
+    if (running)       { return task_name(d, running); }
+    return "-";
+  }
+
+  /*
+   * Apply one event. 'duration' is set to the length of the slice,
+   * interrupt or span which it ends, or -1.
+   */
+  void apply(const event& e, double& duration,
+             std::map<uint32_t, task_stats>* tasks,
+             std::map<uint32_t, histogram>* isr_hist,
+             std::map<std::string, histogram>* span_hist) {
+    duration = -1;
+    switch (e.type) {
+      case EV_TASK_IN:
+        running = e.arg;
+        in_slice = true;
+        slice_start = e.time;
+        slice_isr_us = 0;
+        if (tasks) { ++(*tasks)[e.arg].switches; }
+        if (ready_at.count(e.arg)) {
+          if (tasks) {
+            (*tasks)[e.arg].latency.add(us(e.time - ready_at[e.arg]));
+          }
+          ready_at.erase(e.arg);
+        }
+        break;
+      case EV_TASK_OUT:
+        if (running == e.arg && in_slice) {
+          duration = us(e.time - slice_start) - slice_isr_us;
+          ended_from = slice_start;
+          if (tasks) {
+            (*tasks)[e.arg].run_us += duration;
+            (*tasks)[e.arg].slices.add(duration);
+          }
+        }
+        running = 0;
+        in_slice = false;
+        break;
+      case EV_TASK_READY:
+        // (Only the first time that it became ready counts.)
+        if (e.arg != running && !ready_at.count(e.arg)) {
+          ready_at[e.arg] = e.time;
+        }
+        break;
+      case EV_TASK_DELAY:
+        if (tasks) { ++(*tasks)[e.arg].delays; }
+        break;
+      case EV_TASK_NOTIFY:
+        if (tasks) { ++(*tasks)[e.arg].notified; }
+        break;
+      case EV_ISR_ENTER:
+        isrs.push_back(std::make_pair(e.arg, e.time));
+        break;
+      case EV_ISR_EXIT:
+        for (size_t i = isrs.size(); i > 0; --i) {
+          if (isrs[i - 1].first != e.arg) { continue; }
+          duration = us(e.time - isrs[i - 1].second);
+          ended_from = isrs[i - 1].second;
+          if (i == 1) { slice_isr_us += duration; }
+          isrs.resize(i - 1);
+          if (isr_hist) { (*isr_hist)[e.arg].add(duration); }
+          break;
+        }
+        break;
+      case EV_SPAN_BEGIN:
+        spans[label_name(labels, e.arg)].push_back(e.time);
+        break;
+      case EV_SPAN_END: {
+        std::vector<uint64_t>& open = spans[label_name(labels, e.arg)];
+        if (open.empty()) { break; }
+        duration = us(e.time - open.back());
+        ended_from = open.back();
+        open.pop_back();
+        if (span_hist) {
+          (*span_hist)[label_name(labels, e.arg)].add(duration);
+        }
+        break;
+      }
+    }
+  }
+};
+
+static void decode_summary(const std::vector<dump>& dumps,
+                           const label_table& labels) {
+  std::map<uint32_t, task_stats> tasks;
+  std::map<uint32_t, histogram>  isrs;
+  std::map<std::string, histogram> spans;
+  std::map<uint32_t, std::string> names;
+  double traced_us = 0;
+  uint64_t lost = 0;
+  for (size_t i = 0; i < dumps.size(); ++i) {
+    const dump& d = dumps[i];
+    tracker t(d, labels);
+    for (size_t j = 0; j < d.events.size(); ++j) {
+      double duration;
+      t.apply(d.events[j], duration, &tasks, &isrs, &spans);
+    }
+    if (d.events.size() > 1) {
+      traced_us += t.us(d.events.back().time - d.events[0].time);
+    }
+    lost += d.total - d.events.size();
+    for (std::map<uint32_t, std::string>::const_iterator it =
+         d.tasks.begin(); it != d.tasks.end(); ++it) {
+      names[it->first] = it->second;
+    }
+  }
+  printf("%zu dumps, %.1f ms traced", dumps.size(), traced_us / 1000);
+  if (lost) { printf(", %llu events overwritten", (unsigned long long)lost); }
+  printf("\n\nTasks:\n");
+  for (std::map<uint32_t, task_stats>::iterator it = tasks.begin();
+       it != tasks.end(); ++it) {
+    const task_stats& s = it->second;
+    std::string name = names.count(it->first) ?
+                       names[it->first] : "?";
+    printf("  %-16s CPU %5.1f%%, %u switches, %u notified, %u delays\n",
+           name.c_str(), traced_us ? (100 * s.run_us / traced_us) : 0,
+           s.switches, s.notified, s.delays);
+    if (!s.slices.us.empty()) {
+      printf("    Run slices:\n");
+      s.slices.print("      ");
+    }
+    if (!s.latency.us.empty()) {
+      printf("    Ready to running:\n");
+      s.latency.print("      ");
+    }
+  }
+  if (!isrs.empty()) { printf("\nInterrupts:\n"); }
+  for (std::map<uint32_t, histogram>::iterator it = isrs.begin();
+       it != isrs.end(); ++it) {
+    printf("  %s\n", isr_name(it->first).c_str());
+    it->second.print("    ");
+  }
+  if (!spans.empty()) { printf("\nSpans:\n"); }
+  for (std::map<std::string, histogram>::iterator it = spans.begin();
+       it != spans.end(); ++it) {
+    printf("  %s\n", it->first.c_str());
+    it->second.print("    ");
+  }
+}
+
+static void decode_timeline(const std::vector<dump>& dumps,
+                            const label_table& labels) {
+  for (size_t i = 0; i < dumps.size(); ++i) {
+    const dump& d = dumps[i];
+    printf("Dump %zu: %zu events at %u Hz", i + 1, d.events.size(),
+           d.core_hz);
+    if (d.total > d.events.size()) {
+      printf(" (%u overwritten)", (unsigned)(d.total - d.events.size()));
+    }
+    printf("\n");
+    tracker t(d, labels);
+    for (size_t j = 0; j < d.events.size(); ++j) {
+      const event& e = d.events[j];
+      // (The context is what was running when the event happened.)
+      std::string ctx = t.context();
+      double duration;
+      t.apply(e, duration, NULL, NULL, NULL);
+      std::string what;
+      switch (e.type) {
+        case EV_TASK_IN:    what = task_name(d, e.arg) + " switched in"; break;
+        case EV_TASK_OUT:   what = task_name(d, e.arg) + " switched out"; break;
+        case EV_TASK_READY: what = task_name(d, e.arg) + " ready"; break;
+        case EV_TASK_DELAY: what = "delay"; break;
+        case EV_TASK_NOTIFY:
+          what = "notify " + task_name(d, e.arg);
+          break;
+        case EV_TASK_NOTIFY_WAIT: what = "wait for notification"; break;
+        case EV_QUEUE_SEND:       what = "queue send";    break;
+        case EV_QUEUE_RECEIVE:    what = "queue receive"; break;
+        case EV_QUEUE_BLOCK:      what = "queue block";   break;
+        case EV_ISR_ENTER: what = "enter " + isr_name(e.arg); break;
+        case EV_ISR_EXIT:  what = "exit " + isr_name(e.arg);  break;
+        case EV_SPAN_BEGIN: what = "begin " + label_name(labels, e.arg); break;
+        case EV_SPAN_END:   what = "end " + label_name(labels, e.arg);   break;
+        default:            what = "unknown event"; break;
+      }
+      if (e.type >= EV_QUEUE_SEND && e.type <= EV_QUEUE_BLOCK) {
+        char num[16];
+        snprintf(num, sizeof(num), " %u", e.arg);
+        what += num;
+      }
+      printf("%12.2f us  %-16s %s", t.us(e.time - d.events[0].time),
+             ctx.c_str(), what.c_str());
+      if (duration >= 0) { printf(" (%.2f us)", duration); }
+      printf("\n");
+    }
+  }
+}
+
+/*
+ * Draw one row per task, interrupt and span, with a column for
+ * each slice of time: '#' where a task ran or an interrupt was
+ * active, '=' where a span was open.
+ */
+static void decode_gantt(const std::vector<dump>& dumps,
+                         const label_table& labels, unsigned columns) {
+  for (size_t i = 0; i < dumps.size(); ++i) {
+    const dump& d = dumps[i];
+    if (d.events.size() < 2) { continue; }
+    uint64_t start = d.events[0].time;
+    uint64_t span  = d.events.back().time - start;
+    if (!span) { continue; }
+    // Rows, by label; each is a list of [from, to) cycle ranges.
+    std::map<std::string, std::vector<std::pair<uint64_t, uint64_t> > > rows;
+    std::map<std::string, char> marks;
+    tracker t(d, labels);
+    for (size_t j = 0; j < d.events.size(); ++j) {
+      const event& e = d.events[j];
+      double duration;
+      t.apply(e, duration, NULL, NULL, NULL);
+      if (duration < 0) { continue; }
+      uint64_t from = t.ended_from;
+      std::string row;
+      char mark = '#';
+      if (e.type == EV_TASK_OUT)      { row = task_name(d, e.arg); }
+      else if (e.type == EV_ISR_EXIT) { row = "[" + isr_name(e.arg) + "]"; }
+      else {
+        row  = "<" + label_name(labels, e.arg) + ">";
+        mark = '=';
+      }
+      rows[row].push_back(std::make_pair(from, e.time));
+      marks[row] = mark;
+    }
+    printf("Dump %zu: %.1f us, %.2f us per column\n", i + 1,
+           t.us(span), t.us(span) / columns);
+    for (std::map<std::string,
+         std::vector<std::pair<uint64_t, uint64_t> > >::iterator it =
+         rows.begin(); it != rows.end(); ++it) {
+      std::string line(columns, '.');
+      for (size_t r = 0; r < it->second.size(); ++r) {
+        uint64_t from = it->second[r].first  - start;
+        uint64_t to   = it->second[r].second - start;
+        unsigned c0 = (unsigned)((from * columns) / span);
+        unsigned c1 = (unsigned)((to * columns) / span);
+        for (unsigned c = c0; c <= c1 && c < columns; ++c) {
+          line[c] = marks[it->first];
+        }
+      }
+      printf("  %-18s %s\n", it->first.c_str(), line.c_str());
+    }
+  }
+}
+
+static void usage(void) {
+  fprintf(stderr,
+    "Usage: trace_decode <firmware.elf> <trace.bin> summary\n"
+    "       trace_decode <firmware.elf> <trace.bin> timeline\n"
+    "       trace_decode <firmware.elf> <trace.bin> gantt [columns]\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    usage();
+    return 1;
+  }
+  label_table labels;
+  if (!load_labels(argv[1], labels)) { return 1; }
+  std::vector<dump> dumps;
+  if (!load_dumps(argv[2], dumps)) { return 1; }
+  const char* mode = argv[3];
+  if (!strcmp(mode, "summary") && argc == 4) {
+    decode_summary(dumps, labels);
+  }
+  else if (!strcmp(mode, "timeline") && argc == 4) {
+    decode_timeline(dumps, labels);
+  }
+  else if (!strcmp(mode, "gantt") && argc <= 5) {
+    int columns = (argc == 5) ? atoi(argv[4]) : 100;
+    if (columns < 10) { columns = 10; }
+    decode_gantt(dumps, labels, columns);
+  }
+  else {
+    usage();
+    return 1;
+  }
+  return 0;
+}